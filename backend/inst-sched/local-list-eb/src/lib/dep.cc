@@ -37,7 +37,7 @@ bool ins_use_reg(const EbbView &ebb, const std::string &reg,
 
 } // namespace
 
-Digraph make_dep_graph(const EbPaths::path_t &path) {
+Digraph make_dep_graph(const EbPaths::path_t &path, const ModRef &modref) {
   EbbView ebb(path);
   Digraph g(ebb.size());
 
@@ -65,11 +65,20 @@ Digraph make_dep_graph(const EbPaths::path_t &path) {
         if (ins_use_reg(ebb, defs.front(), prev))
           g.add_edge(prev, ins_idx);
 
-    // find store before a load
-    if (ins.opname() == "load")
-      for (std::size_t prev = bb_beg_idx; prev < ins_idx; ++prev)
-        if (ebb[prev][0] == "store")
-          g.add_edge(prev, ins_idx);
+    // find memory write before a memory read
+    // calls with side effects also keep their order with all memory accesses
+    bool reads = modref.reads(ins);
+    bool writes = modref.writes(ins);
+    bool is_call = ins.kind() == isa::InsKind::CALL;
+    for (std::size_t prev = bb_beg_idx; prev < ins_idx; ++prev) {
+      isa::Ins pins(ebb.ctx(), ebb[prev]);
+      bool pcall = pins.kind() == isa::InsKind::CALL;
+      bool pwrites = modref.writes(pins);
+      bool preads = modref.reads(pins);
+      if ((pwrites && reads) ||
+          ((is_call || pcall) && (pwrites || preads) && writes))
+        g.add_edge(prev, ins_idx);
+    }
 
     // find any before last terminal
     if (ins_idx + 1 == ebb.size())
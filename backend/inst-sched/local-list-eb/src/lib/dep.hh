@@ -3,6 +3,7 @@
 #include "../isa/module.hh"
 #include "../utils/digraph.hh"
 #include "eb-paths.hh"
+#include "mod-ref.hh"
 
 // Build dependency graph
 // Each node is an index in the instructions list of path
@@ -10,7 +11,10 @@
 //  (x must be completed before y starts)
 // x -> y if :
 //  1) y uses reg defined in x
-//  2) y is a load and x is a store
+//  2) y reads memory (load / call) and x writes memory (store / call),
+//     or x or y is a call, x reads or writes memory and y writes memory
+//     (memory effects of calls come from the summaries of modref, calls to
+//     pure functions can be moved like any other instruction)
 //  3) x before y and y def is used in x (antidependant)
 //  4) y is a terminal in last bb and x is anything
 //     (actually only add if x has no successors to simplify graph)
@@ -24,4 +28,4 @@
 //  without this exception, all deps to last terminal would have to be local bb
 //  term which would have resulted into no code motion at all allowed between
 //  blocks
-Digraph make_dep_graph(const EbPaths::path_t &path);
+Digraph make_dep_graph(const EbPaths::path_t &path, const ModRef &modref);
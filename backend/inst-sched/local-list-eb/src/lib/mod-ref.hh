@@ -0,0 +1,58 @@
+#pragma once
+
+#include <map>
+#include <ostream>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "../isa/module.hh"
+
+// Side effects summary of a function
+struct FunSummary {
+  bool reads = false;  // may read memory
+  bool writes = false; // may write memory
+  // escapes[i]: argument i may outlive the call (stored, returned, or passed
+  // to a function where it escapes)
+  std::vector<bool> escapes;
+
+  // No side effects: the call only depends on its operands
+  bool pure() const { return !reads && !writes; }
+
+  bool arg_escapes(std::size_t pos) const {
+    return pos >= escapes.size() || escapes[pos];
+  }
+};
+
+// Interprocedural mod / ref summaries
+// A function reads (resp. writes) memory if it has a load (resp. a store), or
+// calls a function that does. Functions without a definition may do anything.
+// Functions are visited bottom-up on the call graph (callees first), and
+// visited again until nothing changes, to handle recursion.
+class ModRef {
+
+public:
+  ModRef(const isa::Module &mod);
+
+  // Summary of function name, worst case if it has no definition
+  const FunSummary &get(const std::string &name) const;
+
+  // Memory effects of any instruction
+  bool reads(const isa::Ins &ins) const;
+  bool writes(const isa::Ins &ins) const;
+
+  void dump(std::ostream &os) const;
+
+private:
+  std::map<std::string, const isa::Function *> _funs;
+  std::vector<const isa::Function *> _order; // callees first
+  std::map<std::string, FunSummary> _sums;
+  FunSummary _unknown;
+
+  void _build_order(const isa::Function &fun,
+                    std::set<const isa::Function *> &visited);
+  bool _update(const isa::Function &fun);
+};
+
+// Name of the function called by a call instruction
+std::string call_target(const isa::Ins &ins);
@@ -38,8 +38,8 @@ std::ostream &operator<<(std::ostream &os,
 
 } // namespace
 
-Scheduler::Scheduler(isa::Function &fun)
-    : _fun(fun), _cfg(_fun.get_analysis<CFG>()),
+Scheduler::Scheduler(isa::Function &fun, const ModRef &modref)
+    : _fun(fun), _modref(modref), _cfg(_fun.get_analysis<CFG>()),
       _paths(_fun.get_analysis<EbPaths>().paths()) {}
 
 void Scheduler::run() {
@@ -72,7 +72,7 @@ void Scheduler::_schedule_path(const EbPaths::path_t &path) {
     ++_path_cut;
 
   // Build dependency graph
-  _depg = std::make_unique<Digraph>(make_dep_graph(path));
+  _depg = std::make_unique<Digraph>(make_dep_graph(path, _modref));
 
   // Some dependencies are added between terminal and next ins
   // to avoid code moving to a previous bb
@@ -8,6 +8,7 @@
 #include "../utils/digraph.hh"
 #include "cfg.hh"
 #include "eb-paths.hh"
+#include "mod-ref.hh"
 
 #include <logia/md-gfm-doc.hh>
 
@@ -32,6 +33,8 @@
 // Paths are sorted from more frequently taken to less frequently taken.
 // These paths  handled firsts are less likely to have compensation code
 // inserted, which makes them faster than later paths
+// Calls are scheduled like other instructions, their memory dependencies come
+// from interprocedural mod / ref summaries (see mod-ref.hh)
 //
 // This kind of algorithm isn't really usefull for most general purpose CPUs,
 // They perform Out of Order execution. OOE is implemented in hardware using
@@ -43,12 +46,13 @@
 class Scheduler {
 
 public:
-  Scheduler(isa::Function &fun);
+  Scheduler(isa::Function &fun, const ModRef &modref);
 
   void run();
 
 private:
   isa::Function &_fun;
+  const ModRef &_modref;
   const CFG &_cfg;
   const std::vector<const EbPaths::path_t *> &_paths;
 
@@ -4,6 +4,7 @@
 
 #include "isa/isa.hh"
 #include "isa/module.hh"
+#include "lib/mod-ref.hh"
 #include "lib/renamer.hh"
 #include "lib/sched.hh"
 #include <logia/program.hh>
@@ -28,9 +29,15 @@ int main(int argc, char **argv) {
   Renamer renamer(ir_mod);
   renamer.run();
 
+  // Side effects of all functions, to know which calls can be moved
+  ModRef modref(ir_mod);
+  std::cout << "Summaries:\n";
+  modref.dump(std::cout);
+  std::cout << "\n";
+
   // Schedule all functions one by one
   for (auto fun : ir_mod.funs()) {
-    Scheduler sc(*fun);
+    Scheduler sc(*fun, modref);
     sc.run();
   }
 
@@ -25,7 +25,8 @@ std::size_t find_def_of(const isa::BasicBlock &bb, const std::string &reg) {
 
 } // namespace
 
-Digraph make_dep_graph(const isa::BasicBlock &bb) {
+Digraph make_dep_graph(const isa::BasicBlock &bb, const ModRef &modref) {
+  const auto &ctx = bb.parent().parent().ctx();
   Digraph g(bb.code().size());
 
   for (std::size_t i = 0; i < bb.code().size(); ++i) {
@@ -41,12 +42,20 @@ Digraph make_dep_graph(const isa::BasicBlock &bb) {
       }
     }
 
-    // find store before a load / ret
-    if (ins.opname() == "load" || ins.opname() == "ret" ||
-        ins.opname() == "retv")
-      for (std::size_t prev = 0; prev < i; ++prev)
-        if (bb.code()[prev][0] == "store")
-          g.add_edge(prev, i);
+    // find memory write before a memory read / ret
+    // calls with side effects also keep their order with all memory accesses
+    bool reads = modref.reads(ins) || ins.kind() == isa::InsKind::RET;
+    bool writes = modref.writes(ins);
+    bool is_call = ins.kind() == isa::InsKind::CALL;
+    for (std::size_t prev = 0; prev < i; ++prev) {
+      isa::Ins pins(ctx, bb.code()[prev]);
+      bool pcall = pins.kind() == isa::InsKind::CALL;
+      bool pwrites = modref.writes(pins);
+      bool preads = modref.reads(pins);
+      if ((pwrites && reads) ||
+          ((is_call || pcall) && (pwrites || preads) && writes))
+        g.add_edge(prev, i);
+    }
   }
 
   return g;
@@ -2,6 +2,7 @@
 
 #include "../isa/module.hh"
 #include "../utils/digraph.hh"
+#include "mod-ref.hh"
 
 // Build dependency graph
 // Each node is an index in the instructions list of bb
@@ -9,7 +10,10 @@
 //  (x must be completed before y starts)
 // x -> y if :
 //  - y uses reg defined in x
-//  - y is a load and x is a store
-//  - y is a ret and x is a store
+//  - y reads memory (load / call) and x writes memory (store / call)
+//  - y is a ret and x writes memory
 //    (actually x->y true for any x if y is a ret, but makes ex simpler)
-Digraph make_dep_graph(const isa::BasicBlock &bb);
+//  - x or y is a call, x reads or writes memory and y writes memory
+// Memory effects of calls come from the summaries of modref, calls to pure
+// functions can be moved like any other instruction.
+Digraph make_dep_graph(const isa::BasicBlock &bb, const ModRef &modref);
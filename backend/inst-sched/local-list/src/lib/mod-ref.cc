@@ -0,0 +1,151 @@
+#include "mod-ref.hh"
+
+#include <set>
+
+namespace {
+
+bool is_call(const isa::Ins &ins) {
+  return ins.kind() == isa::InsKind::CALL;
+}
+
+// Position of the first call argument
+std::size_t call_args_beg(const isa::Ins &ins) {
+  std::size_t res = 1;
+  while (ins.args()[res][0] != '@')
+    ++res;
+  return res + 1;
+}
+
+} // namespace
+
+std::string call_target(const isa::Ins &ins) {
+  return ins.args()[call_args_beg(ins) - 1].substr(1);
+}
+
+ModRef::ModRef(const isa::Module &mod) {
+  _unknown.reads = true;
+  _unknown.writes = true;
+
+  for (auto fun : mod.funs()) {
+    _funs.emplace(fun->name(), fun);
+    _sums[fun->name()].escapes.assign(fun->args().size(), false);
+  }
+  std::set<const isa::Function *> visited;
+  for (auto fun : mod.funs())
+    _build_order(*fun, visited);
+
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (auto fun : _order)
+      changed |= _update(*fun);
+  }
+}
+
+const FunSummary &ModRef::get(const std::string &name) const {
+  auto it = _sums.find(name);
+  return it == _sums.end() ? _unknown : it->second;
+}
+
+bool ModRef::reads(const isa::Ins &ins) const {
+  if (is_call(ins))
+    return get(call_target(ins)).reads;
+  return ins.opname() == "load";
+}
+
+bool ModRef::writes(const isa::Ins &ins) const {
+  if (is_call(ins))
+    return get(call_target(ins)).writes;
+  return ins.opname() == "store";
+}
+
+void ModRef::dump(std::ostream &os) const {
+  for (auto fun : _order) {
+    const auto &sum = get(fun->name());
+    os << fun->name() << ":";
+    if (sum.pure())
+      os << " pure";
+    if (sum.reads)
+      os << " reads";
+    if (sum.writes)
+      os << " writes";
+    for (std::size_t i = 0; i < sum.escapes.size(); ++i)
+      if (sum.escapes[i])
+        os << " escapes#" << i;
+    os << "\n";
+  }
+}
+
+// Post-order DFS on the call graph
+void ModRef::_build_order(const isa::Function &fun,
+                          std::set<const isa::Function *> &visited) {
+  if (!visited.insert(&fun).second)
+    return;
+
+  const auto &ctx = fun.parent().ctx();
+  for (auto bb : fun.bbs())
+    for (const auto &code : bb->code()) {
+      isa::Ins ins(ctx, code);
+      if (!is_call(ins))
+        continue;
+      auto it = _funs.find(call_target(ins));
+      if (it != _funs.end())
+        _build_order(*it->second, visited);
+    }
+  _order.push_back(&fun);
+}
+
+bool ModRef::_update(const isa::Function &fun) {
+  auto &sum = _sums.at(fun.name());
+  auto old = sum;
+  const auto &ctx = fun.parent().ctx();
+
+  for (auto bb : fun.bbs())
+    for (const auto &code : bb->code()) {
+      isa::Ins ins(ctx, code);
+      sum.reads |= reads(ins);
+      sum.writes |= writes(ins);
+    }
+
+  // Registers may be redefined, so any register that once holds a value
+  // computed from the argument is considered to hold it
+  for (std::size_t i = 0; i < fun.args().size(); ++i) {
+    std::set<std::string> regs{fun.args()[i]};
+    bool changed = true;
+    while (changed && !sum.escapes[i]) {
+      changed = false;
+      for (auto bb : fun.bbs())
+        for (const auto &code : bb->code()) {
+          isa::Ins ins(ctx, code);
+          auto uses = ins.args_uses();
+          bool tainted = false;
+          for (const auto &r : uses)
+            tainted |= regs.count(r) > 0;
+          if (!tainted)
+            continue;
+
+          // store value, address
+          if (ins.opname() == "retv" ||
+              (ins.opname() == "store" && regs.count(uses[0])))
+            sum.escapes[i] = true;
+
+          if (is_call(ins)) {
+            const auto &callee = get(call_target(ins));
+            auto beg = call_args_beg(ins);
+            for (std::size_t j = beg; j < code.size(); ++j)
+              if (regs.count(code[j].substr(1)) &&
+                  callee.arg_escapes(j - beg))
+                sum.escapes[i] = true;
+          }
+
+          if (ins.opname() == "load" || ins.opname() == "cmp")
+            continue;
+          for (const auto &d : ins.args_defs())
+            changed |= regs.insert(d).second;
+        }
+    }
+  }
+
+  return sum.reads != old.reads || sum.writes != old.writes ||
+         sum.escapes != old.escapes;
+}
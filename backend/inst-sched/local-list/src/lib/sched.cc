@@ -52,6 +52,11 @@ void Scheduler::run() {
   log_mod("After Renaming", _mod);
   _mod.check();
 
+  _modref = std::make_unique<ModRef>(_mod);
+  std::cout << "Summaries:\n";
+  _modref->dump(std::cout);
+  std::cout << "\n";
+
   // schedule each bb
   for (auto fun : _mod.funs())
     for (auto bb : fun->bbs())
@@ -67,7 +72,7 @@ void Scheduler::_run(isa::BasicBlock &bb) {
       "Schedule @" + bb.parent().name() + ":@" + bb.name());
 
   // Step 2 : Build dependence graph
-  _depg = std::make_unique<Digraph>(make_dep_graph(bb));
+  _depg = std::make_unique<Digraph>(make_dep_graph(bb, *_modref));
 
   // Step 3 : Assign priorites to each instruction
   _compute_latencies();
@@ -6,6 +6,7 @@
 
 #include "../isa/module.hh"
 #include "../utils/digraph.hh"
+#include "mod-ref.hh"
 
 #include <logia/md-gfm-doc.hh>
 
@@ -19,6 +20,8 @@
 // started
 // For dynamic scheduling, just reorder the list of instructions.
 // This version only works to schedule a basicblock
+// Calls are scheduled like other instructions, their memory dependencies come
+// from interprocedural mod / ref summaries (see mod-ref.hh)
 //
 // This kind of algorithm isn't really usefull for most general purpose CPUs,
 // They perform Out of Order execution. OOE is implemented in hardware using
@@ -38,6 +41,9 @@ private:
   isa::Module &_mod;
   isa::BasicBlock *_bb;
 
+  // Side effects of all functions, to know which calls can be moved
+  std::unique_ptr<ModRef> _modref;
+
   // Dependence graph
   // x -> y means x must be executed before y
   // In Engineer Compiler, graph order is reversed:
@@ -81,21 +81,28 @@ check_cmake_proj backend/reg-alloc/color-ssa-td
 check_shell_proj frontend/lexer/lexer-simple-py
 check_shell_proj frontend/lexer/regex-simple-py
 
+check_cmake_proj middle-end-optis/copy-propagation
 check_cmake_proj middle-end-optis/dead-code-elim
+check_cmake_proj middle-end-optis/dead-code-elim-ssa
 check_cmake_proj middle-end-optis/dominance
 check_cmake_proj middle-end-optis/dom-value-numbering
 check_cmake_proj middle-end-optis/fun-inliner
 check_cmake_proj middle-end-optis/global-code-placement
 check_cmake_proj middle-end-optis/idom
 check_cmake_proj middle-end-optis/interproc-constprop
+check_cmake_proj middle-end-optis/jump-threading
 check_cmake_proj middle-end-optis/lazy-code-motion
 check_cmake_proj middle-end-optis/live-uninit-regs
 check_cmake_proj middle-end-optis/local-value-numbering
+check_cmake_proj middle-end-optis/loop-unrolling
+check_cmake_proj middle-end-optis/operator-strength-reduction
 check_cmake_proj middle-end-optis/procedure-placement
 check_cmake_proj middle-end-optis/sparsecond-constprop
 check_cmake_proj middle-end-optis/sparse-simple-constprop
 check_cmake_proj middle-end-optis/ssa-semipruned
 check_cmake_proj middle-end-optis/superblock-cloning
 check_cmake_proj middle-end-optis/superlocal-value-numbering
+check_cmake_proj middle-end-optis/tail-recursion-elim
 check_cmake_proj middle-end-optis/tree-height-balancing
+check_cmake_proj middle-end-optis/tree-height-balancing-ssa
 check_cmake_proj middle-end-optis/unssa
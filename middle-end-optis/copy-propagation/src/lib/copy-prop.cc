@@ -0,0 +1,301 @@
+#include "copy-prop.hh"
+
+#include <algorithm>
+#include <functional>
+#include <iostream>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "cfg.hh"
+
+namespace {
+
+// Tarjan SCC on a set of phis, edges go from a phi to its phi operands
+// SCCs are found in reverse topological order: operands first
+class PhiSCCs {
+
+public:
+  PhiSCCs(const std::vector<Instruction *> &phis)
+      : _phis(phis.begin(), phis.end()) {
+    for (auto phi : phis)
+      if (!_num.count(phi))
+        _dfs(*phi);
+  }
+
+  const std::vector<std::vector<Instruction *>> &sccs() const { return _sccs; }
+
+private:
+  std::unordered_set<Instruction *> _phis;
+  std::unordered_map<Instruction *, std::size_t> _num;
+  std::unordered_map<Instruction *, std::size_t> _low;
+  std::vector<Instruction *> _stack;
+  std::unordered_set<Instruction *> _on_stack;
+  std::vector<std::vector<Instruction *>> _sccs;
+
+  void _dfs(Instruction &phi) {
+    auto id = _num.size();
+    _num[&phi] = id;
+    _low[&phi] = id;
+    _stack.push_back(&phi);
+    _on_stack.insert(&phi);
+
+    for (auto op : phi.ops()) {
+      auto def = dynamic_cast<Instruction *>(op);
+      if (!def || !_phis.count(def))
+        continue;
+      if (!_num.count(def)) {
+        _dfs(*def);
+        _low[&phi] = std::min(_low[&phi], _low[def]);
+      } else if (_on_stack.count(def))
+        _low[&phi] = std::min(_low[&phi], _num[def]);
+    }
+
+    if (_low[&phi] != _num[&phi])
+      return;
+
+    std::vector<Instruction *> scc;
+    Instruction *node;
+    do {
+      node = _stack.back();
+      _stack.pop_back();
+      _on_stack.erase(node);
+      scc.push_back(node);
+    } while (node != &phi);
+    _sccs.push_back(scc);
+  }
+};
+
+using phi_key_t =
+    std::pair<const BasicBlock *, std::vector<std::pair<Value *, Value *>>>;
+
+struct PhiKeyHash {
+  std::size_t operator()(const phi_key_t &key) const {
+    std::hash<const void *> h;
+    std::size_t res = h(key.first);
+    for (const auto &in : key.second) {
+      res = res * 31 + h(in.first);
+      res = res * 31 + h(in.second);
+    }
+    return res;
+  }
+};
+
+class CopyProp {
+
+public:
+  CopyProp(Function &fun) : _fun(fun) {}
+
+  void run() {
+    for (auto &bb : _fun.bb())
+      for (auto &ins : bb.ins())
+        if (ins.get_opname() == "mov" || ins.get_opname() == "phi")
+          _push(ins);
+
+    // Phis replaced by the SCCs push their users, until nothing changes
+    std::size_t replaced;
+    do {
+      _drain();
+      replaced = _replaced;
+
+      std::vector<Instruction *> phis;
+      for (auto &bb : _fun.bb())
+        for (auto &ins : bb.ins())
+          if (ins.get_opname() == "phi")
+            phis.push_back(&ins);
+      _remove_redundant(phis);
+    } while (_replaced != replaced);
+
+    _merge_blocks();
+  }
+
+private:
+  Function &_fun;
+  std::vector<Instruction *> _work;
+  std::unordered_set<Instruction *> _in_work;
+  std::size_t _replaced = 0;
+
+  // Hash of all phis visited, and the key used for each one
+  std::unordered_map<phi_key_t, Instruction *, PhiKeyHash> _phis;
+  std::unordered_map<Instruction *, phi_key_t> _phi_keys;
+
+  void _drain() {
+    while (!_work.empty()) {
+      auto ins = _work.back();
+      _work.pop_back();
+      // Erased while in the worklist
+      if (!_in_work.erase(ins))
+        continue;
+      _visit(*ins);
+    }
+  }
+
+  void _push(Instruction &ins) {
+    if (_in_work.insert(&ins).second)
+      _work.push_back(&ins);
+  }
+
+  void _visit(Instruction &ins) {
+    if (ins.get_opname() == "mov") {
+      _replace(ins, ins.op(0), "Copy: ");
+      return;
+    }
+
+    Value *same = nullptr;
+    bool trivial = true;
+    for (std::size_t i = 1; i < ins.ops_count(); i += 2) {
+      auto val = &ins.op(i);
+      if (val == &ins || val == same)
+        continue;
+      if (same) {
+        trivial = false;
+        break;
+      }
+      same = val;
+    }
+    // Only uses itself: unreachable block
+    if (!same)
+      return;
+    if (trivial) {
+      _replace(ins, *same, "Trivial phi: ");
+      return;
+    }
+
+    // Incoming values are sorted by block, order doesn't matter
+    phi_key_t key(&ins.parent(), {});
+    for (std::size_t i = 0; i < ins.ops_count(); i += 2)
+      key.second.emplace_back(&ins.op(i), &ins.op(i + 1));
+    std::sort(key.second.begin(), key.second.end());
+
+    _unregister(ins);
+    auto it = _phis.find(key);
+    if (it != _phis.end()) {
+      _replace(ins, *it->second, "Redundant phi: ");
+      return;
+    }
+    _phis.emplace(key, &ins);
+    _phi_keys.emplace(&ins, key);
+  }
+
+  void _unregister(Instruction &ins) {
+    auto it = _phi_keys.find(&ins);
+    if (it == _phi_keys.end())
+      return;
+    _phis.erase(it->second);
+    _phi_keys.erase(it);
+  }
+
+  // Replace all uses of ins by val, and remove it
+  void _replace(Instruction &ins, Value &val, const char *log) {
+    std::cout << log;
+    ins.dump(std::cout);
+    std::cout << "\n";
+
+    ++_replaced;
+    auto users = ins.get_users();
+    ins.replace_all_uses_with(val);
+    for (auto user : users) {
+      auto phi = dynamic_cast<Instruction *>(user);
+      if (phi && phi != &ins && phi->get_opname() == "phi")
+        _push(*phi);
+    }
+    _erase(ins);
+  }
+
+  void _erase(Instruction &ins) {
+    _unregister(ins);
+    _in_work.erase(&ins);
+    ins.erase_from_parent();
+  }
+
+  void _remove_redundant(const std::vector<Instruction *> &phis) {
+    PhiSCCs sccs(phis);
+    for (const auto &scc : sccs.sccs())
+      _process_scc(scc);
+  }
+
+  void _process_scc(const std::vector<Instruction *> &scc) {
+    std::unordered_set<Value *> nodes(scc.begin(), scc.end());
+    std::unordered_set<Value *> outer;
+    std::vector<Instruction *> inner;
+    for (auto phi : scc) {
+      bool is_inner = true;
+      for (std::size_t i = 1; i < phi->ops_count(); i += 2)
+        if (!nodes.count(&phi->op(i))) {
+          outer.insert(&phi->op(i));
+          is_inner = false;
+        }
+      if (is_inner)
+        inner.push_back(phi);
+    }
+
+    if (outer.size() == 1) {
+      auto &val = **outer.begin();
+      for (auto phi : scc)
+        _replace(*phi, val, "Redundant phi: ");
+    } else if (outer.size() > 1)
+      _remove_redundant(inner);
+  }
+
+  // Successors of bb, using its current terminator
+  std::vector<BasicBlock *> _succs(BasicBlock &bb) {
+    auto res = bb.ins().back().branch_targets();
+    std::sort(res.begin(), res.end());
+    res.erase(std::unique(res.begin(), res.end()), res.end());
+    return res;
+  }
+
+  // A block with a single succ, which has only this block as pred
+  // Merging doesn't change the number of preds of the other blocks
+  void _merge_blocks() {
+    CFG cfg(_fun);
+    auto &entry = _fun.get_entry_bb();
+    std::unordered_set<BasicBlock *> merged;
+
+    std::vector<BasicBlock *> bbs;
+    for (auto &bb : _fun.bb())
+      bbs.push_back(&bb);
+
+    for (auto bb : bbs) {
+      if (merged.count(bb))
+        continue;
+
+      // there may be a chain of many BBs to merge
+      auto succs = _succs(*bb);
+      while (succs.size() == 1 && succs[0] != bb && succs[0] != &entry &&
+             cfg.preds(*succs[0]).size() == 1) {
+        auto succ = succs[0];
+        std::cout << "Merge: " << bb->to_arg() << " <- " << succ->to_arg()
+                  << "\n";
+
+        // phis of a block with a single pred have only one incoming value
+        while (succ->ins().front().get_opname() == "phi") {
+          auto &phi = succ->ins().front();
+          phi.replace_all_uses_with(phi.op(1));
+          phi.erase_from_parent();
+        }
+
+        bb->ins().back().erase_from_parent();
+        BasicBlock::ins_move(*succ, succ->ins_begin(), succ->ins_end(), *bb,
+                             bb->ins_end());
+        // Only the phis of the succs still refer to succ
+        succ->replace_all_uses_with(*bb);
+        succ->erase_from_parent();
+        merged.insert(succ);
+        succs = _succs(*bb);
+      }
+    }
+  }
+};
+
+} // namespace
+
+void copyprop_run(Module &mod) {
+  for (auto &fun : mod.fun()) {
+    if (!fun.has_def())
+      continue;
+    CopyProp cp(fun);
+    cp.run();
+  }
+}
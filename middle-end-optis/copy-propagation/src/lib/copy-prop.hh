@@ -0,0 +1,29 @@
+#pragma once
+
+#include "module.hh"
+
+// Copy propagation and phi simplification
+// All movs and phis start in a worklist:
+// - `mov %d, v`: all uses of %d are replaced by v
+// - a phi is trivial if all its incoming values are the same v, or itself:
+//   it's replaced by v
+// - a phi is redundant if another phi of the same block has the same
+//   incoming values (phis are hashed by block and incoming values)
+// When a value is replaced, the phis using it are pushed back to the worklist
+// (an operand changed, they may now be trivial or redundant).
+//
+// Cycles of phis (eg: a variable unchanged by a nested loop) are never trivial
+// one by one: the strongly connected components of the phis graph are
+// visited operands first. A SCC with a single value from outside is replaced
+// by it. Otherwise the same is done for the phis that only use phis of the
+// SCC.
+// Phis replaced this way push their users to the worklist, which is run again,
+// until a fixed point.
+// All sets / maps are hashed, each phi is visited once per changed operand.
+//
+// Finally, a block whose only succ has only this block as pred is merged with
+// it, for chains of any length (phis of the succs are moved to the new block).
+//
+// Simple and Efficient Construction of Static Single Assignment Form - Braun,
+// Buchwald, Hack, Leißa, Mallon & Zwinkau
+void copyprop_run(Module &mod);
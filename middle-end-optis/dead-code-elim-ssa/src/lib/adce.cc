@@ -0,0 +1,268 @@
+#include "adce.hh"
+
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "cfg.hh"
+#include "digraph-order.hh"
+#include "post-dom.hh"
+#include "vertex-adapter.hh"
+
+namespace {
+
+std::vector<BasicBlock *> unique_bbs(std::vector<BasicBlock *> bbs) {
+  std::vector<BasicBlock *> res;
+  for (auto bb : bbs)
+    if (std::find(res.begin(), res.end(), bb) == res.end())
+      res.push_back(bb);
+  return res;
+}
+
+std::vector<Instruction *> list_ins(Function &fun) {
+  std::vector<Instruction *> res;
+  for (auto &bb : fun.bb())
+    for (auto &ins : bb.ins())
+      res.push_back(&ins);
+  return res;
+}
+
+// Remove the incoming values from pred of all phis of bb
+void remove_phi_entries(BasicBlock &bb, const BasicBlock &pred) {
+  std::vector<Instruction *> phis;
+  for (auto &ins : bb.ins())
+    if (ins.get_opname() == "phi")
+      phis.push_back(&ins);
+
+  for (auto phi : phis) {
+    std::vector<Value *> ops;
+    for (std::size_t i = 0; i < phi->ops_count(); i += 2)
+      if (&phi->op(i) != &pred) {
+        ops.push_back(&phi->op(i));
+        ops.push_back(&phi->op(i + 1));
+      }
+    if (ops.size() == phi->ops_count())
+      continue;
+
+    // The def of a phi is always its first argument
+    auto name = phi->get_name();
+    auto &new_phi = *bb.insert_ins(ins_iterator_t(phi), "phi", ops, "", 1);
+    phi->replace_all_uses_with(new_phi);
+    phi->erase_from_parent();
+    new_phi.set_name(name);
+  }
+}
+
+void replace_op(Instruction &ins, Value &old_val, Value &new_val) {
+  for (std::size_t i = 0; i < ins.ops_count(); ++i)
+    if (&ins.op(i) == &old_val)
+      ins.set_op(i, new_val);
+}
+
+bool has_phis(BasicBlock &bb) {
+  return bb.ins().front().get_opname() == "phi";
+}
+
+// Replace the branch of bb by a jump to target
+void set_jump(BasicBlock &bb, BasicBlock &target) {
+  auto &br = bb.ins().back();
+  bb.insert_ins(ins_iterator_t(&br), "b", {&target}, "", isa::IDX_NO);
+  br.erase_from_parent();
+}
+
+class ADCE {
+
+public:
+  ADCE(Function &fun) : _fun(fun) {}
+
+  void run() {
+    _remove_unreachable();
+
+    _cfg.reset(new CFG(_fun));
+    _pdom.reset(new PostDomTree(*_cfg));
+    _pdom->dump();
+    _ins_va.reset(new VertexAdapter<Instruction *>(list_ins(_fun)));
+    _mark();
+    _sweep();
+
+    _remove_unreachable();
+    while (_remove_empty())
+      continue;
+  }
+
+private:
+  Function &_fun;
+  std::unique_ptr<CFG> _cfg;
+  std::unique_ptr<PostDomTree> _pdom;
+  std::unique_ptr<VertexAdapter<Instruction *>> _ins_va;
+
+  // Indexed by instructions / blocks numbers
+  std::vector<int> _live;
+  std::vector<int> _live_bbs;
+  std::vector<Instruction *> _work;
+
+  bool _is_critical(Instruction &ins) {
+    const auto &opname = ins.get_opname();
+    if (opname == "call" || opname == "ret")
+      return true;
+    auto &mva = _cfg->mva(_fun);
+    return ins.is_branch() && _pdom->no_exit(mva(&ins.parent()));
+  }
+
+  void _mark_ins(Instruction &ins) {
+    auto &live = _live[(*_ins_va)(&ins)];
+    if (live)
+      return;
+    live = 1;
+    _work.push_back(&ins);
+  }
+
+  void _mark() {
+    auto &mva = _cfg->mva(_fun);
+    _live.assign(_ins_va->size(), 0);
+    _live_bbs.assign(mva.size(), 0);
+
+    for (std::size_t i = 0; i < _ins_va->size(); ++i)
+      if (_is_critical(*(*_ins_va)(i)))
+        _mark_ins(*(*_ins_va)(i));
+
+    while (!_work.empty()) {
+      auto &ins = *_work.back();
+      _work.pop_back();
+
+      for (auto op : ins.ops())
+        if (auto def = dynamic_cast<Instruction *>(op))
+          _mark_ins(*def);
+
+      // The incoming edges of a phi must be kept
+      if (ins.get_opname() == "phi")
+        for (std::size_t i = 0; i < ins.ops_count(); i += 2)
+          _mark_ins(dynamic_cast<BasicBlock &>(ins.op(i)).ins().back());
+
+      auto bb = mva(&ins.parent());
+      if (_live_bbs[bb])
+        continue;
+      _live_bbs[bb] = 1;
+      for (auto v : _pdom->rdf(bb))
+        _mark_ins(mva(v)->ins().back());
+    }
+  }
+
+  // Remove all unmarked instructions, except jumps
+  void _sweep() {
+    auto &mva = _cfg->mva(_fun);
+    std::vector<Instruction *> dead;
+    std::vector<std::pair<BasicBlock *, BasicBlock *>> jumps;
+
+    // Everything is logged first, dead operands are erased in any order
+    for (std::size_t i = 0; i < _ins_va->size(); ++i) {
+      auto ins = (*_ins_va)(i);
+      if (_live[i] || ins->get_opname() == "b")
+        continue;
+      if (!ins->is_branch()) {
+        std::cout << "Remove: ";
+        ins->dump(std::cout);
+        std::cout << "\n";
+        dead.push_back(ins);
+        continue;
+      }
+
+      // Nothing useful depends on the branch, go to the nearest useful
+      // post-dominator
+      auto &bb = ins->parent();
+      auto target = _pdom->ipdom(mva(&bb));
+      while (target != _pdom->exit() && !_live_bbs[target])
+        target = _pdom->ipdom(target);
+      // bb always reaches a marked ret, or the marked branch of a loop
+      assert(target != _pdom->exit());
+
+      std::cout << "Retarget: ";
+      ins->dump(std::cout);
+      std::cout << " -> " << mva(target)->to_arg() << "\n";
+      jumps.emplace_back(&bb, mva(target));
+    }
+
+    for (auto ins : dead)
+      ins->erase_from_parent();
+    for (auto jump : jumps)
+      set_jump(*jump.first, *jump.second);
+  }
+
+  void _remove_unreachable() {
+    CFG cfg(_fun);
+    auto &mva = cfg.mva(_fun);
+    std::vector<int> reached(mva.size(), 0);
+    for (auto u : digraph_dfs(cfg.graph(), DFSOrder::PRE,
+                              mva(&_fun.get_entry_bb()), false))
+      reached[u] = 1;
+
+    std::vector<BasicBlock *> bbs;
+    for (std::size_t u = 0; u < mva.size(); ++u) {
+      if (reached[u])
+        continue;
+      auto &bb = *mva(u);
+      bbs.push_back(&bb);
+      for (auto succ : unique_bbs(cfg.succs(bb)))
+        if (reached[mva(succ)])
+          remove_phi_entries(*succ, bb);
+    }
+
+    for (auto bb : bbs) {
+      std::cout << "Remove unreachable block: " << bb->to_arg() << "\n";
+      bb->erase_from_parent();
+    }
+  }
+
+  // Remove one block that only jumps to another one
+  bool _remove_empty() {
+    CFG cfg(_fun);
+    for (auto &bb : _fun.bb()) {
+      auto &br = bb.ins().front();
+      if (&bb == &_fun.get_entry_bb() || br.get_opname() != "b" ||
+          &br.op(0) == &bb)
+        continue;
+      auto &target = dynamic_cast<BasicBlock &>(br.op(0));
+      auto preds = unique_bbs(cfg.preds(bb));
+
+      if (!has_phis(target))
+        bb.replace_all_uses_with(target);
+      else {
+        // The incoming value from bb now comes from its pred
+        auto target_preds = cfg.preds(target);
+        if (preds.size() != 1 || std::find(target_preds.begin(),
+                                           target_preds.end(),
+                                           preds[0]) != target_preds.end())
+          continue;
+        for (auto &phi : target.ins())
+          if (phi.get_opname() == "phi")
+            replace_op(phi, bb, *preds[0]);
+        replace_op(preds[0]->ins().back(), bb, target);
+      }
+
+      std::cout << "Remove empty block: " << bb.to_arg() << "\n";
+      bb.erase_from_parent();
+
+      for (auto pred : preds) {
+        auto targets = pred->ins().back().branch_targets();
+        if (targets.size() == 2 && targets[0] == targets[1])
+          set_jump(*pred, *targets[0]);
+      }
+      return true;
+    }
+    return false;
+  }
+};
+
+} // namespace
+
+void adce_run(Module &mod) {
+  for (auto &fun : mod.fun()) {
+    if (!fun.has_def())
+      continue;
+    ADCE adce(fun);
+    adce.run();
+  }
+}
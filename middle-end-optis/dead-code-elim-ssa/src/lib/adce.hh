@@ -0,0 +1,29 @@
+#pragma once
+
+#include "module.hh"
+
+// Aggressive Dead Code Elimination
+// Mark and sweep, that assumes every instruction is dead until proven useful
+//
+// Mark pass:
+// - calls and rets are critical, along with the branches of infinite loops
+// - the operands of a marked instruction are marked
+// - a marked phi marks the branches of its incoming blocks
+// - when a block gets its first marked instruction, the branches of all
+//   blocks in its reverse dominance frontier are marked (control dependence)
+//
+// Sweep pass: all unmarked instructions are removed, except jumps.
+// An unmarked conditional branch is replaced by a jump to the nearest
+// post-dominator that contains a marked instruction.
+//
+// The CFG is then cleaned:
+// - blocks unreachable from the entry are removed
+// - blocks that contain only a jump are removed, their preds jump directly to
+//   its target (only if the phis of the target can be updated)
+// - conditional branches with the same targets are replaced by a jump
+//
+// Blocks and instructions are numbered once, marks are vectors indexed by
+// these numbers.
+//
+// Eliminating Useless Code - Engineer a Compiler p544
+void adce_run(Module &mod);
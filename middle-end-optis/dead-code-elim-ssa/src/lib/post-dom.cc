@@ -0,0 +1,140 @@
+#include "post-dom.hh"
+
+#include <cassert>
+#include <iostream>
+
+#include "digraph-order.hh"
+
+namespace {
+
+constexpr std::size_t UNDEF = -1;
+
+}
+
+PostDomTree::PostDomTree(const CFG &cfg)
+    : _cfg(cfg), _exit(cfg.va().size()), _rg(_exit + 1) {
+  _build_graph();
+  _build_ipdom();
+  _build_rdf();
+}
+
+std::size_t PostDomTree::ipdom(std::size_t u) const {
+  assert(u < _exit);
+  return _ipdom[u];
+}
+
+const std::vector<std::size_t> &PostDomTree::rdf(std::size_t u) const {
+  assert(u < _exit);
+  return _rdf[u];
+}
+
+bool PostDomTree::no_exit(std::size_t u) const {
+  assert(u < _exit);
+  return _no_exit[u];
+}
+
+void PostDomTree::dump() const {
+  const auto &va = _cfg.va();
+  for (std::size_t u = 0; u < _exit; ++u) {
+    std::cout << va(u)->get_name() << ": IPDom: ";
+    if (_ipdom[u] == _exit)
+      std::cout << "--";
+    else
+      std::cout << va(_ipdom[u])->get_name();
+    std::cout << ", RDF: {";
+    for (auto v : _rdf[u])
+      std::cout << va(v)->get_name() << " ";
+    std::cout << "}\n";
+  }
+  std::cout << "\n";
+}
+
+void PostDomTree::_build_graph() {
+  const auto &g = _cfg.graph();
+  _no_exit.assign(_exit, 0);
+  for (std::size_t u = 0; u < _exit; ++u) {
+    _rg.labels_set_vertex_name(u, _cfg.va()(u)->get_name());
+    for (auto v : g.succs(u))
+      _rg.add_edge(v, u);
+    if (g.out_deg(u) == 0)
+      _rg.add_edge(_exit, u);
+  }
+  _rg.labels_set_vertex_name(_exit, "exit");
+
+  // Connect one block of every region that can't reach the exit
+  for (;;) {
+    std::vector<int> reached(_exit + 1, 0);
+    for (auto u : digraph_dfs(_rg, DFSOrder::PRE, _exit, false))
+      reached[u] = 1;
+
+    std::size_t u = 0;
+    while (u < _exit && reached[u])
+      ++u;
+    if (u == _exit)
+      break;
+    _no_exit[u] = 1;
+    _rg.add_edge(_exit, u);
+  }
+}
+
+void PostDomTree::_build_ipdom() {
+  auto rpo = digraph_dfs(_rg, DFSOrder::REV_POST, _exit, false);
+  assert(rpo.size() == _exit + 1 && rpo.front() == _exit);
+  _po_pos.assign(_exit + 1, 0);
+  for (std::size_t i = 0; i < rpo.size(); ++i)
+    _po_pos[rpo[i]] = rpo.size() - 1 - i;
+
+  _ipdom.assign(_exit + 1, UNDEF);
+  _ipdom[_exit] = _exit;
+
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (auto u : rpo) {
+      if (u == _exit)
+        continue;
+
+      std::size_t new_ipdom = UNDEF;
+      for (auto v : _rg.preds(u)) {
+        if (_ipdom[v] == UNDEF)
+          continue;
+        new_ipdom = new_ipdom == UNDEF ? v : _intersect(v, new_ipdom);
+      }
+
+      if (_ipdom[u] != new_ipdom) {
+        _ipdom[u] = new_ipdom;
+        changed = true;
+      }
+    }
+  }
+}
+
+std::size_t PostDomTree::_intersect(std::size_t u, std::size_t v) const {
+  while (u != v) {
+    while (_po_pos[u] < _po_pos[v])
+      u = _ipdom[u];
+    while (_po_pos[v] < _po_pos[u])
+      v = _ipdom[v];
+  }
+  return u;
+}
+
+void PostDomTree::_build_rdf() {
+  _rdf.assign(_exit, {});
+
+  // Only blocks with many succs can be in a RDF
+  for (std::size_t u = 0; u < _exit; ++u) {
+    if (_rg.in_deg(u) < 2)
+      continue;
+
+    for (auto v : _rg.preds(u)) {
+      auto runner = v;
+      while (runner != _ipdom[u]) {
+        assert(runner != _exit);
+        if (_rdf[runner].empty() || _rdf[runner].back() != u)
+          _rdf[runner].push_back(u);
+        runner = _ipdom[runner];
+      }
+    }
+  }
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <vector>
+
+#include "cfg.hh"
+#include "digraph.hh"
+
+// Post-dominator tree and reverse dominance frontiers of a function
+// Built on the reverse CFG, with a virtual exit vertex (index exit()), that
+// comes after all blocks of the CFG, and is a succ of every block ending with
+// ret.
+// Blocks that can't reach a ret (infinite loops) have no post-dominator: the
+// first block in function order of such a region is also connected to the
+// exit, and reported by no_exit().
+//
+// IPDom are computed with the iterative algorithm on the reverse postorder of
+// the reverse CFG.
+// RDF(n) is the set of blocks n is control dependent on: m in RDF(n) iff n
+// post-dominates a succ of m, but doesn't strictly post-dominate m.
+//
+// All results are vectors indexed by the vertices of the CFG VertexAdapter.
+//
+// A Simple, Fast Dominance Algorithm - Cooper, Harvey & Kennedy
+class PostDomTree {
+
+public:
+  PostDomTree(const CFG &cfg);
+
+  std::size_t exit() const { return _exit; }
+
+  // Immediate post-dominator of u, exit() for the rets
+  std::size_t ipdom(std::size_t u) const;
+
+  const std::vector<std::size_t> &rdf(std::size_t u) const;
+
+  bool no_exit(std::size_t u) const;
+
+  void dump() const;
+
+private:
+  const CFG &_cfg;
+  const std::size_t _exit;
+  Digraph _rg;
+  std::vector<int> _no_exit;
+  std::vector<std::size_t> _ipdom;
+  std::vector<std::size_t> _po_pos;
+  std::vector<std::vector<std::size_t>> _rdf;
+
+  void _build_graph();
+  void _build_ipdom();
+  std::size_t _intersect(std::size_t u, std::size_t v) const;
+  void _build_rdf();
+};
@@ -3,10 +3,12 @@
 #include <iostream>
 #include <map>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "cfg.hh"
 #include "idom.hh"
+#include "mod-ref.hh"
 
 namespace {
 
@@ -14,83 +16,98 @@ using key_t = std::size_t;
 
 constexpr key_t KEY_NONE = key_t(-1);
 
+// Expression key: opcode id and value numbers of the operands
+struct Expr {
+  std::size_t op;
+  std::vector<key_t> args;
+
+  bool operator==(const Expr &o) const { return op == o.op && args == o.args; }
+};
+
+struct ExprHash {
+  std::size_t operator()(const Expr &e) const {
+    std::size_t res = std::hash<std::size_t>{}(e.op);
+    for (auto k : e.args)
+      res ^= std::hash<key_t>{}(k) + 0x9e3779b9 + (res << 6) + (res >> 2);
+    return res;
+  }
+};
+
+// Scoped hash tables with an undo log
+// Keys are allocated in order, all entries are added to the current scope.
+// Closing a scope removes all keys allocated since it was opened, and their
+// value / expression entries.
+// Opening and closing a scope only costs the number of changes inside it
 class ScopedTable {
-  struct Level {
-    std::vector<Value *> k2v;          // mapping key to value object
-    std::map<Value *, key_t> v2k;      // mapping value object to key
-    std::map<std::string, key_t> hmap; // hash map for expressions
+  struct Entry {
+    Value *val;
+    bool has_expr;
+    Expr expr;
   };
 
 public:
   ScopedTable() = default;
-  ~ScopedTable() { assert(_levels.empty()); }
+  ~ScopedTable() { assert(_scopes.empty()); }
 
-  void open_scope() {
-    if (_levels.empty())
-      _levels.push_back(Level{});
-    else
-      _levels.push_back(_levels.back());
-  }
+  void open_scope() { _scopes.push_back(_keys.size()); }
 
   void close_scope() {
-    assert(!_levels.empty());
-    _levels.pop_back();
+    assert(!_scopes.empty());
+    auto beg = _scopes.back();
+    _scopes.pop_back();
+
+    while (_keys.size() > beg) {
+      const auto &e = _keys.back();
+      _v2k.erase(e.val);
+      if (e.has_expr)
+        _hmap.erase(e.expr);
+      _keys.pop_back();
+    }
   }
 
   key_t get(Value &v) const {
-    assert(!_levels.empty());
-    const auto &l = _levels.back();
-    auto it = l.v2k.find(&v);
-    assert(it != l.v2k.end());
+    auto it = _v2k.find(&v);
+    assert(it != _v2k.end());
     return it->second;
   }
 
-  Value &get(key_t k) const {
-    assert(!_levels.empty());
-    const auto &l = _levels.back();
-    return *l.k2v.at(k);
-  }
-
-  key_t get(const std::string &h) const {
-    assert(!_levels.empty());
-    const auto &l = _levels.back();
-    auto it = l.hmap.find(h);
-    assert(it != l.hmap.end());
-    return it->second;
-  }
+  Value &get(key_t k) const { return *_keys.at(k).val; }
 
-  key_t find(const std::string &h) const {
-    assert(!_levels.empty());
-    const auto &l = _levels.back();
-    auto it = l.hmap.find(h);
-    return it != l.hmap.end() ? it->second : KEY_NONE;
+  key_t find(const Expr &e) const {
+    auto it = _hmap.find(e);
+    return it != _hmap.end() ? it->second : KEY_NONE;
   }
 
   key_t add(Value &v) {
-    assert(!_levels.empty());
-    auto &l = _levels.back();
-    key_t k = l.k2v.size();
-
-    assert(l.v2k.emplace(&v, k).second);
-    l.k2v.push_back(&v);
+    assert(!_scopes.empty());
+    key_t k = _keys.size();
+    assert(_v2k.emplace(&v, k).second);
+    _keys.push_back(Entry{&v, false, Expr{}});
     return k;
   }
 
-  void add_hash(const std::string &h, key_t k) {
-    assert(!_levels.empty());
-    auto &l = _levels.back();
-    assert(k < l.k2v.size());
-    assert(l.hmap.emplace(h, k).second);
+  // Can only be called for the last added key
+  void add_expr(const Expr &e, key_t k) {
+    assert(k + 1 == _keys.size() && !_keys[k].has_expr);
+    assert(_hmap.emplace(e, k).second);
+    _keys[k].has_expr = true;
+    _keys[k].expr = e;
   }
 
 private:
-  std::vector<Level> _levels;
+  // mapping key to value object, also used as undo log
+  std::vector<Entry> _keys;
+  // number of keys when each scope was opened
+  std::vector<std::size_t> _scopes;
+  std::unordered_map<const Value *, key_t> _v2k;   // value object to key
+  std::unordered_map<Expr, key_t, ExprHash> _hmap; // expressions to key
 };
 
 class DVNT {
 
 public:
-  DVNT(Function &fun) : _fun(fun), _cfg(_fun), _idom(_fun, _cfg) {}
+  DVNT(Function &fun, const ModRef &modref)
+      : _fun(fun), _cfg(_fun), _idom(_fun, _cfg), _modref(modref) {}
 
   void run() {
     // outer scope is for arguments and consts
@@ -112,8 +129,10 @@ private:
   Function &_fun;
   CFG _cfg;
   IDom _idom;
+  const ModRef &_modref;
 
   ScopedTable _table;
+  std::unordered_map<std::string, std::size_t> _opcodes;
 
   void _add_args() {
     for (auto arg : _fun.args())
@@ -153,12 +172,13 @@ private:
       if (!ins.has_def())
         continue;
 
-      auto h = _get_hash(ins);
-      auto key = _table.find(h);
+      Expr e;
+      bool has_expr = _get_expr(ins, e);
+      auto key = has_expr ? _table.find(e) : KEY_NONE;
       if (key == KEY_NONE) {
         key = _table.add(ins);
-        if (!h.empty())
-          _table.add_hash(h, key);
+        if (has_expr)
+          _table.add_expr(e, key);
       } else {
         std::cout << "Found duplicate: ";
         ins.dump(std::cout);
@@ -230,26 +250,43 @@ private:
       ins->erase_from_parent();
   }
 
-  std::string _get_hash(Instruction &ins) {
+  bool _get_expr(Instruction &ins, Expr &e) {
     if (ins.get_opname() == "phi") // phi's are handled later
-      return "";
-    if (ins.get_opname() == "call") // cant simplify, call may have side effects
-      return "";
+      return false;
+
+    // Calls to pure functions are like any other instruction
+    // The callee is part of the opcode
+    auto opname = ins.get_opname();
+    std::size_t beg = 0;
+    if (opname == "call") {
+      auto &callee = dynamic_cast<Function &>(ins.op(0));
+      if (!_modref.get(callee).pure()) // may have side effects
+        return false;
+      opname += " " + callee.get_name();
+      beg = 1;
+    }
 
-    std::string res = ins.get_opname();
-    for (auto op : ins.ops())
-      res += ":" + std::to_string(_table.get(*op));
-    return res;
+    auto it = _opcodes.emplace(opname, _opcodes.size()).first;
+    e.op = it->second;
+    e.args.clear();
+    for (std::size_t i = beg; i < ins.ops_count(); ++i)
+      e.args.push_back(_table.get(ins.op(i)));
+    return true;
   }
 };
 
 } // namespace
 
 void dvnt_run(Module &mod) {
+  ModRef modref(mod);
+  std::cout << "Summaries:\n";
+  modref.dump(std::cout);
+  std::cout << "\n";
+
   for (auto &fun : mod.fun()) {
     if (!fun.has_def())
       continue;
-    DVNT dvnt(fun);
+    DVNT dvnt(fun, modref);
     dvnt.run();
   }
 }
@@ -11,6 +11,8 @@
 // This is because before nodes in other blocks when branching could redefine
 // values, which wouldn't be visible if not in DOM list
 // This isn't possible anymore thanks to SSA
+// Calls to pure functions (see mod-ref.hh) are numbered like any other
+// instruction, other calls are never merged
 //
 // Dominator-based Value Numbering - Engineer a Compiler p566
 void dvnt_run(Module &mod);
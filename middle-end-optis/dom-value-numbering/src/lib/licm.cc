@@ -0,0 +1,185 @@
+#include "licm.hh"
+
+#include <algorithm>
+#include <iostream>
+#include <set>
+#include <vector>
+
+#include "cfg.hh"
+#include "idom.hh"
+#include "loop-info.hh"
+#include "mod-ref.hh"
+
+namespace {
+
+class LICM {
+
+public:
+  LICM(Function &fun, const ModRef &modref) : _fun(fun), _modref(modref) {}
+
+  void run() {
+    {
+      // Adding a preheader only changes the preds of its header, the CFG is
+      // still valid for the other loops
+      CFG cfg(_fun);
+      IDom idom(_fun, cfg);
+      LoopInfo li(_fun, cfg, idom);
+      for (auto loop : li.loops())
+        if (!loop->preheader())
+          _add_preheader(*loop, cfg);
+    }
+
+    CFG cfg(_fun);
+    IDom idom(_fun, cfg);
+    LoopInfo li(_fun, cfg, idom);
+    for (auto loop : li.loops())
+      _hoist(*loop, cfg, idom);
+  }
+
+private:
+  Function &_fun;
+  const ModRef &_modref;
+
+  void _add_preheader(const Loop &loop, const CFG &cfg) {
+    auto &header = loop.header();
+    std::vector<BasicBlock *> outside;
+    for (auto pred : cfg.preds(header))
+      if (!loop.contains(*pred))
+        outside.push_back(pred);
+    if (outside.empty()) // header is the entry block
+      return;
+
+    auto &pre = *_fun.insert_bb(bb_iterator_t(&header),
+                                header.get_name() + "_pre");
+    pre.insert_ins(pre.ins_end(), "b", {&header}, "", isa::IDX_NO);
+    std::cout << "Add preheader " << pre.get_name() << "\n";
+
+    for (auto pred : outside) {
+      auto &br = *(pred->ins_end() - 1);
+      for (std::size_t i = 0; i < br.ops_count(); ++i)
+        if (&br.op(i) == &header)
+          br.set_op(i, pre);
+    }
+
+    std::vector<Instruction *> phis;
+    for (auto &ins : header.ins())
+      if (ins.get_opname() == "phi")
+        phis.push_back(&ins);
+
+    for (auto phi : phis) {
+      // Incoming values from outside are merged in the preheader
+      std::vector<Value *> pre_ops;
+      std::vector<Value *> ops;
+      for (std::size_t i = 0; i < phi->ops_count(); i += 2) {
+        auto &bb = dynamic_cast<BasicBlock &>(phi->op(i));
+        auto &val = phi->op(i + 1);
+        if (loop.contains(bb)) {
+          ops.push_back(&bb);
+          ops.push_back(&val);
+        } else {
+          pre_ops.push_back(&bb);
+          pre_ops.push_back(&val);
+        }
+      }
+
+      if (outside.size() == 1) {
+        for (std::size_t i = 0; i < phi->ops_count(); i += 2)
+          if (&phi->op(i) == outside.front())
+            phi->set_op(i, pre);
+        continue;
+      }
+
+      auto &pre_phi = *pre.insert_ins(pre.ins_begin(), "phi", pre_ops,
+                                     phi->get_name() + "_pre", 1);
+      ops.insert(ops.begin(), {&pre, &pre_phi});
+      auto &new_phi =
+          *header.insert_ins(ins_iterator_t(phi), "phi", ops, "", 1);
+      auto name = phi->get_name();
+      phi->replace_all_uses_with(new_phi);
+      phi->erase_from_parent();
+      new_phi.set_name(name);
+    }
+  }
+
+  void _hoist(const Loop &loop, const CFG &cfg, const IDom &idom) {
+    auto pre = loop.preheader();
+    if (!pre)
+      return;
+
+    // Blocks run on every iteration, and before leaving the loop: they
+    // dominate all latches and all blocks with a succ outside of the loop
+    std::vector<const BasicBlock *> ends(loop.latches().begin(),
+                                         loop.latches().end());
+    for (auto bb : loop.blocks())
+      for (auto succ : cfg.succs(*bb))
+        if (!loop.contains(*succ)) {
+          ends.push_back(bb);
+          break;
+        }
+    std::set<const BasicBlock *> always;
+    for (auto bb : loop.blocks()) {
+      bool dom_all = true;
+      for (auto end : ends) {
+        auto doms = idom.dom(*end);
+        if (std::find(doms.begin(), doms.end(), bb) == doms.end())
+          dom_all = false;
+      }
+      if (dom_all)
+        always.insert(bb);
+    }
+
+    bool writes = false;
+    for (auto bb : loop.blocks())
+      for (auto &ins : bb->ins())
+        if (ins.get_opname() == "call" &&
+            _modref.get(dynamic_cast<Function &>(ins.op(0))).writes)
+          writes = true;
+
+    auto term = pre->ins_end() - 1;
+    for (auto bb : loop.blocks())
+      for (auto it = bb->ins_begin(); it != bb->ins_end();) {
+        auto &ins = *it++;
+        if (!_is_invariant(ins, loop, writes) ||
+            (ins.get_opname() == "call" && !always.count(bb)))
+          continue;
+
+        std::cout << "Hoist to " << pre->get_name() << ": ";
+        ins.dump(std::cout);
+        std::cout << "\n";
+        BasicBlock::ins_move(*bb, ins_iterator_t(&ins), it, *pre, term);
+      }
+  }
+
+  bool _is_invariant(Instruction &ins, const Loop &loop,
+                     bool loop_writes) const {
+    if (!ins.has_def() || ins.get_opname() == "phi")
+      return false;
+
+    std::size_t beg = 0;
+    if (ins.get_opname() == "call") {
+      const auto &sum = _modref.get(dynamic_cast<Function &>(ins.op(0)));
+      if (sum.writes || (sum.reads && loop_writes))
+        return false;
+      beg = 1;
+    }
+
+    for (std::size_t i = beg; i < ins.ops_count(); ++i) {
+      auto def = dynamic_cast<Instruction *>(&ins.op(i));
+      if (def && loop.contains(def->parent()))
+        return false;
+    }
+    return true;
+  }
+};
+
+} // namespace
+
+void licm_run(Module &mod) {
+  ModRef modref(mod);
+  for (auto &fun : mod.fun()) {
+    if (!fun.has_def())
+      continue;
+    LICM licm(fun, modref);
+    licm.run();
+  }
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "module.hh"
+
+// Loop-Invariant Code Motion
+// First, every natural loop gets a preheader: a block with only the header as
+// succ, and that is the only pred of the header outside of the loop. When the
+// header has several preds outside of the loop, its phis are split: the
+// incoming values from outside are merged by a new phi in the preheader.
+//
+// Then loops are visited innermost first, and instructions of each loop in
+// reverse postorder. An instruction is invariant if it has no side effects and
+// all its operands are defined outside of the loop. Invariant instructions are
+// moved to the end of the preheader, so instructions using them can be hoisted
+// too. The preheader of an inner loop is part of the outer one, so the
+// instructions can then be hoisted again out of the outer loop.
+//
+// The ISA has no memory instructions, only calls can access memory (see
+// mod-ref.hh):
+// - calls to pure functions can be hoisted
+// - calls that only read memory are hoisted only if no call in the loop may
+//   write memory
+// - other calls are never moved
+// There is no instruction that can trap, so arithmetic instructions are hoisted
+// even if they're not executed on every iteration. A callee may not terminate
+// or be costly: calls are only hoisted from blocks that dominate all latches
+// and all blocks leaving the loop (run on every iteration).
+//
+// Advanced Compiler Design and Implementation - Muchnick p397
+void licm_run(Module &mod);
@@ -0,0 +1,112 @@
+#include "mod-ref.hh"
+
+#include <unordered_set>
+
+namespace {
+
+const Function &get_callee(const Instruction &ins) {
+  return dynamic_cast<const Function &>(ins.op(0));
+}
+
+} // namespace
+
+ModRef::ModRef(const Module &mod) {
+  _unknown.reads = true;
+  _unknown.writes = true;
+
+  std::unordered_map<const Function *, bool> visited;
+  for (const auto &fun : mod.fun())
+    if (fun.has_def()) {
+      _sums[&fun].escapes.assign(fun.args_count(), false);
+      _build_order(fun, visited);
+    }
+
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (auto fun : _order)
+      changed |= _update(*fun);
+  }
+}
+
+const FunSummary &ModRef::get(const Function &fun) const {
+  auto it = _sums.find(&fun);
+  return it == _sums.end() ? _unknown : it->second;
+}
+
+void ModRef::dump(std::ostream &os) const {
+  for (auto fun : _order) {
+    const auto &sum = get(*fun);
+    os << fun->get_name() << ":";
+    if (sum.pure())
+      os << " pure";
+    if (sum.reads)
+      os << " reads";
+    if (sum.writes)
+      os << " writes";
+    for (std::size_t i = 0; i < sum.escapes.size(); ++i)
+      if (sum.escapes[i])
+        os << " escapes#" << i;
+    os << "\n";
+  }
+}
+
+// Post-order DFS on the call graph
+void ModRef::_build_order(const Function &fun,
+                          std::unordered_map<const Function *, bool> &visited) {
+  if (!visited.emplace(&fun, true).second)
+    return;
+
+  for (const auto &bb : fun.bb())
+    for (const auto &ins : bb.ins())
+      if (ins.get_opname() == "call" && get_callee(ins).has_def())
+        _build_order(get_callee(ins), visited);
+  _order.push_back(&fun);
+}
+
+bool ModRef::_update(const Function &fun) {
+  auto &sum = _sums.at(&fun);
+  auto old = sum;
+
+  for (const auto &bb : fun.bb())
+    for (const auto &ins : bb.ins())
+      if (ins.get_opname() == "call") {
+        const auto &callee = get(get_callee(ins));
+        sum.reads |= callee.reads;
+        sum.writes |= callee.writes;
+      }
+
+  // Follow all values computed from the argument
+  for (std::size_t i = 0; i < fun.args_count(); ++i) {
+    if (sum.escapes[i])
+      continue;
+
+    std::vector<const Value *> wlist{&fun.get_arg(i)};
+    std::unordered_set<const Value *> visited{wlist.back()};
+    while (!wlist.empty() && !sum.escapes[i]) {
+      auto val = wlist.back();
+      wlist.pop_back();
+
+      for (auto user : val->get_users()) {
+        auto &ins = dynamic_cast<const Instruction &>(*user);
+        if (ins.get_opname() == "ret") {
+          sum.escapes[i] = true;
+          break;
+        }
+
+        if (ins.get_opname() == "call") {
+          const auto &callee = get(get_callee(ins));
+          for (std::size_t j = 1; j < ins.ops_count(); ++j)
+            if (&ins.op(j) == val && callee.arg_escapes(j - 1))
+              sum.escapes[i] = true;
+        }
+
+        if (ins.has_def() && visited.insert(&ins).second)
+          wlist.push_back(&ins);
+      }
+    }
+  }
+
+  return sum.reads != old.reads || sum.writes != old.writes ||
+         sum.escapes != old.escapes;
+}
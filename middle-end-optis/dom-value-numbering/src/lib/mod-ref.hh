@@ -0,0 +1,49 @@
+#pragma once
+
+#include <ostream>
+#include <unordered_map>
+#include <vector>
+
+#include "module.hh"
+
+// Side effects summary of a function
+struct FunSummary {
+  bool reads = false;  // may read memory
+  bool writes = false; // may write memory
+  // escapes[i]: argument i may outlive the call (returned, or passed to a
+  // function where it escapes)
+  std::vector<bool> escapes;
+
+  // No side effects: same args gives same result, and the call can be removed
+  // or moved anywhere
+  bool pure() const { return !reads && !writes; }
+
+  bool arg_escapes(std::size_t pos) const {
+    return pos >= escapes.size() || escapes[pos];
+  }
+};
+
+// Interprocedural mod / ref summaries
+// The ISA has no memory instructions, effects come only from calls to
+// functions without a definition, which may do anything.
+// Functions are visited bottom-up on the call graph (callees first), and
+// visited again until nothing changes, to handle recursion.
+class ModRef {
+
+public:
+  ModRef(const Module &mod);
+
+  // Summary of fun, worst case if fun has no definition
+  const FunSummary &get(const Function &fun) const;
+
+  void dump(std::ostream &os) const;
+
+private:
+  std::vector<const Function *> _order; // callees first
+  std::unordered_map<const Function *, FunSummary> _sums;
+  FunSummary _unknown;
+
+  void _build_order(const Function &fun,
+                    std::unordered_map<const Function *, bool> &visited);
+  bool _update(const Function &fun);
+};
@@ -2,20 +2,40 @@
 #include <fstream>
 #include <iostream>
 
+#include "lib/cfg.hh"
 #include "lib/dvnt.hh"
+#include "lib/idom.hh"
+#include "lib/licm.hh"
 #include "lib/loader.hh"
+#include "lib/loop-info.hh"
 #include "lib/module.hh"
 
 int main(int argc, char **argv) {
   if (argc < 2) {
-    std::cerr << "Usage: optime-dom-value-numbering <src-file>" << std::endl;
+    std::cerr
+        << "Usage: optime-dom-value-numbering <src-file> [--loops | --licm]"
+        << std::endl;
     return 1;
   }
 
   auto in_file = argv[1];
   auto mod = load_module(in_file);
 
-  dvnt_run(*mod);
+  if (argc > 2 && !strcmp(argv[2], "--loops")) {
+    for (auto &fun : mod->fun()) {
+      if (!fun.has_def())
+        continue;
+      CFG cfg(fun);
+      IDom idom(fun, cfg);
+      LoopInfo(fun, cfg, idom).dump(std::cout);
+    }
+    return 0;
+  }
+
+  if (argc > 2 && !strcmp(argv[2], "--licm"))
+    licm_run(*mod);
+  else
+    dvnt_run(*mod);
   mod->check();
 
   auto gout = mod2gop(*mod);
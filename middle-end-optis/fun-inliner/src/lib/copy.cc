@@ -31,7 +31,7 @@ void clone_ins(const Instruction &ins, const CloneMap &cm, BasicBlock &out_bb,
     }
   }
 
-  out_bb.insert_ins(insert_point, new_args);
+  out_bb.insert_ins(insert_point, new_args)->comm_eol = ins.comm_eol;
 }
 
 void clone_bb_into(const BasicBlock &bb, BasicBlock &out_bb,
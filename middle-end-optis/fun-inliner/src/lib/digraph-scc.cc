@@ -0,0 +1,96 @@
+#include "digraph-scc.hh"
+
+#include <algorithm>
+#include <utility>
+
+namespace {
+
+constexpr std::size_t IDX_UNDEF = -1;
+
+// Iterative version, to support big graphs
+class Tarjan {
+public:
+  Tarjan(const Digraph &g) : _g(g) {}
+
+  std::vector<std::vector<std::size_t>> run() {
+    _index.assign(_g.v(), IDX_UNDEF);
+    _low.assign(_g.v(), 0);
+    _on_stack.assign(_g.v(), 0);
+    _next_index = 0;
+
+    for (std::size_t u = 0; u < _g.v(); ++u)
+      if (_index[u] == IDX_UNDEF)
+        _visit(u);
+    return _res;
+  }
+
+private:
+  const Digraph &_g;
+  std::vector<std::size_t> _index;
+  std::vector<std::size_t> _low;
+  std::vector<char> _on_stack;
+  std::vector<std::size_t> _stack;
+  std::size_t _next_index;
+  std::vector<std::vector<std::size_t>> _res;
+
+  void _push(std::size_t u) {
+    _index[u] = _low[u] = _next_index++;
+    _stack.push_back(u);
+    _on_stack[u] = 1;
+  }
+
+  void _visit(std::size_t root) {
+    // DFS stack of (vertex, list of succs not visited yet)
+    std::vector<std::pair<std::size_t, std::vector<std::size_t>>> dfs;
+    auto enter = [&](std::size_t u) {
+      _push(u);
+      std::vector<std::size_t> succs;
+      for (auto v : _g.succs(u))
+        succs.push_back(v);
+      std::reverse(succs.begin(), succs.end());
+      dfs.emplace_back(u, std::move(succs));
+    };
+
+    enter(root);
+    while (!dfs.empty()) {
+      auto u = dfs.back().first;
+      auto &succs = dfs.back().second;
+
+      if (!succs.empty()) {
+        auto v = succs.back();
+        succs.pop_back();
+        if (_index[v] == IDX_UNDEF)
+          enter(v);
+        else if (_on_stack[v])
+          _low[u] = std::min(_low[u], _index[v]);
+        continue;
+      }
+
+      // All succs visited, u is the root of a SCC if low == index
+      dfs.pop_back();
+      if (!dfs.empty()) {
+        auto p = dfs.back().first;
+        _low[p] = std::min(_low[p], _low[u]);
+      }
+
+      if (_low[u] != _index[u])
+        continue;
+      std::vector<std::size_t> scc;
+      std::size_t v;
+      do {
+        v = _stack.back();
+        _stack.pop_back();
+        _on_stack[v] = 0;
+        scc.push_back(v);
+      } while (v != u);
+      _res.push_back(scc);
+    }
+  }
+};
+
+} // namespace
+
+std::vector<std::vector<std::size_t>> digraph_scc(const Digraph &g) {
+  Tarjan t(g);
+  return t.run();
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <vector>
+
+#include "digraph.hh"
+
+// Compute the strongly connected components of a digraph
+// Returns the list of SCCs, each a list of vertices
+// SCCs are in reverse topological order: a SCC is listed after all the SCCs
+// reachable from it (eg: for a call graph, callees before callers)
+//
+// Algorithm Tarjan's strongly connected components
+std::vector<std::vector<std::size_t>> digraph_scc(const Digraph &g);
@@ -15,7 +15,7 @@ void find_regs(const Instruction &ins, std::set<std::string> &out_args) {
 
 } // namespace
 
-void inline_call(Instruction &call_site) {
+std::vector<Instruction *> inline_call(Instruction &call_site) {
   // Get call site informations
   PANIC_IF(call_site.args[0] != "call", "invalid ins");
 
@@ -86,8 +86,13 @@ void inline_call(Instruction &call_site) {
 
   // Replace all ret instructions in cloned BBs by a mov into ret reg + branch
   // to bb_after
+  std::vector<Instruction *> new_calls;
   for (auto it = cloned_bb; it != bb_iterator_t(&bb_after); ++it) {
     auto &bb = *it;
+    for (auto &ins : bb.ins())
+      if (ins.args[0] == "call")
+        new_calls.push_back(&ins);
+
     auto &bins = bb.ins().back();
 
     if (bins.args[0] == "ret") {
@@ -100,4 +105,6 @@ void inline_call(Instruction &call_site) {
       }
     }
   }
+
+  return new_calls;
 }
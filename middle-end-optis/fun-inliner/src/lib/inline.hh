@@ -10,4 +10,5 @@
 // - devide call site bb in 2 (before / after call)
 // - replace call to callee by jump to cloned entry block
 // - replace all ret in cloned bbs by jump to after call bb
-void inline_call(Instruction &call_site);
+// Return all call instructions cloned from callee
+std::vector<Instruction *> inline_call(Instruction &call_site);
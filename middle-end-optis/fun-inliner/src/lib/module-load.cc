@@ -4,6 +4,7 @@
 
 #include "isa.hh"
 #include <utils/cli/err.hh>
+#include <utils/str/str.hh>
 
 std::unique_ptr<Module> load_module(const gop::Module &mod) {
   auto res = Module::create();
@@ -35,6 +36,7 @@ std::unique_ptr<Module> load_module(const gop::Module &mod) {
     }
 
     auto ins_it = next_bb->insert_ins(next_bb->ins_end(), ins->args);
+    ins_it->comm_eol = utils::str::trim(ins->comm_eol);
     if (isa::is_branch(*ins_it)) // end of basic block
       next_bb = nullptr;
   }
@@ -67,6 +69,7 @@ gop::Module mod2gop(const Module &mod) {
       for (const auto &ins : bb.ins()) {
 
         auto gins = std::make_unique<gop::Ins>(ins.args);
+        gins->comm_eol = ins.comm_eol;
         if (is_first)
           gins->label_defs = {bb.label()};
 
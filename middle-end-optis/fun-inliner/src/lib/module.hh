@@ -42,6 +42,9 @@ private:
 
 public:
   std::vector<std::string> args;
+
+  // End-of-line comment, used for annotations (eg: call frequency)
+  std::string comm_eol;
 };
 
 inline std::ostream &operator<<(std::ostream &os, const Instruction &ins) {
@@ -1,55 +1,215 @@
 #include "pass_inline.hh"
 
+#include <algorithm>
 #include <cassert>
+#include <cstdlib>
 #include <iostream>
+#include <map>
+#include <queue>
+#include <tuple>
 
 #include "bbmerge.hh"
+#include "digraph-scc.hh"
+#include "digraph.hh"
 #include "inline.hh"
 
 namespace {
 
-// Return the first function call instruction that can be inline, or nullptr if
-// none
-Instruction *find_inlinable(Function &fun) {
-  const auto &mod = fun.parent();
-
-  for (auto &bb : fun.bb())
-    for (auto &ins : bb.ins()) {
-      if (ins.args[0] == "call") {
-        auto name = ins.args[1][0] == '%' ? ins.args[2] : ins.args[1];
-        assert(name[0] == '@');
-        auto callee = mod.get_fun(name.substr(1));
-        assert(callee);
-        if (callee != &fun) // doesn't inline recursive calls
-          return &ins;
-      }
-    }
+// Cost model parameters, in number of instructions
+// Saved by removing the call: call + ret
+constexpr long CALL_COST = 2;
+// Saved for every argument (no need to pass it)
+constexpr long ARG_COST = 1;
+// Extra benefit of a constant argument (can be folded after inlining)
+constexpr long CONST_ARG_BONUS = 3;
+// Inline if callee_size - benefit <= threshold
+constexpr long THRESHOLD = 8;
+// Call sites with freq >= HOT_FREQ get a bigger threshold
+constexpr long HOT_FREQ = 100;
+constexpr long HOT_THRESHOLD = 32;
+// Each function can grow up to max(MIN_GROWTH, GROWTH_PERCENT of its size)
+constexpr long GROWTH_PERCENT = 100;
+constexpr long MIN_GROWTH = 16;
+
+constexpr long FREQ_UNKNOWN = -1;
+
+const std::string &callee_name(const Instruction &ins) {
+  const auto &name = ins.args[1][0] == '%' ? ins.args[2] : ins.args[1];
+  assert(name[0] == '@');
+  return name;
+}
 
-  return nullptr;
+std::vector<std::string> call_args(const Instruction &ins) {
+  std::size_t beg = ins.args[1][0] == '%' ? 3 : 2;
+  return {ins.args.begin() + beg, ins.args.end()};
 }
 
-void run_on_fun(Function &fun) {
+// Execution count of a call site, from the profile annotation (`; <count>`)
+long call_freq(const Instruction &ins) {
+  if (ins.comm_eol.empty())
+    return FREQ_UNKNOWN;
+  return std::atol(ins.comm_eol.c_str());
+}
+
+long fun_size(const Function &fun) {
+  long res = 0;
+  for (const auto &bb : fun.bb())
+    for (auto it = bb.ins_begin(); it != bb.ins_end(); ++it)
+      ++res;
+  return res;
+}
+
+class Inliner {
+public:
+  Inliner(Module &mod) : _mod(mod), _cg(_build_funs()) {}
+
+  void run() {
+    _build_call_graph();
 
-  bool changed = false;
-  (void)changed;
+    // Bottom-up: callees are fully processed before their callers
+    auto sccs = digraph_scc(_cg);
+    for (std::size_t i = 0; i < sccs.size(); ++i)
+      for (auto f : sccs[i])
+        _scc_ids[f] = i;
 
-  for (;;) {
-    Instruction *call_site = find_inlinable(fun);
-    if (!call_site)
-      break;
-    std::cout << "Inlining " << *call_site << " (" << fun.name() << ")\n";
-    inline_call(*call_site);
-    changed = true;
+    for (const auto &scc : sccs)
+      for (auto f : scc)
+        _run_on_fun(*_funs[f]);
   }
 
-  if (changed)
-    bbmerge(fun);
-}
+private:
+  Module &_mod;
+  std::vector<Function *> _funs;
+  std::map<const Function *, std::size_t> _ids;
+  Digraph _cg;
+  std::vector<std::size_t> _scc_ids;
+  std::vector<long> _sizes;
+  // Sum of freqs of all annotated call sites of a function
+  std::vector<long> _entry_freqs;
+
+  std::size_t _build_funs() {
+    for (auto &fun : _mod.fun()) {
+      _ids.emplace(&fun, _funs.size());
+      _funs.push_back(&fun);
+    }
+    return _funs.size();
+  }
+
+  Function &_callee(const Instruction &call) {
+    auto callee = _mod.get_fun(callee_name(call).substr(1));
+    assert(callee);
+    return *callee;
+  }
+
+  void _build_call_graph() {
+    _scc_ids.assign(_funs.size(), 0);
+    _sizes.assign(_funs.size(), 0);
+    _entry_freqs.assign(_funs.size(), 0);
+
+    for (auto caller : _funs) {
+      _sizes[_ids.at(caller)] = fun_size(*caller);
+      for (auto &bb : caller->bb())
+        for (auto &ins : bb.ins()) {
+          if (ins.args[0] != "call")
+            continue;
+          auto callee = _ids.at(&_callee(ins));
+          _cg.add_edge(_ids.at(caller), callee);
+          if (call_freq(ins) != FREQ_UNKNOWN)
+            _entry_freqs[callee] += call_freq(ins);
+        }
+    }
+  }
+
+  void _run_on_fun(Function &fun) {
+    auto id = _ids.at(&fun);
+    long budget = std::max(MIN_GROWTH, _sizes[id] * GROWTH_PERCENT / 100);
+    long growth = 0;
+
+    // Worklist of call sites: hottest first, then in program order
+    std::priority_queue<std::tuple<long, long, Instruction *>> wl;
+    long next_pos = 0;
+    auto push = [&](Instruction &call) {
+      wl.emplace(call_freq(call), -next_pos++, &call);
+    };
+    for (auto &bb : fun.bb())
+      for (auto &ins : bb.ins())
+        if (ins.args[0] == "call")
+          push(ins);
+
+    bool changed = false;
+    while (!wl.empty()) {
+      auto &call = *std::get<2>(wl.top());
+      wl.pop();
+      auto &callee = _callee(call);
+      auto callee_id = _ids.at(&callee);
+      auto freq = call_freq(call);
+
+      // Also checked for call sites cloned from callees
+      if (_scc_ids[callee_id] == _scc_ids[id]) {
+        std::cout << "Not inlining " << call << " (" << fun.name()
+                  << "): recursive call\n";
+        continue;
+      }
+
+      long cost = _cost(call, callee);
+      long threshold = freq == 0 ? 0
+                       : freq >= HOT_FREQ ? HOT_THRESHOLD
+                                          : THRESHOLD;
+      if (cost > threshold) {
+        std::cout << "Not inlining " << call << " (" << fun.name()
+                  << "): cost " << cost << " > " << threshold << "\n";
+        continue;
+      }
+
+      // Callee body replaces the call, and an extra branch is added
+      if (growth + _sizes[callee_id] > budget) {
+        std::cout << "Not inlining " << call << " (" << fun.name()
+                  << "): growth budget exceeded\n";
+        continue;
+      }
+
+      std::cout << "Inlining " << call << " (" << fun.name() << "): cost "
+                << cost << "\n";
+      growth += _sizes[callee_id];
+      for (auto new_call : inline_call(call)) {
+        _scale_freq(*new_call, freq, callee_id);
+        push(*new_call);
+      }
+      changed = true;
+    }
+
+    if (changed)
+      bbmerge(fun);
+    _sizes[id] = fun_size(fun);
+  }
+
+  // Estimated size increase if call is inlined
+  // Negative if inlining makes the code smaller
+  long _cost(const Instruction &call, const Function &callee) const {
+    long res = _sizes[_ids.at(&callee)] - CALL_COST;
+    for (const auto &arg : call_args(call)) {
+      res -= ARG_COST;
+      if (arg[0] != '%')
+        res -= CONST_ARG_BONUS;
+    }
+    return res;
+  }
+
+  // A call cloned from callee is executed freq(call) * freq(site) /
+  // freq(callee) times
+  void _scale_freq(Instruction &call, long site_freq, std::size_t callee) {
+    auto freq = call_freq(call);
+    if (freq == FREQ_UNKNOWN || site_freq == FREQ_UNKNOWN ||
+        _entry_freqs[callee] <= 0)
+      return;
+    call.comm_eol = std::to_string(freq * site_freq / _entry_freqs[callee]);
+  }
+};
 
 } // namespace
 
 void run_inline_pass(Module &mod) {
-  for (auto &fun : mod.fun())
-    run_on_fun(fun);
+  Inliner inliner(mod);
+  inliner.run();
   mod.check();
 }
@@ -5,6 +5,20 @@
 // Analyse all call sites of every function to decide whether to inline it or
 // not
 //
+// Functions are processed bottom-up, in SCC order of the call graph: callees
+// are done before their callers. Calls inside a SCC (recursive calls) are never
+// inlined.
+// Every function keeps a worklist of call sites (hottest first). Call sites
+// cloned from an inlined callee are added to it.
+//
+// Inlining decision uses a cost model:
+// - callee size, minus the call overhead (call, ret, arguments)
+// - constant arguments make inlining more profitable
+// - call frequency, from the profile annotation (eg `call @f ; 100`). Hot
+//   call sites get a bigger threshold, and cold ones (0) are only inlined if
+//   it makes the code smaller
+// - growth budget: each function can only grow by a fraction of its size
+//
 // For functions with inlined call sites, it run another pass to merge basic
 // blocks (because every inline created a jump to a new bb, thay can be fusioned
 // with original caller bb)
@@ -29,7 +29,7 @@ Digraph build_cfg(const IModule &mod) {
       auto wei = parse_weighs(bins);
       assert(wei.size() == 1);
       g.add_edge(bb->id(), mod.get_bb(bins.args[1].substr(1))->id(), wei[0]);
-    } else if (op == "beq") {
+    } else if (op == "beq" || op == "bne") {
       auto wei = parse_weighs(bins);
       assert(wei.size() == 2);
       g.add_edge(bb->id(), mod.get_bb(bins.args[3].substr(1))->id(), wei[0]);
@@ -0,0 +1,218 @@
+#include "ext-tsp.hh"
+
+#include <algorithm>
+#include <cstdint>
+#include <set>
+#include <utility>
+
+#include "layout-eval.hh"
+
+namespace {
+
+constexpr double FALLTHROUGH_WEIGHT = 1.0;
+constexpr double FORWARD_WEIGHT = 0.1;
+constexpr double BACKWARD_WEIGHT = 0.1;
+constexpr double FORWARD_DIST = 1024;
+constexpr double BACKWARD_DIST = 640;
+
+// Biggest chain that can be split to insert another chain in the middle
+constexpr std::size_t MAX_SPLIT = 128;
+
+constexpr double EPS = 1e-9;
+
+double edge_score(std::uint64_t src_end, std::uint64_t dst_beg, int weight) {
+  if (src_end == dst_beg)
+    return weight * FALLTHROUGH_WEIGHT;
+
+  if (dst_beg > src_end) {
+    double d = dst_beg - src_end;
+    return d < FORWARD_DIST ? weight * FORWARD_WEIGHT * (1 - d / FORWARD_DIST)
+                            : 0;
+  }
+
+  double d = src_end - dst_beg;
+  return d < BACKWARD_DIST ? weight * BACKWARD_WEIGHT * (1 - d / BACKWARD_DIST)
+                           : 0;
+}
+
+using chain_t = std::vector<std::size_t>;
+
+class ExtTSP {
+public:
+  ExtTSP(const IModule &mod, const Digraph &cfg)
+      : _mod(mod), _entry(mod.get_entry_bb().id()), _size(cfg.v(), 0),
+        _count(cfg.v(), 0), _succs(cfg.v()), _addr(cfg.v(), 0),
+        _mark(cfg.v(), 0), _stamp(0) {
+    std::vector<long> in(cfg.v(), 0);
+    std::vector<long> out(cfg.v(), 0);
+    for (std::size_t u = 0; u < cfg.v(); ++u) {
+      for (const auto &ins : mod.get_bb(u)->ins())
+        _size[u] += ins_size(ins);
+
+      for (auto it = cfg.adj_begin(u); it != cfg.adj_end(u); ++it) {
+        auto e = *it;
+        if (e.v == e.w || e.weight <= 0)
+          continue;
+        _succs[u].emplace_back(e.w, e.weight);
+        out[u] += e.weight;
+        in[e.w] += e.weight;
+      }
+    }
+
+    for (std::size_t u = 0; u < cfg.v(); ++u)
+      _count[u] = std::max(in[u], out[u]);
+  }
+
+  std::vector<const BasicBlock *> run() {
+    auto n = _size.size();
+    for (std::size_t u = 0; u < n; ++u) {
+      _chains.push_back({u});
+      _chains_score.push_back(0);
+      _chain_of.push_back(u);
+    }
+
+    while (_merge_best())
+      continue;
+
+    // Entry chain first, then by decreasing density
+    std::vector<std::size_t> ids;
+    std::vector<double> density(n, 0);
+    for (std::size_t c = 0; c < n; ++c) {
+      if (_chains[c].empty())
+        continue;
+      ids.push_back(c);
+      double count = 0;
+      double size = 0;
+      for (auto u : _chains[c]) {
+        count += _count[u];
+        size += _size[u];
+      }
+      density[c] = count / std::max(size, 1.0);
+    }
+
+    auto entry_chain = _chain_of[_entry];
+    std::stable_sort(ids.begin(), ids.end(),
+                     [&](std::size_t a, std::size_t b) {
+                       if ((a == entry_chain) != (b == entry_chain))
+                         return a == entry_chain;
+                       return density[a] > density[b];
+                     });
+
+    std::vector<const BasicBlock *> res;
+    for (auto c : ids)
+      for (auto u : _chains[c])
+        res.push_back(_mod.get_bb(u));
+    return res;
+  }
+
+  // Score of a sequence of blocks, only edges inside the sequence are counted
+  double score(const chain_t &seq) {
+    ++_stamp;
+    std::uint64_t addr = 0;
+    for (auto u : seq) {
+      _mark[u] = _stamp;
+      _addr[u] = addr;
+      addr += _size[u];
+    }
+
+    double res = 0;
+    for (auto u : seq)
+      for (const auto &succ : _succs[u])
+        if (_mark[succ.first] == _stamp)
+          res += edge_score(_addr[u] + _size[u], _addr[succ.first],
+                            succ.second);
+    return res;
+  }
+
+private:
+  const IModule &_mod;
+  std::size_t _entry;
+  std::vector<std::uint64_t> _size;
+  std::vector<long> _count;
+  std::vector<std::vector<std::pair<std::size_t, int>>> _succs;
+
+  // Merged chains are left empty
+  std::vector<chain_t> _chains;
+  std::vector<double> _chains_score;
+  std::vector<std::size_t> _chain_of;
+
+  // Used by score()
+  std::vector<std::uint64_t> _addr;
+  std::vector<std::size_t> _mark;
+  std::size_t _stamp;
+
+  // Find and apply the merge with the best gain
+  // Returns false if there is none
+  bool _merge_best() {
+    std::set<std::pair<std::size_t, std::size_t>> pairs;
+    for (std::size_t u = 0; u < _succs.size(); ++u)
+      for (const auto &succ : _succs[u]) {
+        auto x = _chain_of[u];
+        auto y = _chain_of[succ.first];
+        if (x != y)
+          pairs.emplace(std::min(x, y), std::max(x, y));
+      }
+
+    double best_gain = EPS;
+    std::size_t best_x = 0;
+    std::size_t best_y = 0;
+    chain_t best_seq;
+    for (const auto &p : pairs)
+      for (auto xy : {p, std::make_pair(p.second, p.first)}) {
+        const auto &x = _chains[xy.first];
+        const auto &y = _chains[xy.second];
+        auto base = _chains_score[xy.first] + _chains_score[xy.second];
+
+        // Try x[0:k] + y + x[k:], for k = |x| this is x + y
+        auto k_beg = x.size() <= MAX_SPLIT ? 1 : x.size();
+        for (auto k = k_beg; k <= x.size(); ++k) {
+          chain_t seq(x.begin(), x.begin() + k);
+          seq.insert(seq.end(), y.begin(), y.end());
+          seq.insert(seq.end(), x.begin() + k, x.end());
+          if (!_valid(seq))
+            continue;
+
+          auto gain = score(seq) - base;
+          if (gain > best_gain) {
+            best_gain = gain;
+            best_x = xy.first;
+            best_y = xy.second;
+            best_seq = std::move(seq);
+          }
+        }
+      }
+
+    if (best_seq.empty())
+      return false;
+
+    for (auto u : _chains[best_y])
+      _chain_of[u] = best_x;
+    _chains[best_y].clear();
+    _chains[best_x] = std::move(best_seq);
+    _chains_score[best_x] = score(_chains[best_x]);
+    return true;
+  }
+
+  // The entry block must stay at the beginning
+  bool _valid(const chain_t &seq) const {
+    return seq.front() == _entry ||
+           std::find(seq.begin(), seq.end(), _entry) == seq.end();
+  }
+};
+
+} // namespace
+
+std::vector<const BasicBlock *> ext_tsp_order(const IModule &mod,
+                                              const Digraph &cfg) {
+  ExtTSP tsp(mod, cfg);
+  return tsp.run();
+}
+
+double ext_tsp_score(const IModule &mod, const Digraph &cfg,
+                     const std::vector<const BasicBlock *> &order) {
+  ExtTSP tsp(mod, cfg);
+  chain_t seq;
+  for (auto bb : order)
+    seq.push_back(bb->id());
+  return tsp.score(seq);
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <vector>
+
+#include "digraph.hh"
+#include "imodule.hh"
+
+// Ext-TSP block layout
+// Instead of only counting fall-throughs, the layout is scored by the
+// Extended TSP objective: every CFG edge u -> v with weight w adds
+// - w * 1 if v is right after u (fall-through)
+// - w * 0.1 * (1 - d / 1024) for a forward jump of d bytes (d < 1024)
+// - w * 0.1 * (1 - d / 640) for a backward jump of d bytes (d < 640)
+// Short jumps are still cheaper than long ones (cache / prefetch).
+// Block sizes come from ins_size() (see layout-eval.hh).
+//
+// Start with one chain per block, and repeatedly merge the 2 chains connected
+// by an edge with the best score gain. A merge can concatenate the chains in
+// both orders, or insert one chain in the middle of the other (when it's
+// small enough). Stop when no merge increases the score.
+// Chains are then ordered by decreasing density (execution count per byte),
+// the entry block is always first.
+//
+// Improved Basic Block Reordering - Newell & Pupyrev
+std::vector<const BasicBlock *> ext_tsp_order(const IModule &mod,
+                                              const Digraph &cfg);
+
+// Ext-TSP score of a blocks layout
+double ext_tsp_score(const IModule &mod, const Digraph &cfg,
+                     const std::vector<const BasicBlock *> &order);
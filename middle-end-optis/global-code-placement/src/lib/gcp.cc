@@ -7,16 +7,25 @@
 #include <queue>
 #include <set>
 
+#include <utils/str/str.hh>
+
 #include "cfg.hh"
+#include "ext-tsp.hh"
 
 namespace {
 
+constexpr std::size_t IDX_NO = -1;
+
+// A block is cold if it's executed in less than COLD_PERCENT % of the
+// function calls
+constexpr long COLD_PERCENT = 5;
+
 class GCP {
 
 public:
   GCP(IModule &mod) : _mod(mod), _cfg(build_cfg(mod)) {}
 
-  void run() {
+  void run(bool ext_tsp, bool split) {
     // Step 1 build CFG
     std::ofstream ofs("out.dot");
     _cfg.dump_tree(ofs);
@@ -25,10 +34,10 @@ public:
     for (std::size_t u = 0; u < _cfg.v(); ++u)
       for (auto it = _cfg.adj_begin(u); it != _cfg.adj_end(u); ++it)
         _edges.push_back(*it);
-    std::sort(_edges.begin(), _edges.end(),
-              [this](const Digraph::edge_t &a, const Digraph::edge_t &b) {
-                return a.weight > b.weight;
-              });
+    std::stable_sort(_edges.begin(), _edges.end(),
+                     [](const Digraph::edge_t &a, const Digraph::edge_t &b) {
+                       return a.weight > b.weight;
+                     });
 
     // Step 3 build hot paths
     _build_hots_paths();
@@ -37,7 +46,29 @@ public:
     // Step 4 compute new bbs order
     _reorder_bbs();
 
+    // Compare with Ext-TSP, and keep the one asked
+    auto tsp_order = ext_tsp_order(_mod, _cfg);
+    std::cout << "expected taken branches:\n"
+              << "  greedy: " << _taken_count(_new_order)
+              << " (ext-tsp score = " << ext_tsp_score(_mod, _cfg, _new_order)
+              << ")\n"
+              << "  ext-tsp: " << _taken_count(tsp_order)
+              << " (ext-tsp score = " << ext_tsp_score(_mod, _cfg, tsp_order)
+              << ")\n\n";
+    if (ext_tsp)
+      _new_order = tsp_order;
+
+    // Step 5 move cold blocks to the cold section
+    auto cold_begin = _new_order.size();
+    if (split) {
+      cold_begin = _split_cold();
+      std::cout << "expected taken branches after split: "
+                << _taken_count(_new_order, cold_begin) << "\n\n";
+    }
+
     _mod.bb_order_change(_new_order);
+    _mod.set_bb_cold_begin(cold_begin);
+    _invert_branches();
     _mod.check();
   }
 
@@ -47,17 +78,31 @@ private:
   IModule &_mod;
   Digraph _cfg;
   std::vector<Digraph::edge_t> _edges;
-  std::vector<chain_t> _hots_paths;
-  std::vector<std::size_t> _hot_paths_prio;
   std::vector<const BasicBlock *> _new_order;
 
-  // return index of the chain where bb is
-  std::size_t _find_chain(const BasicBlock *bb) {
-    for (std::size_t i = 0; i < _hots_paths.size(); ++i)
-      if (std::find(_hots_paths[i].begin(), _hots_paths[i].end(), bb) !=
-          _hots_paths[i].end())
-        return i;
-    assert(0);
+  // Union-find of the chains (indexed by bb id)
+  // _head, _tail and _prio are only valid for roots
+  // _next is the next bb in its chain
+  std::vector<std::size_t> _parent;
+  std::vector<std::size_t> _head;
+  std::vector<std::size_t> _tail;
+  std::vector<std::size_t> _next;
+  std::vector<std::size_t> _prio;
+
+  // return the root of the chain where bb is
+  std::size_t _find_chain(std::size_t bb) {
+    while (_parent[bb] != bb) {
+      _parent[bb] = _parent[_parent[bb]];
+      bb = _parent[bb];
+    }
+    return bb;
+  }
+
+  chain_t _chain(std::size_t root) const {
+    chain_t res;
+    for (auto bb = _head[root]; bb != IDX_NO; bb = _next[bb])
+      res.push_back(_mod.get_bb(bb));
+    return res;
   }
 
   // Build hot paths
@@ -68,36 +113,31 @@ private:
   void _build_hots_paths() {
     // Initialize hot_paths with e chains of size 1, each containing 1 block
     // with max priority
-    std::size_t max_p = _edges.size();
-    for (auto bb : _mod.bb_list()) {
-      _hots_paths.push_back({bb});
-      _hot_paths_prio.push_back(max_p);
-    }
+    auto n = _mod.bb_count();
+    _parent.resize(n);
+    _head.resize(n);
+    _tail.resize(n);
+    _next.assign(n, IDX_NO);
+    _prio.assign(n, _edges.size());
+    for (std::size_t i = 0; i < n; ++i)
+      _parent[i] = _head[i] = _tail[i] = i;
 
     std::size_t p = 0;
     for (const auto &edge : _edges) {
-      if (edge.v == edge.w) // ignore self-loops
-        continue;
-
-      auto bb_v = _mod.get_bb(edge.v);
-      auto bb_w = _mod.get_bb(edge.w);
-      auto chain_v = _find_chain(bb_v);
-      auto chain_w = _find_chain(bb_w);
-      if (_hots_paths[chain_v].back() != bb_v ||
-          _hots_paths[chain_w].front() != bb_w) // cannot be merged
+      auto chain_v = _find_chain(edge.v);
+      auto chain_w = _find_chain(edge.w);
+      if (chain_v == chain_w || _tail[chain_v] != edge.v ||
+          _head[chain_w] != edge.w) // cannot be merged (or self-loop)
         continue;
 
       // prio[v] = min(p, prio[v], prio[w])
-      std::size_t prio = std::min(
-          p++, std::min(_hot_paths_prio[chain_v], _hot_paths_prio[chain_w]));
-      _hot_paths_prio[chain_v] = prio;
-      _hot_paths_prio.erase(_hot_paths_prio.begin() + chain_w);
+      _prio[chain_v] =
+          std::min(p++, std::min(_prio[chain_v], _prio[chain_w]));
 
       // chain[v] += chain[w]
-      _hots_paths[chain_v].insert(_hots_paths[chain_v].end(),
-                                  _hots_paths[chain_w].begin(),
-                                  _hots_paths[chain_w].end());
-      _hots_paths.erase(_hots_paths.begin() + chain_w);
+      _next[_tail[chain_v]] = _head[chain_w];
+      _tail[chain_v] = _tail[chain_w];
+      _parent[chain_w] = chain_v;
     }
   }
 
@@ -108,35 +148,106 @@ private:
   // The chain order is heuristic
   void _reorder_bbs() {
     auto cmp_fn = [this](std::size_t c1, std::size_t c2) {
-      return _hot_paths_prio[c1] > _hot_paths_prio[c2];
+      return _prio[c1] > _prio[c2];
     };
     std::priority_queue<std::size_t, std::vector<std::size_t>, decltype(cmp_fn)>
         work(cmp_fn);
 
-    std::set<std::size_t> visited; // chains already added to queue
+    std::vector<char> visited(_mod.bb_count(), 0); // chains added to queue
 
-    auto echain = _find_chain(&_mod.get_entry_bb());
+    auto echain = _find_chain(_mod.get_entry_bb().id());
     work.push(echain);
-    visited.insert(echain);
+    visited[echain] = 1;
 
     while (!work.empty()) {
       std::size_t cid = work.top();
       work.pop();
-      const auto &chain = _hots_paths[cid];
-      for (auto bb : chain)
-        _new_order.push_back(bb);
-
-      for (auto bb : chain)
-        for (auto it = _cfg.adj_begin(bb->id()); it != _cfg.adj_end(bb->id());
-             ++it) {
-          auto next_bb = _mod.get_bb((*it).w);
-          auto cnext = _find_chain(next_bb);
-          if (visited.insert(cnext).second)
+      for (auto bb = _head[cid]; bb != IDX_NO; bb = _next[bb])
+        _new_order.push_back(_mod.get_bb(bb));
+
+      for (auto bb = _head[cid]; bb != IDX_NO; bb = _next[bb])
+        for (auto it = _cfg.adj_begin(bb); it != _cfg.adj_end(bb); ++it) {
+          auto cnext = _find_chain((*it).w);
+          if (!visited[cnext]) {
+            visited[cnext] = 1;
             work.push(cnext);
+          }
         }
     }
   }
 
+  // Sum of the weights of the edges that don't go to the next block
+  // The last hot block and the first cold block aren't next to each other
+  long _taken_count(const std::vector<const BasicBlock *> &order,
+                    std::size_t cold_begin = IDX_NO) const {
+    std::vector<std::size_t> pos(_mod.bb_count(), IDX_NO);
+    for (std::size_t i = 0; i < order.size(); ++i)
+      pos[order[i]->id()] = i;
+
+    long res = 0;
+    for (const auto &e : _edges)
+      if (pos[e.w] != pos[e.v] + 1 || pos[e.w] == cold_begin)
+        res += e.weight;
+    return res;
+  }
+
+  // Move all cold blocks at the end of _new_order (keeping their order)
+  // The execution count of a block is the max of its in / out edges weights
+  // Returns the position of the first cold block
+  std::size_t _split_cold() {
+    std::vector<long> in(_mod.bb_count(), 0);
+    std::vector<long> out(_mod.bb_count(), 0);
+    for (const auto &e : _edges) {
+      out[e.v] += e.weight;
+      in[e.w] += e.weight;
+    }
+
+    auto entry = _mod.get_entry_bb().id();
+    auto calls = std::max(in[entry], out[entry]);
+    if (calls == 0) // no profile
+      return _new_order.size();
+
+    std::vector<const BasicBlock *> hot;
+    std::vector<const BasicBlock *> cold;
+    for (auto bb : _new_order) {
+      auto count = std::max(in[bb->id()], out[bb->id()]);
+      if (bb->id() != entry && count * 100 < calls * COLD_PERCENT)
+        cold.push_back(bb);
+      else
+        hot.push_back(bb);
+    }
+
+    std::cout << "cold blocks: ";
+    _dump_chain(cold);
+    std::cout << "\n";
+
+    _new_order = hot;
+    _new_order.insert(_new_order.end(), cold.begin(), cold.end());
+    return hot.size();
+  }
+
+  // beq / bne: the second target is the fall-through
+  // When the first one is the next block, invert the condition
+  void _invert_branches() {
+    auto order = _mod.bb_list();
+    for (std::size_t i = 0; i + 1 < order.size(); ++i) {
+      if (i + 1 == _mod.bb_cold_begin())
+        continue;
+      auto &ins = order[i]->ins().back();
+      const auto &op = ins.args[0];
+      if ((op != "beq" && op != "bne") ||
+          ins.args[3].substr(1) != order[i + 1]->label() ||
+          ins.args[4] == ins.args[3])
+        continue;
+
+      ins.args[0] = op == "beq" ? "bne" : "beq";
+      std::swap(ins.args[3], ins.args[4]);
+      auto wei = utils::str::split(utils::str::trim(ins.comm_eol), ' ');
+      if (wei.size() == 2)
+        ins.comm_eol = wei[1] + " " + wei[0];
+    }
+  }
+
   void _dump_chain(const chain_t &chain) {
     std::cout << "{";
     for (std::size_t i = 0; i < chain.size(); ++i) {
@@ -149,9 +260,12 @@ private:
 
   void _dump_hots_paths() {
     std::cout << "hots paths:\n";
-    for (std::size_t i = 0; i < _hots_paths.size(); ++i) {
-      _dump_chain(_hots_paths[i]);
-      std::cout << "; P = " << _hot_paths_prio[i] << "\n";
+    for (auto bb : _mod.bb_list()) {
+      auto root = _find_chain(bb->id());
+      if (_head[root] != bb->id())
+        continue;
+      _dump_chain(_chain(root));
+      std::cout << "; P = " << _prio[root] << "\n";
     }
     std::cout << "\n";
   }
@@ -159,7 +273,7 @@ private:
 
 } // namespace
 
-void gcp_run(IModule &mod) {
+void gcp_run(IModule &mod, bool ext_tsp, bool split) {
   GCP gcp(mod);
-  gcp.run();
+  gcp.run(ext_tsp, split);
 }
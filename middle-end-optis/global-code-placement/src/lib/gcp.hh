@@ -16,6 +16,16 @@
 // in CFG) was taken for an execution.
 // The information is stored in comment line of the branch in IR files.
 // The algorithms used to reorder BBs are rather heuristic
+// Chains are stored in a union-find, with their head / tail blocks.
+//
+// With ext_tsp = true, the layout from ext_tsp_order() is used instead (see
+// ext-tsp.hh). The expected number of taken branches of both layouts is
+// printed.
+// With split = true, cold blocks (rarely executed according to the profile)
+// are moved to the cold section of the module (see IModule::bb_cold_begin()),
+// so they don't take room in the cache lines of the hot code.
+// After reordering, beq / bne are inverted when needed so that the next block
+// is the fall-through (second) target.
 //
 // Algorithm Global Code Placement - Engineer a Compiler p451
-void gcp_run(IModule &mod);
+void gcp_run(IModule &mod, bool ext_tsp = false, bool split = false);
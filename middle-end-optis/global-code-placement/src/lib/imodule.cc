@@ -9,8 +9,8 @@ namespace {
 
 bool is_branch(const Ins &ins) {
   const auto &opname = ins.args[0];
-  return opname == "b" || opname == "beq" || opname == "ret" ||
-         opname == "tern";
+  return opname == "b" || opname == "beq" || opname == "bne" ||
+         opname == "ret" || opname == "tern";
 }
 
 } // namespace
@@ -28,19 +28,21 @@ void BasicBlock::check() const {
     const auto &op = ins.args[0];
     if (op == "b")
       PANIC_IF(!_mod.get_bb(ins.args[1].substr(1)), "b: invalid label name");
-    else if (op == "beq") {
+    else if (op == "beq" || op == "bne") {
       PANIC_IF(!_mod.get_bb(ins.args[3].substr(1)) ||
                    !_mod.get_bb(ins.args[4].substr(1)),
-               "beq: invalid label name");
+               op + ": invalid label name");
     }
   }
 }
 
-IModule::IModule() : _bb_entry(nullptr), _bb_next_id(0) {}
+IModule::IModule()
+    : _bb_entry(nullptr), _bb_next_id(0), _bb_cold_begin(-1) {}
 
 void IModule::check() const {
   PANIC_IF(_bb_entry == nullptr, "Entry BB not set");
   PANIC_IF(_bb_entry->_order != 0, "Entry BB must be the first");
+  PANIC_IF(bb_cold_begin() == 0, "Entry BB must not be cold");
   for (const auto &bb : _bbs_list)
     bb->check();
 }
@@ -131,6 +133,10 @@ std::unique_ptr<IModule> mod2imod(const Module &mod) {
         res->set_entry_bb(*next_bb);
     }
 
+    for (std::size_t i = 1; i < ins.label_defs.size(); ++i)
+      if (ins.label_defs[i] == COLD_LABEL)
+        res->set_bb_cold_begin(res->bb_count() - 1);
+
     ins.label_defs.clear();
     next_bb->ins().push_back(ins);
 
@@ -146,13 +152,19 @@ std::unique_ptr<IModule> mod2imod(const Module &mod) {
 
 Module imod2mod(const IModule &mod) {
   Module res;
-  for (const auto &bb : mod.bb_list()) {
+  auto bbs = mod.bb_list();
+  for (std::size_t i = 0; i < bbs.size(); ++i) {
+    auto bb = bbs[i];
     auto first =
         res.code.insert(res.code.end(), bb->ins().begin(), bb->ins().end());
     first->label_defs = {bb->label()};
 
     std::size_t first_idx = &*first - &res.code[0];
     res.labels.emplace(bb->label(), first_idx);
+    if (i == mod.bb_cold_begin()) {
+      first->label_defs.push_back(COLD_LABEL);
+      res.labels.emplace(COLD_LABEL, first_idx);
+    }
   }
 
   return res;
@@ -105,14 +105,27 @@ public:
   // Swawp order of 2 basic blocks
   void bb_order_swap(const BasicBlock *b1, const BasicBlock *b2);
 
+  // Basic blocks from this position in the order are in the cold section,
+  // layed out far from the others
+  // Returns bb_count() if there is no cold section
+  std::size_t bb_cold_begin() const {
+    return _bb_cold_begin < bb_count() ? _bb_cold_begin : bb_count();
+  }
+  void set_bb_cold_begin(std::size_t pos) { _bb_cold_begin = pos; }
+
 private:
   std::vector<std::unique_ptr<BasicBlock>> _bbs_list;
   BasicBlock *_bb_entry;
   bb_id_t _bb_next_id;
+  std::size_t _bb_cold_begin;
   std::map<bb_id_t, BasicBlock *> _bbs_idsm;
   std::map<std::string, BasicBlock *> _bbs_labelsm;
 };
 
+// Label of the beginning of the cold section
+// Added after the label of the first cold basic block
+constexpr const char *COLD_LABEL = ".cold";
+
 // Build a IModule given classic module
 // Divide body into sequence of basic blocks
 // Check if all basic blocks are well formed
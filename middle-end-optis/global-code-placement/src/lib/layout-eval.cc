@@ -0,0 +1,115 @@
+#include "layout-eval.hh"
+
+#include <fstream>
+#include <vector>
+
+#include <utils/cli/err.hh>
+#include <utils/str/str.hh>
+
+#include "cfg.hh"
+
+namespace {
+
+// Address of the cold section
+constexpr std::uint64_t COLD_SECTION_ADDR = 0x10000;
+
+class LayoutEval {
+public:
+  LayoutEval(const IModule &mod, const ICacheConfig &conf)
+      : _mod(mod), _sim(conf), _beg(mod.bb_count()), _end(mod.bb_count()) {
+    std::uint64_t addr = 0;
+    auto bbs = mod.bb_list();
+    for (std::size_t i = 0; i < bbs.size(); ++i) {
+      auto bb = bbs[i];
+      if (i == mod.bb_cold_begin())
+        addr = COLD_SECTION_ADDR;
+      _beg[bb->id()] = addr;
+      for (const auto &ins : bb->ins())
+        addr += ins_size(ins);
+      _end[bb->id()] = addr;
+    }
+  }
+
+  void replay_counts() {
+    auto cfg = build_cfg(_mod);
+    std::vector<std::vector<Digraph::edge_t>> succs(cfg.v());
+    for (std::size_t u = 0; u < cfg.v(); ++u)
+      for (auto it = cfg.adj_begin(u); it != cfg.adj_end(u); ++it)
+        if ((*it).weight > 0)
+          succs[u].push_back(*it);
+
+    auto entry = _mod.get_entry_bb().id();
+    do {
+      auto bb = entry;
+      for (;;) {
+        _run(bb);
+        Digraph::edge_t *next = nullptr;
+        for (auto &e : succs[bb])
+          if (e.weight > 0 && (!next || e.weight > next->weight))
+            next = &e;
+        if (!next)
+          break;
+        --next->weight;
+        bb = next->w;
+      }
+    } while (_has_left(succs[entry]));
+  }
+
+  void replay_trace(std::istream &is) {
+    std::string line;
+    while (std::getline(is, line)) {
+      line = utils::str::trim(line);
+      if (line.empty() || line[0] == '#')
+        continue;
+
+      auto bb = _mod.get_bb(line);
+      PANIC_IF(!bb, "trace: unknown basic block " + line);
+      _run(bb->id());
+    }
+  }
+
+  const ICacheStats &stats() const { return _sim.stats(); }
+
+private:
+  const IModule &_mod;
+  ICacheSim _sim;
+  // Address range of every basic block, by id
+  std::vector<std::uint64_t> _beg;
+  std::vector<std::uint64_t> _end;
+
+  void _run(bb_id_t bb) { _sim.run(_beg[bb], _end[bb]); }
+
+  static bool _has_left(const std::vector<Digraph::edge_t> &edges) {
+    for (const auto &e : edges)
+      if (e.weight > 0)
+        return true;
+    return false;
+  }
+};
+
+} // namespace
+
+std::size_t ins_size(const Ins &ins) {
+  const auto &op = ins.args[0];
+  if (op == "ret")
+    return 1;
+  else if (op == "b")
+    return 2;
+  else if (op == "tern")
+    return 6;
+  else
+    return 4;
+}
+
+ICacheStats eval_layout(const IModule &mod, const ICacheConfig &conf,
+                        const std::string &trace_path) {
+  LayoutEval eval(mod, conf);
+  if (trace_path.empty())
+    eval.replay_counts();
+  else {
+    std::ifstream is(trace_path);
+    PANIC_IF(!is.good(), "Failed to open trace file " + trace_path);
+    eval.replay_trace(is);
+  }
+  return eval.stats();
+}
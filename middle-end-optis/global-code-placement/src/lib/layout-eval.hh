@@ -0,0 +1,24 @@
+#pragma once
+
+#include <string>
+
+#include "icache-sim.hh"
+#include "imodule.hh"
+
+// Size in bytes of an instruction
+// Rough model of a variable-length encoding
+std::size_t ins_size(const Ins &ins);
+
+// Score the current order of the basic blocks of mod with ICacheSim
+// Blocks are layed out in order from address 0, and the cold section (if any)
+// from address 0x10000, a block is always fetched entirely.
+// Going to the block right after in the layout is a fall-through, otherwise
+// it's a taken branch. The size of the branches doesn't depend on the layout.
+//
+// If trace_path is empty, the profile counts of the CFG are replayed: walk from
+// the entry, always following the edge with the biggest remaining count, until
+// there is none, and start again from the entry until all its edges are used.
+// Otherwise, trace_path contains the labels of the executed blocks, one per
+// line.
+ICacheStats eval_layout(const IModule &mod, const ICacheConfig &conf,
+                        const std::string &trace_path = "");
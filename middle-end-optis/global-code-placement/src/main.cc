@@ -3,22 +3,61 @@
 #include <iostream>
 
 #include "lib/gcp.hh"
+#include "lib/icache-sim.hh"
 #include "lib/imodule.hh"
+#include "lib/layout-eval.hh"
 #include "lib/module.hh"
 
 int main(int argc, char **argv) {
   if (argc < 2) {
-    std::cerr << "Usage: global-code-placement <src-file>" << std::endl;
+    std::cerr << "Usage: global-code-placement <src-file> [--ext-tsp] [--split] "
+                 "[--eval] "
+                 "[--trace <trace-file>] [--cache <size>:<ways>:<line>] "
+                 "[--tlb <entries>:<ways>:<page>]"
+              << std::endl;
     return 1;
   }
 
   auto in_file = argv[1];
+  bool ext_tsp = false;
+  bool split = false;
+  bool eval = false;
+  std::string trace_path;
+  ICacheConfig conf;
+  for (int i = 2; i < argc; ++i) {
+    if (!strcmp(argv[i], "--ext-tsp"))
+      ext_tsp = true;
+    else if (!strcmp(argv[i], "--split"))
+      split = true;
+    else if (!strcmp(argv[i], "--eval"))
+      eval = true;
+    else if (i + 1 == argc)
+      break;
+    else if (!strcmp(argv[i], "--trace"))
+      trace_path = argv[++i];
+    else if (!strcmp(argv[i], "--cache"))
+      conf.set_cache(argv[++i]);
+    else if (!strcmp(argv[i], "--tlb"))
+      conf.set_tlb(argv[++i]);
+  }
+
   std::ifstream is(in_file);
   auto mod = mod2imod(Module::parse(is));
 
-  gcp_run(*mod);
+  ICacheStats before;
+  if (eval)
+    before = eval_layout(*mod, conf, trace_path);
+
+  gcp_run(*mod, ext_tsp, split);
 
   imod2mod(*mod).dump(std::cout);
 
+  if (eval) {
+    std::cout << "\nlayout before:\n";
+    before.dump(std::cout);
+    std::cout << "layout after:\n";
+    eval_layout(*mod, conf, trace_path).dump(std::cout);
+  }
+
   return 0;
 }
@@ -0,0 +1,131 @@
+#include "call-graph.hh"
+
+#include <algorithm>
+#include <utility>
+
+#include <utils/cli/err.hh>
+
+namespace {
+
+constexpr std::size_t IDX_UNDEF = -1;
+
+} // namespace
+
+CallGraph::CallGraph(Module &mod) {
+  for (auto &fun : mod.fun()) {
+    if (!fun.has_def())
+      continue;
+    _ids.emplace(&fun, _funs.size());
+    _funs.push_back(&fun);
+  }
+
+  _calls.resize(_funs.size());
+  for (std::size_t id = 0; id < _funs.size(); ++id)
+    _scan(id);
+  _build_callers();
+  _build_sccs();
+}
+
+std::size_t CallGraph::id(const Function &fun) const {
+  auto it = _ids.find(&fun);
+  PANIC_IF(it == _ids.end(), "Function " + fun.get_name() + " not in graph");
+  return it->second;
+}
+
+void CallGraph::rebuild(const std::vector<std::size_t> &ids) {
+  for (auto id : ids)
+    _scan(id);
+  _build_callers();
+  _build_sccs();
+}
+
+void CallGraph::_scan(std::size_t id) {
+  auto &calls = _calls[id];
+  calls.clear();
+  for (auto &bb : _funs[id]->bb())
+    for (auto &ins : bb.ins()) {
+      if (ins.get_opname() != "call")
+        continue;
+      auto it = _ids.find(&dynamic_cast<Function &>(ins.op(0)));
+      if (it != _ids.end()) // call to function without definition
+        calls.push_back(Site{&ins, it->second});
+    }
+}
+
+void CallGraph::_build_callers() {
+  _callers.assign(_funs.size(), {});
+  std::vector<std::size_t> last(_funs.size(), IDX_UNDEF);
+  for (std::size_t id = 0; id < _funs.size(); ++id)
+    for (const auto &site : _calls[id])
+      if (last[site.callee] != id) {
+        last[site.callee] = id;
+        _callers[site.callee].push_back(id);
+      }
+}
+
+// Iterative version, to support big call graphs
+void CallGraph::_build_sccs() {
+  auto n = _funs.size();
+  std::vector<std::size_t> index(n, IDX_UNDEF);
+  std::vector<std::size_t> low(n, 0);
+  std::vector<char> on_stack(n, 0);
+  std::vector<std::size_t> stack;
+  std::size_t next_index = 0;
+  _sccs.clear();
+
+  // DFS stack of (function, position of the next call site to visit)
+  std::vector<std::pair<std::size_t, std::size_t>> dfs;
+  auto enter = [&](std::size_t u) {
+    index[u] = low[u] = next_index++;
+    stack.push_back(u);
+    on_stack[u] = 1;
+    dfs.emplace_back(u, 0);
+  };
+
+  for (std::size_t root = 0; root < n; ++root) {
+    if (index[root] != IDX_UNDEF)
+      continue;
+
+    enter(root);
+    while (!dfs.empty()) {
+      auto u = dfs.back().first;
+      auto &pos = dfs.back().second;
+
+      if (pos < _calls[u].size()) {
+        auto v = _calls[u][pos++].callee;
+        if (index[v] == IDX_UNDEF)
+          enter(v);
+        else if (on_stack[v])
+          low[u] = std::min(low[u], index[v]);
+        continue;
+      }
+
+      // All callees visited, u is the root of a SCC if low == index
+      dfs.pop_back();
+      if (!dfs.empty()) {
+        auto p = dfs.back().first;
+        low[p] = std::min(low[p], low[u]);
+      }
+
+      if (low[u] != index[u])
+        continue;
+      std::vector<std::size_t> scc;
+      std::size_t v;
+      do {
+        v = stack.back();
+        stack.pop_back();
+        on_stack[v] = 0;
+        scc.push_back(v);
+      } while (v != u);
+      std::sort(scc.begin(), scc.end());
+      _sccs.push_back(std::move(scc));
+    }
+  }
+
+  // Tarjan finds callees first
+  std::reverse(_sccs.begin(), _sccs.end());
+  _scc_ids.assign(n, 0);
+  for (std::size_t i = 0; i < _sccs.size(); ++i)
+    for (auto id : _sccs[i])
+      _scc_ids[id] = i;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+
+#include "module.hh"
+
+// Call graph of all functions with a definition in a module
+// Functions are identified by a dense id in [0, size()), so that analyses can
+// store their infos in arrays instead of maps.
+// Calls to functions without definition are ignored.
+//
+// The strongly connected components are numbered in topological order:
+// callers come before callees, all functions of a recursive cycle are in the
+// same SCC.
+//
+// Algorithm Tarjan's strongly connected components
+class CallGraph {
+
+public:
+  struct Site {
+    Instruction *ins;
+    std::size_t callee;
+  };
+
+  CallGraph(Module &mod);
+
+  std::size_t size() const { return _funs.size(); }
+
+  Function &fun(std::size_t id) const { return *_funs[id]; }
+
+  // Panic if fun has no definition
+  std::size_t id(const Function &fun) const;
+
+  // Call sites inside function id, in code order
+  const std::vector<Site> &calls(std::size_t id) const { return _calls[id]; }
+
+  // Functions calling id (no duplicates)
+  const std::vector<std::size_t> &callers(std::size_t id) const {
+    return _callers[id];
+  }
+
+  std::size_t sccs_count() const { return _sccs.size(); }
+  std::size_t scc(std::size_t id) const { return _scc_ids[id]; }
+  const std::vector<std::size_t> &scc_funs(std::size_t scc) const {
+    return _sccs[scc];
+  }
+
+  // The body of functions ids changed: find their call sites again, and
+  // update the callers lists / SCCs
+  void rebuild(const std::vector<std::size_t> &ids);
+
+private:
+  std::vector<Function *> _funs;
+  std::unordered_map<const Function *, std::size_t> _ids;
+  std::vector<std::vector<Site>> _calls;
+  std::vector<std::vector<std::size_t>> _callers;
+  std::vector<std::size_t> _scc_ids;
+  std::vector<std::vector<std::size_t>> _sccs;
+
+  void _scan(std::size_t id);
+  void _build_callers();
+  void _build_sccs();
+};
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// Constant folder shared by all constant propagation passes
+// Compute the result of an instruction when all its operands are constants
+// For conditional branches, the result is the condition value (1 if the first
+// target is taken, 0 otherwise)
+// Operands are given without the def register and branch targets
+// Return false if opname cannot be folded (phi, call, ...)
+bool const_fold(const std::string &opname, const std::vector<long> &ops,
+                long &res);
+
+// Return true if const_fold knows how to fold opname
+bool const_foldable(const std::string &opname);
@@ -0,0 +1,41 @@
+#include "fun-clone.hh"
+
+#include <unordered_map>
+
+Function &clone_function(Function &fun, const std::string &name) {
+  assert(fun.has_def());
+  auto &res = fun.parent().add_fun(name, fun.decl());
+  std::unordered_map<const Value *, Value *> vmap;
+  for (std::size_t i = 0; i < fun.args_count(); ++i)
+    vmap.emplace(&fun.get_arg(i), &res.get_arg(i));
+
+  for (auto &bb : fun.bb()) {
+    auto &new_bb = res.add_bb(bb.get_name());
+    vmap.emplace(&bb, &new_bb);
+  }
+  res.set_entry_bb(*dynamic_cast<BasicBlock *>(vmap.at(&fun.get_entry_bb())));
+
+  // First pass: copy instructions with their original operands, because some
+  // of them are not created yet (uses before defs in phis)
+  std::vector<Instruction *> new_ins;
+  for (auto &bb : fun.bb()) {
+    auto &new_bb = *dynamic_cast<BasicBlock *>(vmap.at(&bb));
+    for (auto &ins : bb.ins()) {
+      auto def_idx = isa::def_idx(ins.sargs());
+      auto it = new_bb.insert_ins(new_bb.ins_end(), ins.get_opname(),
+                                  ins.ops(), ins.get_name(), def_idx);
+      vmap.emplace(&ins, &*it);
+      new_ins.push_back(&*it);
+    }
+  }
+
+  // Second pass: fix all uses of local values
+  for (auto ins : new_ins)
+    for (std::size_t i = 0; i < ins->ops_count(); ++i) {
+      auto it = vmap.find(&ins->op(i));
+      if (it != vmap.end())
+        ins->set_op(i, *it->second);
+    }
+
+  return res;
+}
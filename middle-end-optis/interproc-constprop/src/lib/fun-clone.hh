@@ -0,0 +1,9 @@
+#pragma once
+
+#include "module.hh"
+
+// Add to the module of fun a copy of fun called name
+// Same args, basic blocks and instructions (with the same names), all uses of
+// fun args / bbs / instructions are replaced by the ones of the copy
+// Calls to other functions (including fun itself) are kept as is
+Function &clone_function(Function &fun, const std::string &name);
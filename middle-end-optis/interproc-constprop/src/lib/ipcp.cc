@@ -1,243 +1,496 @@
 #include "ipcp.hh"
 
+#include <algorithm>
 #include <iostream>
-#include <memory>
-#include <set>
-#include <vector>
+#include <map>
+#include <unordered_set>
 
-namespace {
-
-enum class EvalTy {
-  TOP,
-  CONST,
-  BOT,
-};
-
-struct Eval {
-  EvalTy ty;
-  int val;
-
-  Eval() : Eval(0) {}
-
-  Eval(EvalTy ty) : ty(ty), val(0) {}
+#include "const-folder.hh"
+#include "fun-clone.hh"
+#include "sparse-dataflow.hh"
 
-  Eval(int val) : ty(EvalTy::CONST), val(val) {}
+namespace {
 
-  bool is_const(int c) const { return ty == EvalTy::CONST && val == c; }
+constexpr std::size_t IDX_UNDEF = -1;
+
+// Specialization budget
+// A cluster of call sites is worth a clone if SCCP on the clone folds at
+// least MIN_BENEFIT more instructions / blocks than on the original function
+constexpr std::size_t MIN_BENEFIT = 2;
+constexpr std::size_t MAX_CLONES = 8;
+// The total size of the clones can't exceed GROWTH_PERCENT of the module size
+// (at least MIN_GROWTH instructions)
+constexpr std::size_t GROWTH_PERCENT = 50;
+constexpr std::size_t MIN_GROWTH = 16;
+
+std::size_t fun_size(const Function &fun) {
+  std::size_t res = 0;
+  for (const auto &bb : fun.bb())
+    for (auto it = bb.ins_begin(); it != bb.ins_end(); ++it)
+      ++res;
+  return res;
+}
 
-  operator int() const {
-    assert(ty == EvalTy::CONST);
-    return val;
+std::string sig_str(const std::vector<std::pair<bool, long>> &sig) {
+  std::string res = "(";
+  for (std::size_t i = 0; i < sig.size(); ++i) {
+    if (i > 0)
+      res += ", ";
+    res += sig[i].first ? std::to_string(sig[i].second) : "_";
   }
+  return res + ")";
+}
 
-  static Eval meet(const Eval &x, const Eval &y) {
-    if (x.ty == EvalTy::BOT || y.ty == EvalTy::BOT)
-      return EvalTy::BOT;
-    if (x.ty == EvalTy::TOP)
-      return y;
-    if (y.ty == EvalTy::TOP)
-      return x;
-
-    if (x.val == y.val)
-      return x;
-    else
-      return EvalTy::BOT;
-  }
-};
+// Run SCCP on fun and simplify its code
+// Return true if the code changed
+bool sccp_simplify(Function &fun) {
+  SparseDataflow<ConstLattice> scc(fun, /*track_exec=*/true);
+  scc.run();
+
+  bool changed = false;
+  for (auto &bb : fun.bb())
+    for (auto &ins : bb.ins()) {
+      long val;
+      if (ins.has_def() && scc.get(ins).get_const(val) &&
+          !ins.get_users().empty())
+        changed = true;
+    }
 
-std::ostream &operator<<(std::ostream &os, const Eval &v) {
-  if (v.ty == EvalTy::TOP)
-    os << "T";
-  else if (v.ty == EvalTy::CONST)
-    os << v.val;
-  else if (v.ty == EvalTy::BOT)
-    os << "B";
-  return os;
+  scc.replace_consts();
+  std::size_t nbranches, nphis, nblocks;
+  scc.remove_dead_code(nbranches, nphis, nblocks);
+  return changed || nbranches || nphis || nblocks;
 }
 
-struct CallSite;
-struct ProcInfos;
+} // namespace
 
-using support_t = std::set<ValueArg *>;
+IPCP::IPCP(Module &mod) : _mod(mod), _cg(mod), _done(false) {
+  auto n = _cg.size();
+  _args_beg.push_back(0);
+  for (std::size_t id = 0; id < n; ++id)
+    _args_beg.push_back(_args_beg.back() + _cg.fun(id).args_count());
+  _args.resize(_args_beg.back());
+  _nodes.resize(n);
+  _roots.resize(n);
+  _dirty.assign(n, 0);
+  _in_wlist.assign(n, 0);
+
+  std::size_t nsites = 0;
+  for (std::size_t id = 0; id < n; ++id)
+    nsites += _cg.calls(id).size();
+  std::cout << "Found " << n << " functions, " << nsites << " call sites and "
+            << _cg.sccs_count() << " SCCs\n";
+}
 
-struct CallSite {
+void IPCP::run() {
+  std::vector<std::size_t> seeds;
+  if (!_done) {
+    // Set all arguments val to an intial start value and add all functions to
+    // the work list
+    for (std::size_t id = 0; id < _cg.size(); ++id) {
+      _init_args(id);
+      _build_jumps(id);
+      seeds.push_back(id);
+    }
+    _done = true;
+    _dump("init");
+  } else
+    seeds = _update();
+
+  // Iteratively update arguments value until fixed point reached
+  // Values only flow from callers to callees, so each SCC is done once all
+  // SCCs before it are done
+  _wlist.assign(_cg.sccs_count(), {});
+  for (auto id : seeds)
+    _push(id);
+  for (auto &wl : _wlist)
+    while (!wl.empty()) {
+      auto id = wl.back();
+      wl.pop_back();
+      _in_wlist[id] = 0;
+      _propagate(id);
+    }
+  _dump("\nfinal");
+}
 
-  ProcInfos &proc;
-  Instruction &ins;
-  std::vector<support_t> supports;
+void IPCP::invalidate(const Function &fun) { _dirty[_cg.id(fun)] = 1; }
 
-  CallSite(ProcInfos &proc, Instruction &ins)
-      : proc(proc), ins(ins), supports(ins.ops_count() - 1) {}
-};
+const ConstLattice &IPCP::arg_value(const Function &fun,
+                                    std::size_t pos) const {
+  auto id = _cg.id(fun);
+  assert(pos < _args_beg[id + 1] - _args_beg[id]);
+  return _args[_args_beg[id] + pos];
+}
 
-struct ProcInfos {
+std::size_t IPCP::apply() {
+  std::size_t res = 0;
+  for (std::size_t id = 0; id < _cg.size(); ++id) {
+    auto &fun = _cg.fun(id);
+    for (std::size_t i = 0; i < fun.args_count(); ++i) {
+      long val;
+      auto &arg = fun.get_arg(i);
+      if (!arg.get_users().empty() &&
+          _args[_args_beg[id] + i].get_const(val)) {
+        arg.replace_all_uses_with(*ValueConst::make(val));
+        ++res;
+      }
+    }
+  }
+  return res;
+}
 
-  Function &fun;
-  std::vector<CallSite *> calls;
-  std::vector<Eval> args;
+void IPCP::_build_jumps(std::size_t id) {
+  _nodes[id].clear();
+  _roots[id].clear();
+  std::unordered_map<const Value *, std::size_t> ids;
+  for (const auto &site : _cg.calls(id)) {
+    std::vector<std::size_t> roots;
+    for (std::size_t i = 1; i < site.ins->ops_count(); ++i)
+      roots.push_back(_build_node(id, ids, site.ins->op(i)));
+    _roots[id].push_back(roots);
+  }
+}
 
-  ProcInfos(Function &fun) : fun(fun) {}
-};
+std::size_t
+IPCP::_build_node(std::size_t id,
+                  std::unordered_map<const Value *, std::size_t> &ids,
+                  const Value &val) {
+  auto &nodes = _nodes[id];
+  auto it = ids.find(&val);
+  if (it != ids.end() && it->second != IDX_UNDEF)
+    return it->second;
+
+  JumpNode node{JumpNode::Ty::BOT, 0, {}, {}};
+  if (it != ids.end()) {
+    // Cycle through phis
+    nodes.push_back(node);
+    return nodes.size() - 1;
+  }
 
-class IPCP {
+  if (auto cval = dynamic_cast<const ValueConst *>(&val)) {
+    node.ty = JumpNode::Ty::CONST;
+    node.val = cval->get_val();
+  } else if (auto arg = dynamic_cast<const ValueArg *>(&val)) {
+    node.ty = JumpNode::Ty::ARG;
+    node.val = arg->get_pos();
+  } else if (auto ins = dynamic_cast<const Instruction *>(&val)) {
+    ids.emplace(&val, IDX_UNDEF);
+    if (ins->get_opname() == "phi") {
+      node.ty = JumpNode::Ty::PHI;
+      for (std::size_t i = 1; i < ins->ops_count(); i += 2)
+        node.ops.push_back(_build_node(id, ids, ins->op(i)));
+    } else if (const_foldable(ins->get_opname()) && !ins->is_branch()) {
+      node.ty = JumpNode::Ty::OP;
+      node.opname = ins->get_opname();
+      for (auto op : ins->ops())
+        node.ops.push_back(_build_node(id, ids, *op));
+    }
+  }
 
-public:
-  IPCP(Module &mod) : _mod(mod) {}
+  nodes.push_back(node);
+  ids[&val] = nodes.size() - 1;
+  return nodes.size() - 1;
+}
 
-  void run() {
+void IPCP::_eval_jumps(std::size_t id) {
+  const auto &nodes = _nodes[id];
+  _nodes_vals.resize(nodes.size());
+  for (std::size_t i = 0; i < nodes.size(); ++i) {
+    const auto &node = nodes[i];
+    auto &res = _nodes_vals[i];
+    switch (node.ty) {
+    case JumpNode::Ty::CONST:
+      res = ConstLattice::make(node.val);
+      break;
+    case JumpNode::Ty::ARG:
+      res = _args[_args_beg[id] + node.val];
+      break;
+    case JumpNode::Ty::OP: {
+      std::vector<ConstLattice> ops;
+      for (auto op : node.ops)
+        ops.push_back(_nodes_vals[op]);
+      res = ConstLattice::eval(node.opname, ops);
+      break;
+    }
+    case JumpNode::Ty::PHI:
+      res = ConstLattice::top();
+      for (auto op : node.ops)
+        res = ConstLattice::meet(res, _nodes_vals[op]);
+      break;
+    case JumpNode::Ty::BOT:
+      res = ConstLattice::bot();
+      break;
+    }
+  }
+}
 
-    // Gather all staic informations about functions and call sites needed
-    // during the algorithm
-    _prepare();
+// Functions never called in the module are entry points
+// Their arguments may have any value
+void IPCP::_init_args(std::size_t id) {
+  auto val =
+      _cg.callers(id).empty() ? ConstLattice::bot() : ConstLattice::top();
+  std::fill(_args.begin() + _args_beg[id], _args.begin() + _args_beg[id + 1],
+            val);
+}
 
-    // Set all arguments val to an intial start value and add all to the work
-    // list
-    _init();
-    _dump("init");
+void IPCP::_push(std::size_t id) {
+  if (_in_wlist[id])
+    return;
+  _in_wlist[id] = 1;
+  _wlist[_cg.scc(id)].push_back(id);
+}
 
-    // Iteratively update arguments value until fixed point reached
-    while (!_wlist.empty()) {
-      auto arg = _wlist.back();
-      _wlist.pop_back();
-      _propagate(arg);
-    }
-    _dump("\nfinal");
-
-    // Update code
-    for (auto &proc : _procs)
-      for (std::size_t i = 0; i < proc->args.size(); ++i)
-        if (proc->args[i].ty == EvalTy::CONST)
-          proc->fun.get_arg(i).replace_all_uses_with(
-              *ValueConst::make(proc->args[i]));
-  }
-
-private:
-  Module &_mod;
-  std::vector<std::unique_ptr<ProcInfos>> _procs;
-  std::vector<std::unique_ptr<CallSite>> _sites;
-  std::map<Function *, ProcInfos *> _procs_map;
-  std::map<ValueArg *, ProcInfos *> _args_map;
-  std::vector<ValueArg *> _wlist;
-
-  void _prepare() {
-    // List all defined functions
-    for (auto &fun : _mod.fun()) {
-      if (!fun.has_def())
+// Evaluate all call sites of function id with the current value of its
+// arguments
+void IPCP::_propagate(std::size_t id) {
+  _eval_jumps(id);
+
+  const auto &calls = _cg.calls(id);
+  for (std::size_t i = 0; i < calls.size(); ++i) {
+    auto callee = calls[i].callee;
+    const auto &roots = _roots[id][i];
+    for (std::size_t j = 0; j < roots.size(); ++j) {
+      auto &arg = _args[_args_beg[callee] + j];
+      auto new_val = ConstLattice::meet(arg, _nodes_vals[roots[j]]);
+      if (arg == new_val)
         continue;
 
-      _procs.push_back(std::make_unique<ProcInfos>(fun));
-      auto proc = _procs.back().get();
-      proc->args.assign(fun.args_count(), EvalTy::TOP);
-      _procs_map.emplace(&fun, proc);
-      for (auto arg : fun.args())
-        _args_map.emplace(arg, proc);
+      std::cout << "Update " << _cg.fun(callee).get_name() << "#" << j << ": "
+                << arg << " => " << new_val << "\n";
+      arg = new_val;
+      _push(callee);
     }
+  }
+}
 
-    // List all call sites to defined functions
-    for (auto &fun : _mod.fun()) {
-      if (!fun.has_def())
-        continue;
-      auto proc = _procs_map.at(&fun);
-
-      for (auto &bb : fun.bb())
-        for (auto &ins : bb.ins()) {
-          if (ins.get_opname() != "call")
-            continue;
-
-          auto &callee = dynamic_cast<Function &>(ins.op(0));
-          auto it = _procs_map.find(&callee);
-          if (it == _procs_map.end()) // call to function without definition
-            continue;
-
-          auto &callee_proc = *it->second;
-          _sites.push_back(std::make_unique<CallSite>(callee_proc, ins));
-          auto site = _sites.back().get();
-          proc->calls.push_back(site);
-          for (std::size_t i = 0; i < callee_proc.fun.args_count(); ++i)
-            _build_support(*site, i);
-        }
+// Incremental run
+// Only the arguments of functions called (transitively) by the changed
+// functions may have a different value, they are computed again from
+// scratch, using all their call sites
+std::vector<std::size_t> IPCP::_update() {
+  auto n = _cg.size();
+  std::vector<std::size_t> changed;
+  for (std::size_t id = 0; id < n; ++id)
+    if (_dirty[id]) {
+      _dirty[id] = 0;
+      changed.push_back(id);
     }
 
-    std::cout << "Found " << _procs.size() << " functions and " << _sites.size()
-              << " call sites\n";
+  // Callees before and after the change
+  std::vector<std::size_t> stack;
+  for (auto id : changed)
+    for (const auto &site : _cg.calls(id))
+      stack.push_back(site.callee);
+  _cg.rebuild(changed);
+  for (auto id : changed) {
+    _build_jumps(id);
+    for (const auto &site : _cg.calls(id))
+      stack.push_back(site.callee);
   }
 
-  void _init() {
-    for (auto &proc : _procs)
-      for (std::size_t i = 0; i < proc->fun.args_count(); ++i) {
-        proc->args[i] = EvalTy::TOP;
-        _wlist.push_back(&proc->fun.get_arg(i));
-      }
+  std::vector<char> reset(n, 0);
+  std::size_t nreset = 0;
+  while (!stack.empty()) {
+    auto id = stack.back();
+    stack.pop_back();
+    if (reset[id])
+      continue;
+    reset[id] = 1;
+    ++nreset;
+    _init_args(id);
+    for (const auto &site : _cg.calls(id))
+      stack.push_back(site.callee);
+  }
 
-    for (auto &site : _sites) {
-      auto &proc = site->proc;
-      for (std::size_t i = 0; i < proc.args.size(); ++i)
-        proc.args[i] =
-            Eval::meet(proc.args[i], _eval_static(site->ins.op(i + 1)));
-    }
+  std::cout << "\nupdate: " << changed.size() << " changed functions, "
+            << nreset << " functions to recompute\n";
+
+  std::vector<std::size_t> res;
+  for (std::size_t id = 0; id < n; ++id)
+    if (reset[id])
+      for (auto caller : _cg.callers(id))
+        res.push_back(caller);
+  return res;
+}
+
+void IPCP::specialize() {
+  std::cout << "\nspecialize:\n";
+  auto clusters = _build_clusters();
+  for (auto &c : clusters) {
+    auto base = _count_folded(c.callee, {});
+    auto spec = _count_folded(c.callee, c.sig);
+    c.benefit = spec > base ? spec - base : 0;
   }
 
-  void _propagate(ValueArg *arg) {
-    auto &proc = *_args_map.at(arg);
+  // Most calls / benefit first
+  std::stable_sort(clusters.begin(), clusters.end(),
+                   [](const Cluster &x, const Cluster &y) {
+                     return x.benefit * x.calls.size() >
+                            y.benefit * y.calls.size();
+                   });
+
+  std::size_t mod_size = 0;
+  for (std::size_t id = 0; id < _cg.size(); ++id)
+    mod_size += fun_size(_cg.fun(id));
+  auto budget = std::max(MIN_GROWTH, mod_size * GROWTH_PERCENT / 100);
+  std::size_t growth = 0;
+  std::size_t nclones = 0;
+
+  for (auto &c : clusters) {
+    auto &fun = _cg.fun(c.callee);
+    auto size = fun_size(fun);
+    std::cout << fun.get_name() << sig_str(c.sig) << ": " << c.calls.size()
+              << " call sites, benefit " << c.benefit << ", size " << size;
+
+    if (c.benefit < MIN_BENEFIT) {
+      std::cout << " => rejected (benefit)\n";
+      continue;
+    }
+    if (nclones == MAX_CLONES || growth + size > budget) {
+      std::cout << " => rejected (budget)\n";
+      continue;
+    }
 
-    for (auto site : proc.calls) {
-      auto &callee = site->proc;
-      for (std::size_t i = 0; i < site->supports.size(); ++i) {
-        if (!site->supports[i].count(arg))
-          continue;
-        auto old_val = callee.args[i];
-        auto new_val = Eval::meet(old_val, _eval_static(site->ins.op(i + 1)));
-        if (old_val.ty != new_val.ty) {
-          callee.args[i] = new_val;
-          _wlist.push_back(&callee.fun.get_arg(i));
+    auto &clone = _clone(c);
+    ++nclones;
+    growth += size;
+    std::cout << " => " << clone.get_name() << "\n";
+  }
+}
 
-          std::cout << "Update " << callee.fun.get_name() << "#" << i << ": "
-                    << old_val << " => " << new_val << "\n";
+// Group call sites by callee and constant arguments
+std::vector<IPCP::Cluster> IPCP::_build_clusters() {
+  std::vector<Cluster> res;
+  std::map<std::pair<std::size_t, sig_t>, std::size_t> ids;
+  for (std::size_t id = 0; id < _cg.size(); ++id) {
+    _eval_jumps(id);
+
+    const auto &calls = _cg.calls(id);
+    for (std::size_t i = 0; i < calls.size(); ++i) {
+      auto callee = calls[i].callee;
+      const auto &roots = _roots[id][i];
+      sig_t sig(roots.size(), {false, 0});
+      bool has_const = false;
+      for (std::size_t j = 0; j < roots.size(); ++j) {
+        long val;
+        if (!_args[_args_beg[callee] + j].is_const() &&
+            _nodes_vals[roots[j]].get_const(val)) {
+          sig[j] = {true, val};
+          has_const = true;
         }
       }
+      if (!has_const)
+        continue;
+
+      auto key = std::make_pair(callee, sig);
+      auto it = ids.find(key);
+      if (it == ids.end()) {
+        it = ids.emplace(key, res.size()).first;
+        res.push_back(Cluster{callee, sig, {}, 0});
+      }
+      res[it->second].calls.push_back(calls[i].ins);
     }
   }
+  return res;
+}
 
-  // Build support set for a parameter value
-  // Trivial support: non-empty only if arg is directly a function parameter
-  void _build_support(CallSite &site, std::size_t arg) {
-    auto &val = site.ins.op(arg + 1);
-    auto arg_val = dynamic_cast<ValueArg *>(&val);
-    if (arg_val)
-      site.supports[arg].insert(arg_val);
+// Number of instructions / blocks that SCCP can fold in function id with the
+// arguments of sig
+std::size_t IPCP::_count_folded(std::size_t id, const sig_t &sig) {
+  auto &fun = _cg.fun(id);
+  SparseDataflow<ConstLattice> scc(fun, /*track_exec=*/true);
+  for (std::size_t i = 0; i < fun.args_count(); ++i)
+    scc.set_arg(i, i < sig.size() && sig[i].first
+                       ? ConstLattice::make(sig[i].second)
+                       : _args[_args_beg[id] + i]);
+  scc.run();
+
+  std::size_t res = 0;
+  for (auto &bb : fun.bb()) {
+    if (!scc.is_executable(bb)) {
+      for (auto it = bb.ins_begin(); it != bb.ins_end(); ++it)
+        ++res;
+      continue;
+    }
+    long val;
+    for (auto &ins : bb.ins())
+      if (ins.has_def() && scc.get(ins).get_const(val))
+        ++res;
   }
+  return res;
+}
 
-  Eval _eval_static(Value &val) {
-    auto vconst = dynamic_cast<ValueConst *>(&val);
-    if (vconst)
-      return vconst->get_val();
-
-    auto arg = dynamic_cast<ValueArg *>(&val);
-    if (!arg)
-      return EvalTy::BOT;
+// Create the clone for cluster c, simplify it, and make all calls of c use it
+Function &IPCP::_clone(const Cluster &c) {
+  auto &fun = _cg.fun(c.callee);
+  auto &clone = clone_function(fun, _clone_name(fun));
 
-    auto &proc = *_args_map.at(arg);
-    std::size_t i;
-    for (i = 0; i < proc.args.size(); ++i)
-      if (&proc.fun.get_arg(i) == arg)
-        break;
-    assert(i != proc.args.size());
-    return proc.args[i];
+  SparseDataflow<ConstLattice> scc(clone, /*track_exec=*/true);
+  for (std::size_t i = 0; i < c.sig.size(); ++i) {
+    if (!c.sig[i].first) {
+      scc.set_arg(i, _args[_args_beg[c.callee] + i]);
+      continue;
+    }
+    clone.get_arg(i).replace_all_uses_with(*ValueConst::make(c.sig[i].second));
+    scc.set_arg(i, ConstLattice::make(c.sig[i].second));
   }
+  scc.run();
+  scc.replace_consts();
+  std::size_t nbranches, nphis, nblocks;
+  scc.remove_dead_code(nbranches, nphis, nblocks);
+
+  for (auto ins : c.calls)
+    ins->set_op(0, clone);
+  return clone;
+}
 
-  void _dump(const std::string &msg) {
-    std::cout << msg << ":\n";
-    for (auto &proc : _procs)
-      for (std::size_t i = 0; i < proc->args.size(); ++i)
-        std::cout << proc->fun.get_name() << "#" << i << ": " << proc->args[i]
-                  << "\n";
-    std::cout << "\n";
+std::string IPCP::_clone_name(const Function &fun) {
+  std::unordered_set<std::string> names;
+  for (const auto &f : _mod.fun())
+    names.insert(f.get_name());
+  for (std::size_t i = 0;; ++i) {
+    auto name = fun.get_name() + "_spec" + std::to_string(i);
+    if (!names.count(name))
+      return name;
   }
-};
+}
 
-} // namespace
+void IPCP::_dump(const std::string &msg) {
+  std::cout << msg << ":\n";
+  for (std::size_t id = 0; id < _cg.size(); ++id) {
+    auto &fun = _cg.fun(id);
+    for (std::size_t i = 0; i < fun.args_count(); ++i)
+      std::cout << fun.get_name() << "#" << i << ": "
+                << _args[_args_beg[id] + i] << "\n";
+  }
+  std::cout << "\n";
+}
 
-void ipcp_run(Module &mod) {
+void ipcp_run(Module &mod, bool specialize, bool iterate) {
   IPCP ipcp(mod);
   ipcp.run();
+  ipcp.apply();
+
+  // Simplified functions may give more constant arguments
+  while (iterate) {
+    std::vector<Function *> funs;
+    for (auto &fun : mod.fun())
+      if (fun.has_def())
+        funs.push_back(&fun);
+
+    std::size_t nchanged = 0;
+    for (auto fun : funs)
+      if (sccp_simplify(*fun)) {
+        ipcp.invalidate(*fun);
+        ++nchanged;
+      }
+    if (!nchanged)
+      break;
+    ipcp.run();
+    if (!ipcp.apply())
+      break;
+  }
+
+  if (specialize)
+    ipcp.specialize();
 }
@@ -1,5 +1,12 @@
 #pragma once
 
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "call-graph.hh"
+#include "lattice.hh"
 #include "module.hh"
 
 // Use the SSA form to find function params that have constant values
@@ -14,6 +21,114 @@
 // There are several ways to do this, from static eval of constants / formal
 // arguments only, to eval simple computation tree, up to an instante of
 // constant propagation algorithm.
+// This implementation precomputes a jump function for every call site
+// argument: the tree of foldable instructions computing it from constants and
+// formal arguments (phis meet all their operands, anything else is BOT).
+// Functions are visited SCC by SCC, in topological order of the call graph,
+// only recursive SCCs may need several visits.
+//
+// After a first run(), functions whose body changed can be marked with
+// invalidate(). The next run() only recomputes the arguments of the functions
+// they (transitively) call.
 //
 // Algorithm Interprocedular Constant Propagation - Engineer a Compiler p522
-void ipcp_run(Module &mod);
+class IPCP {
+
+public:
+  IPCP(Module &mod);
+
+  // Compute all arguments values, or update them after some invalidate()
+  void run();
+
+  // The body of fun changed since the last run
+  // Functions can't be added or removed between runs
+  void invalidate(const Function &fun);
+
+  // Value of argument pos of fun, computed by the last run
+  const ConstLattice &arg_value(const Function &fun, std::size_t pos) const;
+
+  // Replace all uses of arguments with a constant value by the constant
+  // Return the number of arguments replaced
+  std::size_t apply();
+
+  // Arguments with a different constant value depending on the call site are
+  // BOT after run(). Call sites are clustered by their constant arguments,
+  // and profitable clusters call a clone of the callee specialized for these
+  // constants (and simplified by SCCP).
+  // The number of clones and their total size are bounded.
+  // The clones are not part of the analysis, no run() is possible after this
+  void specialize();
+
+private:
+  // Node of a jump function tree
+  // Nodes of a function are stored in post-order (operands first)
+  struct JumpNode {
+    enum class Ty {
+      CONST, // val
+      ARG,   // formal argument at position val
+      OP,    // foldable instruction opname
+      PHI,   // meet of all operands
+      BOT,
+    };
+
+    Ty ty;
+    long val;
+    std::string opname;
+    std::vector<std::size_t> ops;
+  };
+
+  // Constant value of each argument at a call site, or nothing if the argument
+  // isn't worth specializing (unknown value, or same for all call sites)
+  using sig_t = std::vector<std::pair<bool, long>>;
+
+  // Call sites to the same function with the same constant arguments
+  struct Cluster {
+    std::size_t callee;
+    sig_t sig;
+    std::vector<Instruction *> calls;
+    std::size_t benefit;
+  };
+
+  Module &_mod;
+  CallGraph _cg;
+  bool _done;
+
+  // Value of all args of all functions
+  // Function id args are in [_args_beg[id], _args_beg[id + 1])
+  std::vector<std::size_t> _args_beg;
+  std::vector<ConstLattice> _args;
+
+  // For every function, its jump functions nodes, and the root node of every
+  // argument of every call site (in the same order than _cg.calls(id))
+  std::vector<std::vector<JumpNode>> _nodes;
+  std::vector<std::vector<std::vector<std::size_t>>> _roots;
+  std::vector<ConstLattice> _nodes_vals;
+
+  std::vector<char> _dirty;
+  std::vector<std::vector<std::size_t>> _wlist; // one per SCC
+  std::vector<char> _in_wlist;
+
+  void _build_jumps(std::size_t id);
+  std::size_t _build_node(std::size_t id,
+                          std::unordered_map<const Value *, std::size_t> &ids,
+                          const Value &val);
+  void _eval_jumps(std::size_t id);
+
+  void _init_args(std::size_t id);
+  void _push(std::size_t id);
+  void _propagate(std::size_t id);
+  std::vector<std::size_t> _update();
+
+  std::vector<Cluster> _build_clusters();
+  std::size_t _count_folded(std::size_t id, const sig_t &sig);
+  Function &_clone(const Cluster &c);
+  std::string _clone_name(const Function &fun);
+
+  void _dump(const std::string &msg);
+};
+
+// Run IPCP on mod and replace constant arguments
+// With iterate = true, SCCP is run on all functions after IPCP, and IPCP is
+// updated incrementally with the functions simplified, until nothing changes
+// With specialize = true, also run IPCP::specialize()
+void ipcp_run(Module &mod, bool specialize = false, bool iterate = false);
@@ -0,0 +1,169 @@
+#pragma once
+
+#include <climits>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Comparison known to be true for a value on a CFG edge
+// (eg: the true edge of `beq %x, 4` gives x EQ 4)
+enum class Cmp {
+  EQ,
+  NE,
+  LT,
+  LE,
+  GT,
+  GE,
+};
+
+// Lattices used by the SparseDataflow engine
+// A lattice L must provide:
+// - static L top() / static L bot()
+// - static L make(long val): element for a known constant
+// - static L meet(const L &x, const L &y)
+// - static L eval(const std::string &opname, const std::vector<L> &ops):
+//   transfer function, value of an instruction given its operands values.
+//   For conditional branches, it's the value of the condition
+// - static L narrow(const L &v, Cmp cmp, const L &o): refine v knowing that
+//   `v cmp o` is true. Return TOP if it can never be true
+// - static L widen(const L &old_val, const L &new_val): used on phis that
+//   changed too many times, to make sure the analysis terminates
+// - bool is_top() const / bool is_bot() const
+// - bool get_const(long &val) const: true if the element is a single constant
+// - operator==, operator!=, operator<<
+
+// Classic constant propagation lattice
+// TOP: unknown yet (optimistic start)
+// CONST: a single known value
+// BOT: may have several values at runtime
+class ConstLattice {
+
+public:
+  enum class Ty {
+    TOP,
+    CONST,
+    BOT,
+  };
+
+  ConstLattice() : ConstLattice(Ty::TOP) {}
+
+  static ConstLattice top() { return ConstLattice(Ty::TOP); }
+  static ConstLattice bot() { return ConstLattice(Ty::BOT); }
+  static ConstLattice make(long val) { return ConstLattice(Ty::CONST, val); }
+
+  Ty ty() const { return _ty; }
+  bool is_top() const { return _ty == Ty::TOP; }
+  bool is_bot() const { return _ty == Ty::BOT; }
+  bool is_const() const { return _ty == Ty::CONST; }
+  bool is_const(long val) const { return is_const() && _val == val; }
+
+  bool get_const(long &val) const {
+    if (!is_const())
+      return false;
+    val = _val;
+    return true;
+  }
+
+  static ConstLattice meet(const ConstLattice &x, const ConstLattice &y);
+
+  static ConstLattice eval(const std::string &opname,
+                           const std::vector<ConstLattice> &ops);
+
+  static ConstLattice narrow(const ConstLattice &v, Cmp cmp,
+                             const ConstLattice &o);
+
+  // Finite height, no need for widening
+  static ConstLattice widen(const ConstLattice &, const ConstLattice &v) {
+    return v;
+  }
+
+  friend bool operator==(const ConstLattice &x, const ConstLattice &y) {
+    return x._ty == y._ty && x._val == y._val;
+  }
+
+  friend bool operator!=(const ConstLattice &x, const ConstLattice &y) {
+    return !(x == y);
+  }
+
+private:
+  Ty _ty;
+  long _val;
+
+  ConstLattice(Ty ty, long val = 0) : _ty(ty), _val(val) {}
+};
+
+std::ostream &operator<<(std::ostream &os, const ConstLattice &v);
+
+// Value range and known bits lattice
+// Reduced product of:
+// - a signed interval [lo, hi]
+// - known bits: masks of bits known to be 0 (zeros) and 1 (ones)
+// Both parts are used to refine each other after every operation.
+// TOP: unknown yet (also used for empty sets, eg an impossible narrowing)
+// BOT: full interval, no known bits
+// A constant c is [c, c], with all bits known.
+class RangeLattice {
+
+public:
+  RangeLattice() : RangeLattice(true, LONG_MIN, LONG_MAX, 0, 0) {}
+
+  static RangeLattice top() { return RangeLattice(); }
+  static RangeLattice bot() {
+    return RangeLattice(false, LONG_MIN, LONG_MAX, 0, 0);
+  }
+  static RangeLattice make(long val) { return make(val, val); }
+  static RangeLattice make(long lo, long hi) { return _make(lo, hi, 0, 0); }
+
+  bool is_top() const { return _top; }
+  bool is_bot() const { return *this == bot(); }
+
+  long lo() const { return _lo; }
+  long hi() const { return _hi; }
+  unsigned long zeros() const { return _zeros; }
+  unsigned long ones() const { return _ones; }
+
+  bool get_const(long &val) const {
+    if (_top || _lo != _hi)
+      return false;
+    val = _lo;
+    return true;
+  }
+
+  static RangeLattice meet(const RangeLattice &x, const RangeLattice &y);
+
+  static RangeLattice eval(const std::string &opname,
+                           const std::vector<RangeLattice> &ops);
+
+  static RangeLattice narrow(const RangeLattice &v, Cmp cmp,
+                             const RangeLattice &o);
+
+  // Bounds still moving are sent to infinity
+  static RangeLattice widen(const RangeLattice &old_val,
+                            const RangeLattice &new_val);
+
+  friend bool operator==(const RangeLattice &x, const RangeLattice &y) {
+    return x._top == y._top && x._lo == y._lo && x._hi == y._hi &&
+           x._zeros == y._zeros && x._ones == y._ones;
+  }
+
+  friend bool operator!=(const RangeLattice &x, const RangeLattice &y) {
+    return !(x == y);
+  }
+
+private:
+  bool _top;
+  long _lo;
+  long _hi;
+  unsigned long _zeros;
+  unsigned long _ones;
+
+  RangeLattice(bool top, long lo, long hi, unsigned long zeros,
+               unsigned long ones)
+      : _top(top), _lo(lo), _hi(hi), _zeros(zeros), _ones(ones) {}
+
+  // Build a value, and use the range and known bits to refine each other
+  static RangeLattice _make(long lo, long hi, unsigned long zeros,
+                            unsigned long ones);
+};
+
+std::ostream &operator<<(std::ostream &os, const RangeLattice &v);
@@ -143,6 +143,9 @@ public:
   static ValueArg *make(const Function &fun, std::size_t pos,
                         NamesTable &ntable, const std::string &name);
 
+  // Position in the function arguments list
+  std::size_t get_pos() const { return _pos; }
+
   std::string to_arg() const override;
 
   void dump(std::ostream &os) const override;
@@ -8,14 +8,19 @@
 
 int main(int argc, char **argv) {
   if (argc < 2) {
-    std::cerr << "Usage: interproc-constprop <src-file>" << std::endl;
+    std::cerr
+        << "Usage: interproc-constprop <src-file> [--specialize | --iterate]"
+        << std::endl;
     return 1;
   }
 
   auto in_file = argv[1];
   auto mod = load_module(in_file);
 
-  ipcp_run(*mod);
+  bool specialize = argc > 2 && !strcmp(argv[2], "--specialize");
+  bool iterate = argc > 2 && !strcmp(argv[2], "--iterate");
+
+  ipcp_run(*mod, specialize, iterate);
   mod->check();
 
   auto gout = mod2gop(*mod);
@@ -0,0 +1,58 @@
+#include "const-folder.hh"
+
+#include <cassert>
+
+namespace {
+
+// Arithmetic is done on unsigned to get wrapping instead of UB on overflow
+long wrap_add(long x, long y) {
+  return static_cast<long>(static_cast<unsigned long>(x) +
+                           static_cast<unsigned long>(y));
+}
+
+long wrap_sub(long x, long y) {
+  return static_cast<long>(static_cast<unsigned long>(x) -
+                           static_cast<unsigned long>(y));
+}
+
+long wrap_mul(long x, long y) {
+  return static_cast<long>(static_cast<unsigned long>(x) *
+                           static_cast<unsigned long>(y));
+}
+
+} // namespace
+
+bool const_fold(const std::string &opname, const std::vector<long> &ops,
+                long &res) {
+  if (opname == "mov") {
+    assert(ops.size() == 1);
+    res = ops[0];
+  } else if (opname == "add") {
+    assert(ops.size() == 2);
+    res = wrap_add(ops[0], ops[1]);
+  } else if (opname == "sub") {
+    assert(ops.size() == 2);
+    res = wrap_sub(ops[0], ops[1]);
+  } else if (opname == "mul") {
+    assert(ops.size() == 2);
+    res = wrap_mul(ops[0], ops[1]);
+  } else if (opname == "cmplt") {
+    assert(ops.size() == 2);
+    res = ops[0] < ops[1];
+  } else if (opname == "beq") {
+    assert(ops.size() == 2);
+    res = ops[0] == ops[1];
+  } else if (opname == "bc") {
+    assert(ops.size() == 1);
+    res = ops[0] != 0;
+  } else
+    return false;
+
+  return true;
+}
+
+bool const_foldable(const std::string &opname) {
+  return opname == "mov" || opname == "add" || opname == "sub" ||
+         opname == "mul" || opname == "cmplt" || opname == "beq" ||
+         opname == "bc";
+}
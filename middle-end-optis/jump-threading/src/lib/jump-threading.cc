@@ -0,0 +1,372 @@
+#include "jump-threading.hh"
+
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "cfg.hh"
+#include "const-folder.hh"
+#include "digraph-order.hh"
+
+namespace {
+
+using vmap_t = std::map<const Value *, Value *>;
+
+std::vector<BasicBlock *> unique_bbs(std::vector<BasicBlock *> bbs) {
+  std::vector<BasicBlock *> res;
+  for (auto bb : bbs)
+    if (std::find(res.begin(), res.end(), bb) == res.end())
+      res.push_back(bb);
+  return res;
+}
+
+// Incoming value of phi from pred
+Value *phi_val(Instruction &phi, const BasicBlock &pred) {
+  for (std::size_t i = 0; i < phi.ops_count(); i += 2)
+    if (&phi.op(i) == &pred)
+      return &phi.op(i + 1);
+  return nullptr;
+}
+
+// Replace all operands of a phi
+void set_phi_ops(Instruction &phi, const std::vector<Value *> &ops) {
+  // The def of a phi is always its first argument
+  auto name = phi.get_name();
+  auto &bb = phi.parent();
+  auto &new_phi = *bb.insert_ins(ins_iterator_t(&phi), "phi", ops, "", 1);
+  phi.replace_all_uses_with(new_phi);
+  phi.erase_from_parent();
+  new_phi.set_name(name);
+}
+
+// Remove the incoming values from pred of all phis of bb
+void remove_phi_entries(BasicBlock &bb, const BasicBlock &pred) {
+  std::vector<Instruction *> phis;
+  for (auto &ins : bb.ins())
+    if (ins.get_opname() == "phi")
+      phis.push_back(&ins);
+
+  for (auto phi : phis) {
+    std::vector<Value *> ops;
+    for (std::size_t i = 0; i < phi->ops_count(); i += 2)
+      if (&phi->op(i) != &pred) {
+        ops.push_back(&phi->op(i));
+        ops.push_back(&phi->op(i + 1));
+      }
+    if (ops.size() != phi->ops_count())
+      set_phi_ops(*phi, ops);
+  }
+}
+
+class JumpThreading {
+
+public:
+  JumpThreading(Function &fun, std::size_t max_size)
+      : _fun(fun), _max_size(max_size) {}
+
+  void run() {
+    for (;;) {
+      _cfg.reset(new CFG(_fun));
+      if (!_thread_one())
+        break;
+    }
+  }
+
+private:
+  // A value defined in B, and its copy in B'
+  struct Repair {
+    Value *val;
+    Value *copy;
+    std::map<const BasicBlock *, Value *> live_in;
+  };
+
+  Function &_fun;
+  std::size_t _max_size;
+  std::unique_ptr<CFG> _cfg;
+  std::size_t _next_id = 0;
+
+  // Copies, phis of B, B, B'
+  vmap_t _vmap;
+  BasicBlock *_bb;
+  BasicBlock *_copy_bb;
+  std::string _suffix;
+
+  bool _thread_one() {
+    for (auto &bb : _fun.bb()) {
+      auto opname = bb.ins().back().get_opname();
+      if (&bb == &_fun.get_entry_bb() || (opname != "bc" && opname != "beq") ||
+          _size(bb) > _max_size)
+        continue;
+
+      auto preds = unique_bbs(_cfg->preds(bb));
+      for (auto pred : preds) {
+        auto targets = pred->ins().back().branch_targets();
+        if (pred == &bb || std::count(targets.begin(), targets.end(), &bb) != 1)
+          continue;
+
+        auto target = _eval(bb, *pred);
+        if (!target || target == &bb)
+          continue;
+
+        _thread(*pred, bb, *target, preds.size() == 1);
+        return true;
+      }
+    }
+    return false;
+  }
+
+  static std::size_t _size(const BasicBlock &bb) {
+    std::size_t res = 0;
+    for (const auto &ins : bb.ins())
+      if (ins.get_opname() != "phi" && !ins.is_branch())
+        ++res;
+    return res;
+  }
+
+  // Target of the branch of bb when coming from pred, or nullptr if unknown
+  BasicBlock *_eval(BasicBlock &bb, const BasicBlock &pred) {
+    std::map<const Value *, long> vals;
+    auto get = [&vals](const Value &v, long &res) {
+      if (auto c = dynamic_cast<const ValueConst *>(&v)) {
+        res = c->get_val();
+        return true;
+      }
+      auto it = vals.find(&v);
+      if (it == vals.end())
+        return false;
+      res = it->second;
+      return true;
+    };
+
+    for (auto &ins : bb.ins()) {
+      const auto &opname = ins.get_opname();
+      // Phis are evaluated in parallel, only constants are known
+      if (opname == "phi") {
+        auto c = dynamic_cast<ValueConst *>(phi_val(ins, pred));
+        if (c)
+          vals.emplace(&ins, c->get_val());
+        continue;
+      }
+      if (!const_foldable(opname))
+        continue;
+
+      // Operands are given without the branch targets
+      auto ops = ins.ops();
+      if (ins.is_branch())
+        ops.resize(ops.size() - 2);
+      std::vector<long> cops;
+      long val;
+      for (auto op : ops)
+        if (get(*op, val))
+          cops.push_back(val);
+      if (cops.size() != ops.size() || !const_fold(opname, cops, val))
+        continue;
+
+      if (!ins.is_branch()) {
+        vals.emplace(&ins, val);
+        continue;
+      }
+      auto targets = ins.branch_targets();
+      return val ? targets[0] : targets[1];
+    }
+    return nullptr;
+  }
+
+  void _thread(BasicBlock &pred, BasicBlock &bb, BasicBlock &target,
+               bool single_pred) {
+    std::cout << "Thread: " << pred.to_arg() << " -> " << bb.to_arg()
+              << " -> " << target.to_arg() << "\n";
+    _suffix = "_jt" + std::to_string(_next_id++);
+    _bb = &bb;
+    _copy_bb = &*_fun.insert_bb(bb_iterator_t(&bb) + 1,
+                                bb.get_name() + _suffix);
+    _vmap.clear();
+
+    // Values from pred must be read before they are removed from the phis
+    // A constant is deleted with its last user, it's copied
+    std::vector<Value *> pred_vals;
+    for (auto &ins : bb.ins())
+      if (ins.get_opname() == "phi") {
+        auto val = phi_val(ins, pred);
+        auto c = dynamic_cast<ValueConst *>(val);
+        pred_vals.push_back(c ? ValueConst::make(c->get_val()) : val);
+      }
+    if (!single_pred)
+      remove_phi_entries(bb, pred);
+
+    auto pred_val = pred_vals.begin();
+    for (auto &ins : bb.ins()) {
+      if (ins.get_opname() == "phi") {
+        _vmap[&ins] = *pred_val++;
+        continue;
+      }
+      if (ins.is_branch()) {
+        _copy_bb->insert_ins(_copy_bb->ins_end(), "b", {&target}, "",
+                             isa::IDX_NO);
+        continue;
+      }
+
+      std::vector<Value *> ops;
+      for (auto op : ins.ops())
+        ops.push_back(_map(*op));
+      auto &copy = *_copy_bb->insert_ins(
+          _copy_bb->ins_end(), ins.get_opname(), ops,
+          ins.has_def() ? ins.get_name() + _suffix : "", ins.get_def_idx());
+      _vmap[&ins] = &copy;
+    }
+
+    auto &br = pred.ins().back();
+    for (std::size_t i = 0; i < br.ops_count(); ++i)
+      if (&br.op(i) == &bb)
+        br.set_op(i, *_copy_bb);
+
+    std::vector<Instruction *> phis;
+    for (auto &ins : target.ins())
+      if (ins.get_opname() == "phi")
+        phis.push_back(&ins);
+    for (auto phi : phis) {
+      auto ops = phi->ops();
+      ops.push_back(_copy_bb);
+      ops.push_back(_map(*phi_val(*phi, bb)));
+      set_phi_ops(*phi, ops);
+    }
+
+    // bb is unreachable, the copy replaces it
+    if (single_pred) {
+      for (auto it : _vmap)
+        const_cast<Value *>(it.first)->replace_all_uses_with(*it.second);
+      // The other targets of B may have lost their last pred too
+      _remove_unreachable();
+      return;
+    }
+
+    _cfg.reset(new CFG(_fun));
+    _repair_uses();
+  }
+
+  void _remove_unreachable() {
+    CFG cfg(_fun);
+    auto &mva = cfg.mva(_fun);
+    std::vector<int> reached(mva.size(), 0);
+    for (auto u : digraph_dfs(cfg.graph(), DFSOrder::PRE,
+                              mva(&_fun.get_entry_bb()), false))
+      reached[u] = 1;
+
+    std::vector<BasicBlock *> bbs;
+    for (std::size_t u = 0; u < mva.size(); ++u) {
+      if (reached[u])
+        continue;
+      auto &bb = *mva(u);
+      bbs.push_back(&bb);
+      for (auto succ : unique_bbs(cfg.succs(bb)))
+        if (reached[mva(succ)])
+          remove_phi_entries(*succ, bb);
+    }
+
+    for (auto bb : bbs) {
+      std::cout << "Remove unreachable block: " << bb->to_arg() << "\n";
+      bb->erase_from_parent();
+    }
+  }
+
+  Value *_map(Value &v) {
+    auto it = _vmap.find(&v);
+    return it == _vmap.end() ? &v : it->second;
+  }
+
+  // Rewrite uses of the values of B outside of B
+  void _repair_uses() {
+    for (auto &ins : _bb->ins()) {
+      if (!ins.has_def())
+        continue;
+      Repair r{&ins, _vmap.at(&ins), {}};
+
+      for (auto user : ins.get_users()) {
+        auto use = dynamic_cast<Instruction *>(user);
+        if (!use || &use->parent() == _copy_bb)
+          continue;
+        bool is_phi = use->get_opname() == "phi";
+        // Phis of B may get the value back from another pred (loops)
+        if (&use->parent() == _bb && !is_phi)
+          continue;
+
+        for (std::size_t i = 0; i < use->ops_count(); ++i) {
+          if (&use->op(i) != &ins)
+            continue;
+          if (!is_phi) {
+            use->set_op(i, _live_in(use->parent(), r));
+            continue;
+          }
+          auto &pred = dynamic_cast<BasicBlock &>(use->op(i - 1));
+          if (&pred != _bb && &pred != _copy_bb)
+            use->set_op(i, _live_out(pred, r));
+        }
+      }
+    }
+  }
+
+  Value &_live_out(BasicBlock &bb, Repair &r) {
+    if (&bb == _bb)
+      return *r.val;
+    if (&bb == _copy_bb)
+      return *r.copy;
+    return _live_in(bb, r);
+  }
+
+  Value &_live_in(BasicBlock &bb, Repair &r) {
+    auto it = r.live_in.find(&bb);
+    if (it != r.live_in.end())
+      return *it->second;
+
+    auto preds = unique_bbs(_cfg->preds(bb));
+    if (preds.size() == 1) {
+      auto &res = _live_out(*preds.front(), r);
+      r.live_in[&bb] = &res;
+      return res;
+    }
+
+    // Added to live_in before visiting the preds, to stop on cycles
+    std::vector<Value *> ops;
+    for (auto pred : preds) {
+      ops.push_back(pred);
+      ops.push_back(r.val);
+    }
+    auto &phi =
+        *bb.insert_ins(bb.ins_begin(), "phi", ops,
+                       r.val->get_name() + "_" + bb.get_name() + _suffix, 1);
+    r.live_in[&bb] = &phi;
+    for (std::size_t i = 0; i < preds.size(); ++i)
+      phi.set_op(2 * i + 1, _live_out(*preds[i], r));
+
+    Value *same = nullptr;
+    for (std::size_t i = 1; i < phi.ops_count(); i += 2)
+      if (&phi.op(i) != &phi && &phi.op(i) != same) {
+        if (same)
+          return phi;
+        same = &phi.op(i);
+      }
+
+    std::cout << "Trivial phi: ";
+    phi.dump(std::cout);
+    std::cout << "\n";
+    phi.replace_all_uses_with(*same);
+    for (auto &it : r.live_in)
+      if (it.second == &phi)
+        it.second = same;
+    phi.erase_from_parent();
+    return *same;
+  }
+};
+
+} // namespace
+
+void jump_threading_run(Module &mod, std::size_t max_size) {
+  for (auto &fun : mod.fun()) {
+    if (!fun.has_def())
+      continue;
+    JumpThreading jt(fun, max_size);
+    jt.run();
+  }
+}
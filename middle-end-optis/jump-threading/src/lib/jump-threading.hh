@@ -0,0 +1,31 @@
+#pragma once
+
+#include "module.hh"
+
+// Jump Threading
+// A block B ending with a conditional branch (bc / beq) is evaluated once for
+// each of its preds P: phis of B get their incoming value from P, and the
+// instructions of B are folded with the constant folder of the constant
+// propagation passes. If the branch condition is known, the edge P -> B always
+// continues to the same target T.
+// B is then duplicated for P: B' is a copy of B, with phis replaced by the
+// values from P, and the branch replaced by `b T`. P jumps to B' instead of
+// B.
+// - phis of B lose their incoming value from P
+// - phis of T get a new incoming value from B' (the copy of the one from B)
+// - all other uses of a value defined in B now have 2 reaching definitions:
+//   they are found by walking up the preds from the use, and phis are added
+//   where the definitions of B and B' meet (only trivial phis are removed)
+// - B is removed if P was its only pred, along with the blocks that become
+//   unreachable
+// Only blocks with at most max_size instructions (without phis and branch)
+// are duplicated.
+// Analyses on the CFG are recomputed after each change, until no edge can be
+// threaded.
+//
+// This removes one branch per iteration of state machines, where each state
+// sets the next one with a constant, and jumps back to the dispatch block.
+//
+// Simple and Efficient Construction of Static Single Assignment Form - Braun,
+// Buchwald, Hack, Leißa, Mallon & Zwinkau (phis insertion)
+void jump_threading_run(Module &mod, std::size_t max_size);
@@ -0,0 +1,37 @@
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#include "lib/jump-threading.hh"
+#include "lib/loader.hh"
+#include "lib/module.hh"
+
+namespace {
+
+constexpr std::size_t DEFAULT_MAX_SIZE = 6;
+
+} // namespace
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    std::cerr << "Usage: jump-threading <src-file> [--max-size <ins-count>]"
+              << std::endl;
+    return 1;
+  }
+
+  auto in_file = argv[1];
+  auto mod = load_module(in_file);
+
+  std::size_t max_size = DEFAULT_MAX_SIZE;
+  if (argc > 3 && !strcmp(argv[2], "--max-size"))
+    max_size = std::atoi(argv[3]);
+
+  jump_threading_run(*mod, max_size);
+  mod->check();
+
+  auto gout = mod2gop(*mod);
+  gout.dump(std::cout);
+  isa::check(gout);
+
+  return 0;
+}
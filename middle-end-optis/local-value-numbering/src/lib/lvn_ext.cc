@@ -1,12 +1,10 @@
-#include "lvn.hh"
-
-#include <utils/str/format-string.hh>
+#include "lvn_ext.hh"
 
 #include <cassert>
 #include <iostream>
-#include <map>
+#include <unordered_map>
 
-using val_t = std::size_t;
+#include "vn-table.hh"
 
 namespace {
 
@@ -27,17 +25,21 @@ int get_const(const std::string &str) {
 
 bool is_reg(const std::string &str) { return str.size() > 1 && str[0] == '%'; }
 
-template <class U, class V> void dump_map(const std::map<U, V> &m) {
-  std::cerr << "Map {\n";
-  for (auto &it : m)
-    std::cerr << "  '" << it.first << "' => '" << it.second << "',\n";
-  std::cerr << "}\n";
+constexpr std::size_t REG_NO = -1;
+
+VNOp get_op(const std::string &opname) {
+  if (opname == "add")
+    return VNOp::ADD;
+  else if (opname == "sub")
+    return VNOp::SUB;
+  else if (opname == "mul")
+    return VNOp::MUL;
+  assert(0);
+  return VNOp::CONST;
 }
 
 struct LVN {
   void run(Module &mod) {
-    next_val = 0;
-
     for (std::size_t i = 0; i < mod.code.size(); ++i) {
       auto &ins = mod.code[i];
       const auto &opname = ins.args.front();
@@ -55,8 +57,8 @@ struct LVN {
 
         // Perform constant folding
         if (is_const(op_s1) && is_const(op_s2)) {
-          auto c1 = get_const(op_s1);
-          auto c2 = get_const(op_s2);
+          auto c1 = vals[get_op_val(op_s1)].cst;
+          auto c2 = vals[get_op_val(op_s2)].cst;
 
           int res;
           if (opname == "add")
@@ -82,28 +84,25 @@ struct LVN {
           continue;
         }
 
-        // Compute hash value of src operands
-        auto s1h = get_op_hash(op_s1);
-        auto s2h = get_op_hash(op_s2);
+        // Value numbers of src operands
+        auto s1v = get_op_val(op_s1);
+        auto s2v = get_op_val(op_s2);
 
-        // Compute hash value of dst by sorting operands if operation is
-        // commumative This way, comutative exps like a+b and b+a get the same
-        // hash key
-        auto exp_hash = !comut_op || s1h < s2h
-                            ? FORMAT_STRING(opname << ',' << s1h << ',' << s2h)
-                            : FORMAT_STRING(opname << ',' << s2h << ',' << s1h);
-        auto it = hash_vals.find(exp_hash);
+        // Sort operands if operation is commumative
+        // This way, comutative exps like a+b and b+a get the same key
+        if (comut_op && s2v < s1v)
+          std::swap(s1v, s2v);
+        VNKey exp_key{get_op(opname), s1v, s2v};
+        auto exp_val = exps.find(exp_key);
 
         // Replace expression with mov
         // only possible if:
         // - expression was seen before
         // - there is a register with same value as expression value
-        if (it != hash_vals.end() &&
-            hash_inv.find(it->second) != hash_inv.end()) {
+        if (exp_val != VAL_NO && vals[exp_val].reg != REG_NO) {
           // expression already computed
-          auto cpy_reg = hash_inv.find(it->second)->second;
           Ins new_ins;
-          new_ins.args = {"mov", op_dst, cpy_reg};
+          new_ins.args = {"mov", op_dst, reg_names[vals[exp_val].reg]};
           ins = new_ins;
 
           --i;
@@ -111,38 +110,22 @@ struct LVN {
         }
 
         // new expression, add to hash table
-        val_t ins_val = next_val++;
-        udp_map(exp_hash, ins_val);
-        udp_map(op_dst, ins_val);
+        val_t ins_val = new_val();
+        exps.put(exp_key, ins_val);
+        set_reg(op_dst, ins_val);
       }
 
       else if (opname == "mov") {
         auto &op_dst = ins.args[1];
         auto &op_src = ins.args[2];
         assert(is_reg(op_dst));
+        assert(is_reg(op_src) || is_const(op_src));
 
-        if (is_reg(op_src)) {
-          // store src and dst in hash table
-          auto srcv = get_op_val(op_src);
-          udp_map(op_dst, srcv);
-        }
-
-        else if (is_const(op_src)) {
-          // Assign a new number to dst
-          auto dstv = next_val++;
-          udp_map(op_dst, dstv);
-          consts.emplace(dstv, get_const(op_src));
-        }
-
-        else {
-          assert(0);
-        }
+        // dst gets the value of src (the same for every use of a constant)
+        set_reg(op_dst, get_op_val(op_src));
 
         // Perform const transformation at the end
         // Avoid registering twice the same constant
-        // This doesn't prevent the case where code contains twice the same
-        // const Other solution would be to check if const already exists (with
-        // double-side map)
         op2const(op_src);
       }
 
@@ -152,30 +135,59 @@ struct LVN {
     }
   }
 
+  val_t new_val() {
+    vals.push_back({REG_NO, false, 0});
+    return vals.size() - 1;
+  }
+
+  std::size_t get_reg_id(const std::string &reg) {
+    auto it = reg_ids.find(reg);
+    if (it != reg_ids.end())
+      return it->second;
+    reg_ids.emplace(reg, reg_names.size());
+    reg_names.push_back(reg);
+    regs.push_back(VAL_NO);
+    return reg_names.size() - 1;
+  }
+
   // Get a value number for an operand
   // Create a new one if doesn't exit yet
+  // Constants are parsed only once, and always get the same number
   val_t get_op_val(const std::string &op) {
-    if (hash_vals.find(op) == hash_vals.end())
-      udp_map(op, next_val++);
-    return hash_vals[op];
-  }
+    if (is_const(op)) {
+      auto it = const_vals.find(op);
+      if (it != const_vals.end())
+        return it->second;
+
+      auto cst = get_const(op);
+      VNKey key{VNOp::CONST, static_cast<std::uint64_t>(cst), 0};
+      auto res = exps.find(key);
+      if (res == VAL_NO) {
+        res = new_val();
+        vals[res].is_const = true;
+        vals[res].cst = cst;
+        exps.put(key, res);
+      }
+      const_vals.emplace(op, res);
+      return res;
+    }
 
-  void udp_map(const std::string &key, val_t new_val) {
-    auto it = hash_vals.find(key);
+    auto id = get_reg_id(op);
+    if (regs[id] == VAL_NO)
+      set_reg(op, new_val());
+    return regs[id];
+  }
 
-    if (it != hash_vals.end()) {
-      // remove from inverse mapping if inv[vals[key]] == key
-      auto inv_it = hash_inv.find(it->second);
-      if (inv_it != hash_inv.end() && inv_it->second == key)
-        hash_inv.erase(inv_it);
-    }
+  void set_reg(const std::string &reg, val_t new_val) {
+    auto id = get_reg_id(reg);
+    auto old_val = regs[id];
 
-    hash_vals[key] = new_val;
+    // remove from inverse mapping if inv[vals[reg]] == reg
+    if (old_val != VAL_NO && vals[old_val].reg == id)
+      vals[old_val].reg = REG_NO;
 
-    // only store register hash in inverse mapping
-    if (is_reg(key)) {
-      hash_inv[new_val] = key;
-    }
+    regs[id] = new_val;
+    vals[new_val].reg = id;
   }
 
   /// op is the source operand,
@@ -184,29 +196,14 @@ struct LVN {
     if (!is_reg(op))
       return false;
 
-    auto it = hash_vals.find(op);
-    if (it == hash_vals.end())
-      return false;
-
-    auto const_it = consts.find(it->second);
-    if (const_it == consts.end())
+    auto val = regs[get_reg_id(op)];
+    if (val == VAL_NO || !vals[val].is_const)
       return false;
 
-    op = std::to_string(const_it->second);
+    op = std::to_string(vals[val].cst);
     return true;
   }
 
-  // Hash value of src operand
-  std::string get_op_hash(const std::string &op) {
-    if (is_reg(op)) {
-      auto v = get_op_val(op);
-      return "v" + std::to_string(v);
-    } else if (is_const(op))
-      return "c" + op;
-    else
-      assert(0);
-  }
-
   // Apply common known algebric idendities (x*1, x+0, etc)
   // Long, repetitive error-prone implem
   // One solution is to use some form of pattern matching
@@ -260,37 +257,38 @@ struct LVN {
   }
 
   void dump() {
-    std::cerr << "hash_vals: ";
-    dump_map(hash_vals);
-    std::cerr << "\nhash_inv: ";
-    dump_map(hash_inv);
-    std::cerr << "\nconsts: ";
-    dump_map(consts);
-    std::cerr << "\n";
+    std::cerr << "regs: Map {\n";
+    for (std::size_t i = 0; i < regs.size(); ++i)
+      std::cerr << "  '" << reg_names[i] << "' => '" << regs[i] << "',\n";
+    std::cerr << "}\n\nconsts: Map {\n";
+    for (std::size_t v = 0; v < vals.size(); ++v)
+      if (vals[v].is_const)
+        std::cerr << "  '" << v << "' => '" << vals[v].cst << "',\n";
+    std::cerr << "}\n";
   }
 
-  // Mapping from an hashed key to its number
-  // regs, constants and expression get hashed to unique values
-  std::map<std::string, val_t> hash_vals;
-
-  /// Inverse mapping to find the the register with the wanted value
-  /// This isn't exactly like a double map, because many hash points to the
-  /// same value This map hold the hash of regs only
-  ///
-  /// This inverse mapping isn't perfect, because it may only contain one reg
-  /// per value Sometimes multiple reg aliases the same value If the reg in
-  /// hash_inv change value, the value cannot be accessed anymore, even though
-  /// other regs aliases it
-  /// This could be fixed using a vector<string> of all regs aliasing the value
-  /// for example, instead of storing just one
-  std::map<val_t, std::string> hash_inv;
-
-  // Store all value numbers with an associated constant integer
-  // Used to perform constant folding
-  std::map<val_t, int> consts;
-
-  // Counter to assign different values
-  val_t next_val;
+  // Infos about a value number
+  // reg: the register holding the value (inverse mapping)
+  //   This inverse mapping isn't perfect, because it may only contain one reg
+  //   per value. If this reg changes value, the value cannot be accessed
+  //   anymore, even though other regs aliases it
+  // is_const / cst: Used to perform constant folding
+  struct ValInfo {
+    std::size_t reg;
+    bool is_const;
+    int cst;
+  };
+  std::vector<ValInfo> vals;
+
+  // Hash-consing of expressions and constants to their numbers
+  VNTable exps;
+  // Constant operands already parsed
+  std::unordered_map<std::string, val_t> const_vals;
+
+  // Registers are identified by an index, to get their value number
+  std::unordered_map<std::string, std::size_t> reg_ids;
+  std::vector<std::string> reg_names;
+  std::vector<val_t> regs;
 };
 
 } // namespace
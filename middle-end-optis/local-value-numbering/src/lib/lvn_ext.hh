@@ -7,6 +7,8 @@
 // - Perform constant folding
 // - Assign same value number to commumative operations
 // - Apply transformations for basic algebric ids (x+0, x*1, x-x, etc)
+// Expressions and constants are hash-consed to value numbers in an open
+// addressing table (see vn-table.hh)
 //
 // Algorithm Local Value Numbering - Engineer a Compiler p???
 void run_lvn_ext(Module &mod);
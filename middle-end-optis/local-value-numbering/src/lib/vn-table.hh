@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+using val_t = std::size_t;
+
+constexpr val_t VAL_NO = -1;
+
+// Operation of an expression key
+enum class VNOp : std::uint8_t {
+  CONST,
+  ADD,
+  SUB,
+  MUL,
+};
+
+// Key of an expression: operation, and value numbers of the operands
+// Constants are hash-consed too: (CONST, value, 0)
+struct VNKey {
+  VNOp op;
+  std::uint64_t v1;
+  std::uint64_t v2;
+
+  bool operator==(const VNKey &o) const {
+    return op == o.op && v1 == o.v1 && v2 == o.v2;
+  }
+};
+
+// Open addressing hash table (linear probing) from expression keys to value
+// numbers
+// The capacity is a power of 2, doubled when the table is 3/4 full
+// Erased keys stay in the table with value VAL_NO (to not break the probe
+// sequences of the other keys), until the table grows
+class VNTable {
+public:
+  VNTable();
+
+  // Returns VAL_NO if not found
+  val_t find(const VNKey &key) const;
+
+  // Set the value of key (VAL_NO to erase it)
+  // Returns the previous value
+  val_t put(const VNKey &key, val_t val);
+
+private:
+  struct Slot {
+    VNKey key;
+    val_t val;
+    bool used;
+  };
+
+  std::vector<Slot> _slots;
+  std::size_t _used;
+
+  // Slot containing key, or the empty slot where it should be inserted
+  std::size_t _find_slot(const VNKey &key) const;
+
+  void _grow();
+};
@@ -0,0 +1,344 @@
+#include "lattice.hh"
+
+#include <algorithm>
+
+#include "const-folder.hh"
+
+ConstLattice ConstLattice::meet(const ConstLattice &x, const ConstLattice &y) {
+  if (x.is_bot() || y.is_bot())
+    return bot();
+  if (x.is_top())
+    return y;
+  if (y.is_top())
+    return x;
+  return x._val == y._val ? x : bot();
+}
+
+ConstLattice ConstLattice::eval(const std::string &opname,
+                                const std::vector<ConstLattice> &ops) {
+  if (!const_foldable(opname))
+    return bot();
+
+  // 0 * x => 0, whatever x is
+  if (opname == "mul" && (ops[0].is_const(0) || ops[1].is_const(0)))
+    return make(0);
+
+  // B op x => B
+  // T op x/T => T
+  // c1 op c2 => fold(c1, c2)
+  std::vector<long> cops;
+  for (const auto &op : ops) {
+    if (op.is_bot())
+      return bot();
+    if (op.is_const())
+      cops.push_back(op._val);
+  }
+  if (cops.size() != ops.size())
+    return top();
+
+  long res;
+  if (!const_fold(opname, cops, res))
+    return bot();
+  return make(res);
+}
+
+ConstLattice ConstLattice::narrow(const ConstLattice &v, Cmp cmp,
+                                  const ConstLattice &o) {
+  if (v.is_top() || !o.is_const())
+    return v;
+
+  if (cmp == Cmp::EQ) {
+    // Edge can never be taken
+    if (v.is_const() && v._val != o._val)
+      return top();
+    return o;
+  }
+
+  if (cmp == Cmp::NE && v.is_const(o._val))
+    return top();
+  return v;
+}
+
+std::ostream &operator<<(std::ostream &os, const ConstLattice &v) {
+  long val;
+  if (v.is_top())
+    os << "T";
+  else if (v.get_const(val))
+    os << val;
+  else
+    os << "B";
+  return os;
+}
+
+namespace {
+
+constexpr unsigned long SIGN_BIT = 1UL << 63;
+
+// Number of low bits known to be 0
+int known_tz(unsigned long zeros) {
+  return ~zeros ? __builtin_ctzl(~zeros) : 64;
+}
+
+// Known bits of x + y + carry
+// Compute bit by bit from the lowest one, stop at the first unknown bit
+void add_bits(unsigned long xz, unsigned long xo, unsigned long yz,
+              unsigned long yo, int carry, unsigned long &rz,
+              unsigned long &ro) {
+  rz = 0;
+  ro = 0;
+  for (int i = 0; i < 64; ++i) {
+    auto m = 1UL << i;
+    if (!((xz | xo) & m) || !((yz | yo) & m))
+      break;
+    int s = !!(xo & m) + !!(yo & m) + carry;
+    if (s & 1)
+      ro |= m;
+    else
+      rz |= m;
+    carry = s >> 1;
+  }
+}
+
+// Smallest interval containing all products of [xl, xh] and [yl, yh]
+// Full interval on overflow
+void mul_range(long xl, long xh, long yl, long yh, long &lo, long &hi) {
+  long cs[4];
+  if (__builtin_mul_overflow(xl, yl, &cs[0]) ||
+      __builtin_mul_overflow(xl, yh, &cs[1]) ||
+      __builtin_mul_overflow(xh, yl, &cs[2]) ||
+      __builtin_mul_overflow(xh, yh, &cs[3])) {
+    lo = LONG_MIN;
+    hi = LONG_MAX;
+    return;
+  }
+  lo = *std::min_element(cs, cs + 4);
+  hi = *std::max_element(cs, cs + 4);
+}
+
+} // namespace
+
+RangeLattice RangeLattice::_make(long lo, long hi, unsigned long zeros,
+                                 unsigned long ones) {
+  if (lo > hi || (zeros & ones))
+    return top();
+
+  // bits -> range
+  // If the sign is known, setting all unknown bits to 0 (resp 1) gives the
+  // smallest (resp biggest) possible value
+  if ((zeros | ones) & SIGN_BIT) {
+    lo = std::max(lo, static_cast<long>(ones));
+    hi = std::min(hi, static_cast<long>(~zeros));
+    if (lo > hi)
+      return top();
+  }
+
+  // range -> bits
+  // All bits above the highest differing bit of lo and hi are known
+  if ((lo < 0) == (hi < 0)) {
+    auto ulo = static_cast<unsigned long>(lo);
+    auto diff = ulo ^ static_cast<unsigned long>(hi);
+    auto mask = ~0UL;
+    if (diff) {
+      int n = 64 - __builtin_clzl(diff);
+      mask = n == 64 ? 0 : ~0UL << n;
+    }
+    zeros |= ~ulo & mask;
+    ones |= ulo & mask;
+  }
+
+  if (zeros & ones)
+    return top();
+  return RangeLattice(false, lo, hi, zeros, ones);
+}
+
+RangeLattice RangeLattice::meet(const RangeLattice &x, const RangeLattice &y) {
+  if (x.is_top())
+    return y;
+  if (y.is_top())
+    return x;
+  return _make(std::min(x._lo, y._lo), std::max(x._hi, y._hi),
+               x._zeros & y._zeros, x._ones & y._ones);
+}
+
+RangeLattice RangeLattice::eval(const std::string &opname,
+                                const std::vector<RangeLattice> &ops) {
+  if (!const_foldable(opname))
+    return bot();
+
+  // 0 * x => 0, whatever x is
+  long c;
+  if (opname == "mul" && ((ops[0].get_const(c) && c == 0) ||
+                          (ops[1].get_const(c) && c == 0)))
+    return make(0);
+
+  for (const auto &op : ops)
+    if (op.is_top())
+      return top();
+
+  // Fold if all operands are constants
+  std::vector<long> cops;
+  for (const auto &op : ops)
+    if (op.get_const(c))
+      cops.push_back(c);
+  long res;
+  if (cops.size() == ops.size() && const_fold(opname, cops, res))
+    return make(res);
+
+  const auto &x = ops[0];
+
+  if (opname == "mov")
+    return x;
+
+  if (opname == "bc") {
+    if (x._lo > 0 || x._hi < 0 || x._ones)
+      return make(1);
+    return make(0, 1);
+  }
+
+  const auto &y = ops[1];
+
+  if (opname == "add") {
+    long lo, hi;
+    if (__builtin_add_overflow(x._lo, y._lo, &lo) ||
+        __builtin_add_overflow(x._hi, y._hi, &hi)) {
+      lo = LONG_MIN;
+      hi = LONG_MAX;
+    }
+    unsigned long zeros, ones;
+    add_bits(x._zeros, x._ones, y._zeros, y._ones, 0, zeros, ones);
+    return _make(lo, hi, zeros, ones);
+  }
+
+  if (opname == "sub") {
+    // x - y = x + ~y + 1
+    long lo, hi;
+    if (__builtin_sub_overflow(x._lo, y._hi, &lo) ||
+        __builtin_sub_overflow(x._hi, y._lo, &hi)) {
+      lo = LONG_MIN;
+      hi = LONG_MAX;
+    }
+    unsigned long zeros, ones;
+    add_bits(x._zeros, x._ones, y._ones, y._zeros, 1, zeros, ones);
+    return _make(lo, hi, zeros, ones);
+  }
+
+  if (opname == "mul") {
+    long lo, hi;
+    mul_range(x._lo, x._hi, y._lo, y._hi, lo, hi);
+    auto tz = std::min(64, known_tz(x._zeros) + known_tz(y._zeros));
+    auto zeros = tz == 64 ? ~0UL : (1UL << tz) - 1;
+    return _make(lo, hi, zeros, 0);
+  }
+
+  if (opname == "cmplt") {
+    if (x._hi < y._lo)
+      return make(1);
+    if (x._lo >= y._hi)
+      return make(0);
+    return make(0, 1);
+  }
+
+  if (opname == "beq") {
+    if (x._hi < y._lo || y._hi < x._lo || (x._zeros & y._ones) ||
+        (x._ones & y._zeros))
+      return make(0);
+    return make(0, 1);
+  }
+
+  return bot();
+}
+
+RangeLattice RangeLattice::narrow(const RangeLattice &v, Cmp cmp,
+                                  const RangeLattice &o) {
+  if (v.is_top() || o.is_top())
+    return v;
+
+  long lo = v._lo;
+  long hi = v._hi;
+  auto zeros = v._zeros;
+  auto ones = v._ones;
+
+  switch (cmp) {
+  case Cmp::EQ:
+    lo = std::max(lo, o._lo);
+    hi = std::min(hi, o._hi);
+    zeros |= o._zeros;
+    ones |= o._ones;
+    break;
+
+  case Cmp::NE:
+    // Can only remove a constant at one end of the interval
+    if (o._lo == o._hi) {
+      if (lo == o._lo && lo == hi)
+        return top();
+      if (lo == o._lo)
+        ++lo;
+      else if (hi == o._lo)
+        --hi;
+    }
+    break;
+
+  case Cmp::LT:
+    if (o._hi == LONG_MIN)
+      return top();
+    hi = std::min(hi, o._hi - 1);
+    break;
+
+  case Cmp::LE:
+    hi = std::min(hi, o._hi);
+    break;
+
+  case Cmp::GT:
+    if (o._lo == LONG_MAX)
+      return top();
+    lo = std::max(lo, o._lo + 1);
+    break;
+
+  case Cmp::GE:
+    lo = std::max(lo, o._lo);
+    break;
+  }
+
+  return _make(lo, hi, zeros, ones);
+}
+
+RangeLattice RangeLattice::widen(const RangeLattice &old_val,
+                                 const RangeLattice &new_val) {
+  if (old_val.is_top() || new_val.is_top())
+    return new_val;
+  if (new_val._lo >= old_val._lo && new_val._hi <= old_val._hi)
+    return new_val;
+  // Known bits are dropped, they would shrink the range back
+  long lo = new_val._lo < old_val._lo ? LONG_MIN : new_val._lo;
+  long hi = new_val._hi > old_val._hi ? LONG_MAX : new_val._hi;
+  return _make(lo, hi, 0, 0);
+}
+
+std::ostream &operator<<(std::ostream &os, const RangeLattice &v) {
+  long val;
+  if (v.is_top())
+    os << "T";
+  else if (v.get_const(val))
+    os << val;
+  else if (v.is_bot())
+    os << "B";
+  else {
+    os << "[";
+    if (v.lo() == LONG_MIN)
+      os << "-inf";
+    else
+      os << v.lo();
+    os << ", ";
+    if (v.hi() == LONG_MAX)
+      os << "+inf";
+    else
+      os << v.hi();
+    os << "]";
+
+    // Low bits known to be 0 (alignment)
+    int tz = known_tz(v.zeros());
+    if (tz > 0)
+      os << " tz=" << tz;
+  }
+  return os;
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <ostream>
+#include <set>
+#include <vector>
+
+#include "cfg.hh"
+#include "idom.hh"
+#include "module.hh"
+
+// A natural loop: all blocks that can reach a latch without going through the
+// header. The header dominates all of them.
+class Loop {
+public:
+  BasicBlock &header() const { return *_header; }
+
+  // Enclosing loop, or nullptr for an outermost loop
+  Loop *parent() const { return _parent; }
+  const std::vector<Loop *> &children() const { return _children; }
+
+  // 1 for an outermost loop
+  std::size_t depth() const { return _depth; }
+
+  // All blocks of the loop (including subloops) in reverse postorder
+  // The header is always the first one
+  const std::vector<BasicBlock *> &blocks() const { return _blocks; }
+  bool contains(const BasicBlock &bb) const { return _blocks_set.count(&bb); }
+
+  // Blocks of the loop with a back edge to the header
+  const std::vector<BasicBlock *> &latches() const { return _latches; }
+
+  // Blocks outside of the loop with a pred inside
+  const std::vector<BasicBlock *> &exits() const { return _exits; }
+
+  // Only pred of the header outside of the loop, if it has no other succ
+  // nullptr otherwise
+  BasicBlock *preheader() const { return _preheader; }
+
+private:
+  BasicBlock *_header;
+  Loop *_parent = nullptr;
+  std::vector<Loop *> _children;
+  std::size_t _depth = 0;
+  std::vector<BasicBlock *> _blocks;
+  std::set<const BasicBlock *> _blocks_set;
+  std::vector<BasicBlock *> _latches;
+  std::vector<BasicBlock *> _exits;
+  BasicBlock *_preheader = nullptr;
+
+  friend class LoopInfo;
+};
+
+// Find all natural loops of a function, and build the loop nesting forest
+// - An edge u -> h is a back edge if h dominates u
+// - The loop of h contains h and all blocks that reach a latch without going
+//   through h (all loops with the same header are merged)
+// Headers are visited in postorder, so inner loops are found first. When
+// walking back from the latches, an inner loop is skipped by jumping directly
+// to the preds of its header, each block is visited only once per loop depth.
+//
+// A retreating edge (going backward in reverse postorder) that isn't a back
+// edge means the CFG is irreducible: the cycle has several entries, and it's
+// not a natural loop. The strongly connected component of these edges is
+// reported as an irreducible region, and its blocks aren't part of a loop
+// (unless it's nested inside a natural loop). Transformations must be
+// conservative on these blocks.
+//
+// Identifying Loops Using DJ Graphs - Sreedhar, Gao & Lee
+// Nesting of Reducible and Irreducible Loops - Havlak
+class LoopInfo {
+public:
+  LoopInfo(Function &fun, const CFG &cfg, const IDom &idom);
+  LoopInfo(const LoopInfo &) = delete;
+  LoopInfo &operator=(const LoopInfo &) = delete;
+
+  // Innermost loop containing bb, or nullptr
+  Loop *loop_of(const BasicBlock &bb) const;
+
+  // Number of loops containing bb (0 if not in a loop)
+  std::size_t depth(const BasicBlock &bb) const;
+
+  bool is_header(const BasicBlock &bb) const;
+
+  // Outermost loops, in reverse postorder of their header
+  const std::vector<Loop *> &top_level() const { return _top_level; }
+
+  // All loops, inner loops before outer ones
+  const std::vector<Loop *> &loops() const { return _loops_po; }
+
+  // Irreducible regions: blocks of the region, and its entries
+  struct Region {
+    std::vector<BasicBlock *> blocks;
+    std::vector<BasicBlock *> entries;
+  };
+  const std::vector<Region> &irreducible() const { return _irreducible; }
+  bool is_irreducible(const BasicBlock &bb) const {
+    return _irreducible_bbs.count(&bb);
+  }
+
+  void dump(std::ostream &os) const;
+
+private:
+  Function &_fun;
+  const CFG &_cfg;
+  const IDom &_idom;
+
+  std::vector<BasicBlock *> _rpo;
+  std::map<const BasicBlock *, std::size_t> _rpo_pos;
+
+  std::vector<std::unique_ptr<Loop>> _loops;
+  std::vector<Loop *> _loops_po;
+  std::vector<Loop *> _top_level;
+  std::map<const BasicBlock *, Loop *> _loop_of;
+
+  std::vector<Region> _irreducible;
+  std::set<const BasicBlock *> _irreducible_bbs;
+
+  bool _dominates(const BasicBlock &a, const BasicBlock &b) const;
+  void _build_loop(BasicBlock &header);
+  void _fill_loops();
+  void _find_irreducible();
+  void _dump_loop(std::ostream &os, const Loop &loop) const;
+};
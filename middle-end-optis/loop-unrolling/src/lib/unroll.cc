@@ -0,0 +1,466 @@
+#include "unroll.hh"
+
+#include <iostream>
+#include <set>
+#include <unordered_map>
+
+#include "cfg.hh"
+#include "const-folder.hh"
+#include "idom.hh"
+#include "loop-info.hh"
+#include "sparse-dataflow.hh"
+
+namespace {
+
+// The trip count is not searched further
+constexpr std::size_t MAX_TRIP_COUNT = 1024;
+
+// Loop with the shape required by the unroller
+struct LoopShape {
+  BasicBlock *pre;
+  BasicBlock *header;
+  BasicBlock *latch;
+  BasicBlock *exiting;
+  BasicBlock *exit;
+  std::vector<Instruction *> phis; // header phis
+
+  std::string cmp;  // cmplt / beq
+  bool cont_first;  // the first target of the exit branch stays in the loop
+  bool iv_first;    // the induction variable is the first operand of cmp
+  bool test_next;   // cmp uses iv + step instead of iv
+  Instruction *iv;  // header phi
+  Value *bound;     // loop invariant
+  Instruction *cmp_ins;
+  long step;
+};
+
+class Unroller {
+
+public:
+  Unroller(Function &fun, std::size_t factor, std::size_t budget)
+      : _fun(fun), _factor(factor), _budget(budget) {}
+
+  void run() {
+    // Analyses are built again after each transformation
+    // Headers are identified by name, blocks may be deleted
+    std::set<std::string> done;
+    for (;;) {
+      CFG cfg(_fun);
+      IDom idom(_fun, cfg);
+      LoopInfo li(_fun, cfg, idom);
+      SparseDataflow<ConstLattice> sccp(_fun, /*track_exec=*/true);
+      sccp.run();
+
+      const Loop *loop = nullptr;
+      for (auto l : li.loops())
+        if (l->children().empty() && !done.count(l->header().get_name())) {
+          loop = l;
+          break;
+        }
+      if (!loop)
+        break;
+
+      done.insert(loop->header().get_name());
+      LoopShape shape;
+      std::string err = _match(*loop, cfg, idom, sccp, shape);
+      if (!err.empty()) {
+        std::cout << "Skip loop " << _name(*loop) << ": " << err << "\n";
+        continue;
+      }
+
+      std::size_t size = 0;
+      for (auto bb : loop->blocks())
+        for (auto it = bb->ins_begin(); it != bb->ins_end(); ++it)
+          ++size;
+
+      long trip;
+      if (_trip_count(shape, sccp, trip) &&
+          std::size_t(trip) * size <= _budget) {
+        _unroll_full(*loop, shape, trip);
+        continue;
+      }
+
+      auto factor = _factor;
+      while (factor > 1 && factor * size > _budget)
+        --factor;
+      if (factor < 2) {
+        std::cout << "Skip loop " << _name(*loop) << ": over budget\n";
+      } else if (shape.cmp != "cmplt" ||
+                 (shape.cont_first == shape.iv_first) != (shape.step > 0)) {
+        std::cout << "Skip loop " << _name(*loop)
+                  << ": unknown trip count, and not monotonic test\n";
+      } else
+        done.insert(_unroll_partial(*loop, shape, factor).get_name());
+    }
+  }
+
+private:
+  using vmap_t = std::unordered_map<const Value *, Value *>;
+
+  Function &_fun;
+  const std::size_t _factor;
+  const std::size_t _budget;
+
+  // Copies of the loop
+  std::vector<vmap_t> _vmaps;
+  // _phis[k]: value of each header phi in copy k
+  std::vector<vmap_t> _phis;
+  std::set<BasicBlock *> _copies;
+
+  std::string _name(const Loop &loop) const {
+    return loop.header().get_name() + " of " + _fun.get_name();
+  }
+
+  std::string _match(const Loop &loop, const CFG &cfg, const IDom &idom,
+                     const SparseDataflow<ConstLattice> &sccp,
+                     LoopShape &shape) {
+    shape.header = &loop.header();
+    shape.pre = loop.preheader();
+    if (!shape.pre)
+      return "no preheader";
+    if (loop.latches().size() != 1)
+      return "several latches";
+    shape.latch = loop.latches().front();
+
+    std::size_t nexits = 0;
+    for (auto bb : loop.blocks())
+      for (auto succ : cfg.succs(*bb))
+        if (!loop.contains(*succ)) {
+          shape.exiting = bb;
+          shape.exit = succ;
+          ++nexits;
+        }
+    if (nexits != 1)
+      return "several exits";
+
+    auto doms = idom.dom(*shape.latch);
+    if (std::find(doms.begin(), doms.end(), shape.exiting) == doms.end())
+      return "exit test not executed on every iteration";
+
+    for (auto &ins : shape.header->ins())
+      if (ins.get_opname() == "phi")
+        shape.phis.push_back(&ins);
+
+    // Exit test
+    auto &br = shape.exiting->ins().back();
+    Value *lhs;
+    Value *rhs;
+    if (br.get_opname() == "beq") {
+      shape.cmp = "beq";
+      shape.cmp_ins = &br;
+      lhs = &br.op(0);
+      rhs = &br.op(1);
+    } else {
+      auto cmp = dynamic_cast<Instruction *>(&br.op(0));
+      if (br.get_opname() != "bc" || !cmp || cmp->get_opname() != "cmplt")
+        return "exit test isn't cmplt or beq";
+      shape.cmp = "cmplt";
+      shape.cmp_ins = cmp;
+      lhs = &cmp->op(0);
+      rhs = &cmp->op(1);
+    }
+    shape.cont_first = loop.contains(*br.branch_targets()[0]);
+
+    // Induction variable
+    for (auto x : {lhs, rhs}) {
+      shape.iv_first = x == lhs;
+      shape.bound = shape.iv_first ? rhs : lhs;
+      auto bound_ins = dynamic_cast<Instruction *>(shape.bound);
+      if (bound_ins && loop.contains(bound_ins->parent()))
+        continue;
+      if (_match_iv(*x, shape, sccp))
+        return "";
+    }
+    return "no induction variable in exit test";
+  }
+
+  // x is iv, or iv + step
+  bool _match_iv(Value &x, LoopShape &shape,
+                 const SparseDataflow<ConstLattice> &sccp) {
+    auto ins = dynamic_cast<Instruction *>(&x);
+    if (!ins)
+      return false;
+
+    shape.test_next = ins->get_opname() != "phi";
+    auto next = ins;
+    if (!shape.test_next)
+      next = dynamic_cast<Instruction *>(&_latch_val(*ins, shape));
+    else if (ins->get_opname() == "add" || ins->get_opname() == "sub")
+      ins = dynamic_cast<Instruction *>(&ins->op(0));
+    else
+      return false;
+
+    if (!ins || !next || &ins->parent() != shape.header ||
+        ins->get_opname() != "phi" || &_latch_val(*ins, shape) != next ||
+        (next->get_opname() != "add" && next->get_opname() != "sub") ||
+        &next->op(0) != ins || !sccp.get(next->op(1)).get_const(shape.step) ||
+        !shape.step)
+      return false;
+
+    if (next->get_opname() == "sub")
+      shape.step = -shape.step;
+    shape.iv = ins;
+    return true;
+  }
+
+  static Value &_latch_val(Instruction &phi, const LoopShape &shape) {
+    for (std::size_t i = 0; i < phi.ops_count(); i += 2)
+      if (&phi.op(i) == shape.latch)
+        return phi.op(i + 1);
+    assert(0);
+  }
+
+  static Value &_init_val(Instruction &phi, const LoopShape &shape) {
+    for (std::size_t i = 0; i < phi.ops_count(); i += 2)
+      if (&phi.op(i) == shape.pre)
+        return phi.op(i + 1);
+    assert(0);
+  }
+
+  // Number of times the exit test is evaluated
+  bool _trip_count(const LoopShape &shape,
+                   const SparseDataflow<ConstLattice> &sccp, long &trip) {
+    long iv;
+    long bound;
+    if (!sccp.get(_init_val(*shape.iv, shape)).get_const(iv) ||
+        !sccp.get(*shape.bound).get_const(bound))
+      return false;
+
+    // The IV wraps on overflow, as at runtime
+    for (trip = 1; trip <= long(MAX_TRIP_COUNT); ++trip) {
+      long next;
+      const_fold("add", {iv, shape.step}, next);
+      long x = shape.test_next ? next : iv;
+      long taken_first;
+      const_fold(shape.cmp,
+                 shape.iv_first ? std::vector<long>{x, bound}
+                                : std::vector<long>{bound, x},
+                 taken_first);
+      if (bool(taken_first) != shape.cont_first)
+        return true;
+      iv = next;
+    }
+    return false;
+  }
+
+  // Value of v in the copy k
+  Value &_val(Value &v, std::size_t k) const {
+    auto it = _phis[k].find(&v);
+    if (it != _phis[k].end())
+      return *it->second;
+    auto vit = _vmaps[k].find(&v);
+    return vit != _vmaps[k].end() ? *vit->second : v;
+  }
+
+  // Make n copies of the loop, before the header
+  // Header phis are replaced with the init value for the first copy (or the
+  // values of first_phis), and the values of the previous copy for the others
+  // The latch of a copy jumps to the header of the next one, the latch of the
+  // last one is not updated
+  // Exit branches are replaced by a jump inside the loop
+  void _make_copies(const Loop &loop, const LoopShape &shape, std::size_t n,
+                    const vmap_t &first_phis) {
+    _vmaps.assign(n, {});
+    _phis.assign(n, {});
+    _copies.clear();
+
+    for (std::size_t k = 0; k < n; ++k) {
+      auto suffix = "_u" + std::to_string(k);
+      auto &vmap = _vmaps[k];
+      std::vector<Instruction *> copy_ins;
+
+      for (auto bb : loop.blocks()) {
+        auto &nbb = *_fun.insert_bb(bb_iterator_t(shape.header),
+                                    bb->get_name() + suffix);
+        vmap[bb] = &nbb;
+        _copies.insert(&nbb);
+        for (auto &ins : bb->ins()) {
+          auto &nins = *nbb.insert_ins(
+              nbb.ins_end(), ins.get_opname(), ins.ops(),
+              ins.has_def() ? ins.get_name() + suffix : "", ins.get_def_idx());
+          vmap[&ins] = &nins;
+          copy_ins.push_back(&nins);
+        }
+      }
+
+      for (auto ins : copy_ins)
+        for (std::size_t i = 0; i < ins->ops_count(); ++i) {
+          auto it = vmap.find(&ins->op(i));
+          if (it != vmap.end())
+            ins->set_op(i, *it->second);
+        }
+
+      for (auto phi : shape.phis) {
+        auto &val = k == 0 ? *first_phis.at(phi)
+                           : _val(_latch_val(*phi, shape), k - 1);
+        _phis[k][phi] = &val;
+        auto nphi = dynamic_cast<Instruction *>(vmap.at(phi));
+        nphi->replace_all_uses_with(val);
+        nphi->erase_from_parent();
+        vmap.erase(phi);
+      }
+
+      auto &br = dynamic_cast<BasicBlock *>(vmap.at(shape.exiting))
+                     ->ins()
+                     .back();
+      auto target = br.branch_targets()[shape.cont_first ? 0 : 1];
+      br.parent().insert_ins(ins_iterator_t(&br), "b", {target}, "",
+                             isa::IDX_NO);
+      br.erase_from_parent();
+
+      if (k > 0)
+        _retarget(_val(*shape.latch, k - 1), _val(*shape.header, k - 1),
+                  _val(*shape.header, k));
+    }
+  }
+
+  // Replace target from by to in the branch of bb
+  static void _retarget(Value &bb, Value &from, Value &to) {
+    auto &br = dynamic_cast<BasicBlock &>(bb).ins().back();
+    for (std::size_t i = 0; i < br.ops_count(); ++i)
+      if (&br.op(i) == &from)
+        br.set_op(i, to);
+  }
+
+  void _unroll_full(const Loop &loop, const LoopShape &shape, long trip) {
+    std::cout << "Full unroll loop " << _name(loop) << ": trip count " << trip
+              << "\n";
+
+    vmap_t init;
+    for (auto phi : shape.phis)
+      init[phi] = &_init_val(*phi, shape);
+    _make_copies(loop, shape, trip, init);
+    auto last = trip - 1;
+    auto &last_exiting = dynamic_cast<BasicBlock &>(_val(*shape.exiting, last));
+
+    // The last copy always exits
+    last_exiting.ins().back().set_op(0, *shape.exit);
+    _retarget(*shape.pre, *shape.header, _val(*shape.header, 0));
+
+    // Values used after the loop come from the last copy
+    for (auto bb : loop.blocks())
+      for (auto &ins : bb->ins())
+        for (auto user : ins.get_users()) {
+          auto uins = dynamic_cast<Instruction *>(user);
+          if (loop.contains(uins->parent()) || _copies.count(&uins->parent()))
+            continue;
+          for (std::size_t i = 0; i < uins->ops_count(); ++i)
+            if (&uins->op(i) == &ins)
+              uins->set_op(i, _val(ins, last));
+        }
+    for (auto &ins : shape.exit->ins())
+      if (ins.get_opname() == "phi")
+        for (std::size_t i = 0; i < ins.ops_count(); i += 2)
+          if (&ins.op(i) == shape.exiting)
+            ins.set_op(i, last_exiting);
+
+    for (auto bb : loop.blocks())
+      bb->erase_from_parent();
+    _remove_unreachable();
+    _remove_dead();
+  }
+
+  BasicBlock &_unroll_partial(const Loop &loop, const LoopShape &shape,
+                              std::size_t factor) {
+    std::cout << "Unroll loop " << _name(loop) << " by " << factor << "\n";
+
+    auto &guard = *_fun.insert_bb(bb_iterator_t(shape.header),
+                                  shape.header->get_name() + "_guard");
+    vmap_t guard_phis;
+    for (auto phi : shape.phis) {
+      auto &init = _init_val(*phi, shape);
+      // Incoming values from the unrolled loop are set after the copies
+      guard_phis[phi] = &*guard.insert_ins(
+          guard.ins_end(), "phi", {shape.pre, &init, shape.pre, &init},
+          phi->get_name() + "_g", 1);
+    }
+
+    _make_copies(loop, shape, factor, guard_phis);
+    auto last = factor - 1;
+    auto &last_latch = _val(*shape.latch, last);
+    _retarget(last_latch, _val(*shape.header, last), guard);
+    for (auto phi : shape.phis) {
+      auto gphi = dynamic_cast<Instruction *>(guard_phis.at(phi));
+      gphi->set_op(2, last_latch);
+      gphi->set_op(3, _val(_latch_val(*phi, shape), last));
+    }
+
+    // Test of iteration factor - 1, from the values at the guard
+    long ahead = (factor - 1) * shape.step + (shape.test_next ? shape.step : 0);
+    auto &iv =
+        *guard.insert_ins(guard.ins_end(), "add",
+                          {guard_phis.at(shape.iv), ValueConst::make(ahead)},
+                          shape.iv->get_name() + "_ahead", 1);
+    auto &cmp = *guard.insert_ins(
+        guard.ins_end(), "cmplt",
+        shape.iv_first ? std::vector<Value *>{&iv, shape.bound}
+                       : std::vector<Value *>{shape.bound, &iv},
+        shape.cmp_ins->get_name() + "_g", 1);
+    auto &unrolled = _val(*shape.header, 0);
+    guard.insert_ins(guard.ins_end(), "bc",
+                     {&cmp, shape.cont_first ? &unrolled : shape.header,
+                      shape.cont_first ? shape.header : &unrolled},
+                     "", isa::IDX_NO);
+
+    // The original loop is now the remainder loop
+    _retarget(*shape.pre, *shape.header, guard);
+    for (auto phi : shape.phis)
+      for (std::size_t i = 0; i < phi->ops_count(); i += 2)
+        if (&phi->op(i) == shape.pre) {
+          phi->set_op(i, guard);
+          phi->set_op(i + 1, *guard_phis.at(phi));
+        }
+
+    _remove_dead();
+    return guard;
+  }
+
+  void _remove_unreachable() {
+    std::set<BasicBlock *> reached{&_fun.get_entry_bb()};
+    std::vector<BasicBlock *> work{&_fun.get_entry_bb()};
+    while (!work.empty()) {
+      auto bb = work.back();
+      work.pop_back();
+      for (auto succ : bb->ins().back().branch_targets())
+        if (reached.insert(succ).second)
+          work.push_back(succ);
+    }
+
+    std::vector<BasicBlock *> dead;
+    for (auto &bb : _fun.bb())
+      if (!reached.count(&bb))
+        dead.push_back(&bb);
+    for (auto bb : dead) {
+      _copies.erase(bb);
+      bb->erase_from_parent();
+    }
+  }
+
+  // Instructions of the copies only used by the exit tests
+  void _remove_dead() {
+    bool changed = true;
+    while (changed) {
+      changed = false;
+      for (auto bb : _copies)
+        for (auto it = bb->ins_begin(); it != bb->ins_end();) {
+          auto &ins = *it++;
+          if (ins.has_def() && ins.get_opname() != "call" &&
+              ins.get_users().empty()) {
+            ins.erase_from_parent();
+            changed = true;
+          }
+        }
+    }
+  }
+};
+
+} // namespace
+
+void unroll_run(Module &mod, std::size_t factor, std::size_t budget) {
+  for (auto &fun : mod.fun()) {
+    if (!fun.has_def())
+      continue;
+    Unroller unroller(fun, factor, budget);
+    unroller.run();
+  }
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "module.hh"
+
+// Loop Unrolling
+// Only innermost loops with this shape are unrolled:
+// - a preheader, a single latch, and a single exit edge
+// - the exiting block dominates the latch, so every iteration evaluates the
+//   exit test once
+// - the test compares an induction variable (a header phi `i`, or `i + step`
+//   with a constant step) with a loop invariant bound: `cmplt` + `bc`, or
+//   `beq`
+// An iteration is a copy of all blocks of the loop, where the exit branch is
+// replaced by a jump to the next block inside the loop. The latch of a copy
+// jumps to the header of the next one, and the header phis of a copy are
+// replaced by the values of the previous copy.
+//
+// Full unrolling: if the initial value and the bound are constants (using
+// SCCP), the trip count is found by evaluating the test on every iteration.
+// The loop is replaced by trip count copies, only the last copy exits.
+//
+// Partial unrolling: the loop is unrolled by factor, the original loop is kept
+// for the remaining iterations. A guard block before the unrolled loop checks
+// that the test still passes factor - 1 iterations ahead (the test must be
+// monotonic in the direction of the step, so only for `cmplt`).
+// There is no division in the ISA, the remainder loop is entered once the
+// guard fails, instead of computing the trip count modulo factor.
+// Overflow of the induction variable is assumed to never happen.
+//
+// budget is the maximum number of instructions of all the copies of a loop.
+//
+// Loop Unrolling - Engineer a Compiler p442
+void unroll_run(Module &mod, std::size_t factor, std::size_t budget);
@@ -0,0 +1,45 @@
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#include "lib/loader.hh"
+#include "lib/module.hh"
+#include "lib/unroll.hh"
+
+namespace {
+
+constexpr std::size_t DEFAULT_FACTOR = 4;
+constexpr std::size_t DEFAULT_BUDGET = 64;
+
+} // namespace
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    std::cerr << "Usage: loop-unrolling <src-file> [--factor <n>] "
+                 "[--budget <ins-count>]"
+              << std::endl;
+    return 1;
+  }
+
+  auto in_file = argv[1];
+  auto mod = load_module(in_file);
+
+  std::size_t factor = DEFAULT_FACTOR;
+  std::size_t budget = DEFAULT_BUDGET;
+  for (int i = 2; i + 1 < argc; i += 2) {
+    if (!strcmp(argv[i], "--factor"))
+      factor = std::atoi(argv[i + 1]);
+    else if (!strcmp(argv[i], "--budget"))
+      budget = std::atoi(argv[i + 1]);
+  }
+
+  unroll_run(*mod, factor, budget);
+  mod->check();
+
+  auto gout = mod2gop(*mod);
+  gout.dump(std::cout);
+  isa::check(gout);
+
+  return 0;
+}
@@ -0,0 +1,396 @@
+#include "osr.hh"
+
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include <set>
+#include <tuple>
+#include <unordered_map>
+
+#include "cfg.hh"
+#include "idom.hh"
+
+namespace {
+
+// Arithmetic is done on unsigned to get wrapping instead of UB on overflow
+long fold(const std::string &op, long x, long y) {
+  auto ux = static_cast<unsigned long>(x);
+  auto uy = static_cast<unsigned long>(y);
+  return static_cast<long>(op == "add"   ? ux + uy
+                           : op == "sub" ? ux - uy
+                                         : ux * uy);
+}
+
+class OSR {
+
+public:
+  OSR(Function &fun) : _fun(fun), _cfg(_fun), _idom(_fun, _cfg) {
+    const auto &mva = _cfg.mva(_fun);
+    for (auto bb : _cfg.rev_postorder())
+      _rpo_pos.emplace(mva(_cfg.va()(bb)), _rpo_pos.size());
+  }
+
+  void run() {
+    for (auto &bb : _fun.bb())
+      for (auto &ins : bb.ins())
+        if (ins.has_def() && !_num.count(&ins))
+          _dfs(ins);
+
+    // SCCs are found in reverse topological order: operands first
+    for (const auto &scc : _sccs)
+      _process(scc);
+
+    _lftr();
+    _remove_dead();
+  }
+
+private:
+  // Reduced IV dst is IV src `op` rc
+  struct Edge {
+    std::string op;
+    Value *rc;
+    Value *dst;
+  };
+
+  using key_t = std::tuple<std::string, Value *, Value *>;
+
+  Function &_fun;
+  CFG _cfg;
+  IDom _idom;
+  std::unordered_map<const BasicBlock *, std::size_t> _rpo_pos;
+
+  // Tarjan SCC
+  std::unordered_map<Instruction *, std::size_t> _num;
+  std::unordered_map<Instruction *, std::size_t> _low;
+  std::vector<Instruction *> _stack;
+  std::set<Instruction *> _on_stack;
+  std::vector<std::vector<Instruction *>> _sccs;
+
+  std::unordered_map<const Value *, BasicBlock *> _header; // IV -> header
+  std::map<key_t, Value *> _ops;                           // (op, iv, rc)
+  std::unordered_map<const Value *, std::vector<Edge>> _edges;
+
+  // SCCs classified as IVs, and candidates replaced by a reduced IV
+  std::vector<std::vector<Instruction *>> _ivs;
+  std::unordered_map<const Value *, std::size_t> _iv_scc;
+  std::set<const Value *> _reduced;
+  std::size_t _next_name = 0;
+
+  void _dfs(Instruction &ins) {
+    auto id = _num.size();
+    _num[&ins] = id;
+    _low[&ins] = id;
+    _stack.push_back(&ins);
+    _on_stack.insert(&ins);
+
+    for (auto op : ins.ops()) {
+      auto def = dynamic_cast<Instruction *>(op);
+      if (!def)
+        continue;
+      if (!_num.count(def)) {
+        _dfs(*def);
+        _low[&ins] = std::min(_low[&ins], _low[def]);
+      } else if (_on_stack.count(def))
+        _low[&ins] = std::min(_low[&ins], _num[def]);
+    }
+
+    if (_low[&ins] != _num[&ins])
+      return;
+
+    std::vector<Instruction *> scc;
+    Instruction *node;
+    do {
+      node = _stack.back();
+      _stack.pop_back();
+      _on_stack.erase(node);
+      scc.push_back(node);
+    } while (node != &ins);
+    _sccs.push_back(scc);
+  }
+
+  BasicBlock *_header_of(const Value &v) const {
+    auto it = _header.find(&v);
+    return it == _header.end() ? nullptr : it->second;
+  }
+
+  // Block where v is defined
+  BasicBlock &_def_block(Value &v) {
+    auto ins = dynamic_cast<Instruction *>(&v);
+    return ins ? ins->parent() : _fun.get_entry_bb();
+  }
+
+  bool _dominates(const BasicBlock &a, const BasicBlock &b) const {
+    for (auto d : _idom.dom(b))
+      if (d == &a)
+        return true;
+    return false;
+  }
+
+  // Region constant of the loop of header
+  bool _is_rc(Value &v, const BasicBlock &header) {
+    if (!dynamic_cast<Instruction *>(&v))
+      return true;
+    auto &bb = _def_block(v);
+    return &bb != &header && _dominates(bb, header);
+  }
+
+  void _process(const std::vector<Instruction *> &scc) {
+    if (scc.size() == 1) {
+      auto ops = scc.front()->ops();
+      if (std::find(ops.begin(), ops.end(), scc.front()) == ops.end()) {
+        _process_single(*scc.front());
+        return;
+      }
+    }
+
+    if (_classify_iv(scc))
+      return;
+    for (auto n : scc)
+      _process_single(*n);
+  }
+
+  bool _classify_iv(const std::vector<Instruction *> &scc) {
+    std::set<const Value *> nodes(scc.begin(), scc.end());
+    BasicBlock *header = &scc.front()->parent();
+    for (auto n : scc)
+      if (_rpo_pos.at(&n->parent()) < _rpo_pos.at(header))
+        header = &n->parent();
+
+    for (auto n : scc) {
+      const auto &opname = n->get_opname();
+      if (opname == "phi") {
+        for (std::size_t i = 1; i < n->ops_count(); i += 2)
+          if (!nodes.count(&n->op(i)) && !_is_rc(n->op(i), *header))
+            return false;
+        continue;
+      }
+
+      if (opname != "add" && opname != "sub" && opname != "mov")
+        return false;
+      std::size_t in_scc = 0;
+      for (std::size_t i = 0; i < n->ops_count(); ++i) {
+        if (nodes.count(&n->op(i)))
+          ++in_scc;
+        else if (!_is_rc(n->op(i), *header))
+          return false;
+      }
+      // sub rc, iv is a negation
+      if (in_scc != 1 || (opname == "sub" && !nodes.count(&n->op(0))))
+        return false;
+    }
+
+    for (auto n : scc) {
+      _header[n] = header;
+      _iv_scc[n] = _ivs.size();
+    }
+    _ivs.push_back(scc);
+    return true;
+  }
+
+  void _process_single(Instruction &n) {
+    const auto &opname = n.get_opname();
+    if (opname != "add" && opname != "sub" && opname != "mul")
+      return;
+
+    auto &a = n.op(0);
+    auto &b = n.op(1);
+    auto ha = _header_of(a);
+    auto hb = _header_of(b);
+    if (ha && _is_rc(b, *ha))
+      _replace(n, a, b);
+    else if (hb && opname != "sub" && _is_rc(a, *hb))
+      _replace(n, b, a);
+  }
+
+  void _replace(Instruction &n, Value &iv, Value &rc) {
+    std::cout << "Reduce: ";
+    n.dump(std::cout);
+    std::cout << "\n";
+    auto &res = _reduce(n.get_opname(), iv, rc);
+    n.replace_all_uses_with(res);
+    _reduced.insert(&n);
+  }
+
+  // Create a new IV, equal to iv `op` rc
+  Value &_reduce(const std::string &op, Value &iv, Value &rc) {
+    key_t key(op, &iv, &rc);
+    auto it = _ops.find(key);
+    if (it != _ops.end())
+      return *it->second;
+
+    auto &def = dynamic_cast<Instruction &>(iv);
+    auto &bb = def.parent();
+    bool is_phi = def.get_opname() == "phi";
+    auto pos = is_phi ? bb.ins_begin() : ins_iterator_t(&def) + 1;
+    auto &res =
+        *bb.insert_ins(pos, def.get_opname(), def.ops(), _new_name(), 1);
+    _ops.emplace(key, &res);
+    _header[&res] = _header_of(iv);
+    _edges[&iv].push_back(Edge{op, &rc, &res});
+
+    for (std::size_t i = is_phi ? 1 : 0; i < res.ops_count(); i += 1 + is_phi) {
+      auto &o = res.op(i);
+      if (_header_of(o) == _header_of(iv))
+        res.set_op(i, _reduce(op, o, rc));
+      else if (op == "mul" || is_phi)
+        res.set_op(i, _apply(op, o, rc));
+    }
+
+    return res;
+  }
+
+  // Value of o1 `op` o2, inserted where both operands are available
+  Value &_apply(const std::string &op, Value &o1, Value &o2) {
+    key_t key(op, &o1, &o2);
+    auto it = _ops.find(key);
+    if (it != _ops.end())
+      return *it->second;
+
+    auto h1 = _header_of(o1);
+    auto h2 = _header_of(o2);
+    if (h1 && _is_rc(o2, *h1))
+      return _reduce(op, o1, o2);
+    if (h2 && op != "sub" && _is_rc(o1, *h2))
+      return _reduce(op, o2, o1);
+
+    auto c1 = dynamic_cast<ValueConst *>(&o1);
+    auto c2 = dynamic_cast<ValueConst *>(&o2);
+    if (c1 && c2) {
+      auto x = c1->get_val();
+      auto y = c2->get_val();
+      return *ValueConst::make(fold(op, x, y));
+    }
+
+    // Identities, mostly for initial values and increments of 0 / 1
+    auto is_cst = [](ValueConst *c, long val) {
+      return c && c->get_val() == val;
+    };
+    if (op == "mul" && is_cst(c1, 0))
+      return o1;
+    if (op == "mul" && is_cst(c2, 0))
+      return o2;
+    if ((op == "mul" && is_cst(c1, 1)) || (op == "add" && is_cst(c1, 0)))
+      return o2;
+    if ((op == "mul" && is_cst(c2, 1)) || (op != "mul" && is_cst(c2, 0)))
+      return o1;
+
+    // Both blocks dominate the use, the deepest one is dominated by the other
+    auto &b1 = _def_block(o1);
+    auto &b2 = _def_block(o2);
+    auto &bb = _dominates(b1, b2) ? b2 : b1;
+    auto &res =
+        *bb.insert_ins(bb.ins_end() - 1, op, {&o1, &o2}, _new_name(), 1);
+    _ops.emplace(key, &res);
+    return res;
+  }
+
+  std::string _new_name() { return "sr" + std::to_string(_next_name++); }
+
+  void _lftr() {
+    std::vector<Instruction *> tests;
+    for (auto &bb : _fun.bb())
+      for (auto &ins : bb.ins())
+        if (ins.get_opname() == "cmplt" || ins.get_opname() == "beq")
+          tests.push_back(&ins);
+
+    // Comparison operands are the first 2 of cmplt (after the def) and beq
+    for (auto ins : tests)
+      for (std::size_t p = 0; p < 2; ++p) {
+        auto header = _header_of(ins->op(p));
+        if (header && _is_rc(ins->op(1 - p), *header) &&
+            _only_test_use(*ins, ins->op(p)) && _lftr_replace(*ins, p))
+          break;
+      }
+  }
+
+  // All uses of the IV of iv are in its SCC, in test, or in reduced candidates
+  bool _only_test_use(const Instruction &test, const Value &iv) const {
+    auto it = _iv_scc.find(&iv);
+    if (it == _iv_scc.end())
+      return false;
+    const auto &scc = _ivs[it->second];
+    for (auto n : scc)
+      for (auto user : n->get_users())
+        if (user != &test && !_reduced.count(user) &&
+            std::find(scc.begin(), scc.end(), user) == scc.end())
+          return false;
+    return true;
+  }
+
+  bool _lftr_replace(Instruction &ins, std::size_t pos) {
+    bool is_lt = ins.get_opname() == "cmplt";
+    Value *iv = &ins.op(pos);
+    Value *bound = &ins.op(1 - pos);
+
+    for (;;) {
+      auto it = _edges.find(iv);
+      if (it == _edges.end())
+        break;
+      // Multiplication must keep the order (cmplt) or be injective modulo
+      // 2^64 (beq): only odd constants are invertible
+      auto next = std::find_if(
+          it->second.begin(), it->second.end(), [is_lt](const Edge &e) {
+            auto c = dynamic_cast<ValueConst *>(e.rc);
+            return e.op != "mul" ||
+                   (c && (is_lt ? c->get_val() > 0 : c->get_val() % 2 != 0));
+          });
+      if (next == it->second.end())
+        break;
+      bound = &_apply(next->op, *bound, *next->rc);
+      iv = next->dst;
+    }
+
+    if (iv == &ins.op(pos))
+      return false;
+
+    std::cout << "LFTR: ";
+    ins.dump(std::cout);
+    ins.set_op(pos, *iv);
+    ins.set_op(1 - pos, *bound);
+    std::cout << " => ";
+    ins.dump(std::cout);
+    std::cout << "\n";
+    return true;
+  }
+
+  // Mark and sweep: branches and calls are always live
+  void _remove_dead() {
+    std::set<Instruction *> live;
+    std::vector<Instruction *> work;
+    for (auto &bb : _fun.bb())
+      for (auto &ins : bb.ins())
+        if (ins.is_branch() || ins.get_opname() == "call") {
+          live.insert(&ins);
+          work.push_back(&ins);
+        }
+
+    while (!work.empty()) {
+      auto ins = work.back();
+      work.pop_back();
+      for (auto op : ins->ops()) {
+        auto def = dynamic_cast<Instruction *>(op);
+        if (def && live.insert(def).second)
+          work.push_back(def);
+      }
+    }
+
+    std::vector<Instruction *> dead;
+    for (auto &bb : _fun.bb())
+      for (auto &ins : bb.ins())
+        if (!live.count(&ins))
+          dead.push_back(&ins);
+    for (auto ins : dead)
+      ins->erase_from_parent();
+  }
+};
+
+} // namespace
+
+void osr_run(Module &mod) {
+  for (auto &fun : mod.fun()) {
+    if (!fun.has_def())
+      continue;
+    OSR osr(fun);
+    osr.run();
+  }
+}
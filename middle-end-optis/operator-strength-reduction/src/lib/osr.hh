@@ -0,0 +1,35 @@
+#pragma once
+
+#include "module.hh"
+
+// Operator Strength Reduction
+// Works directly on the SSA graph: the nodes are the instructions, with an
+// edge from each instruction to the definitions of its operands.
+// The strongly connected components are found with Tarjan's algorithm, which
+// gives them operands first.
+//
+// - A region constant (RC) of a loop with header h is a constant, an argument,
+//   or a value defined in a block that strictly dominates h.
+// - An induction variable (IV) is a SCC made only of phi, add, sub and mov,
+//   where each operand is either in the SCC or a RC. Its header is the block
+//   of the SCC which comes first in reverse postorder.
+// - A candidate is `mul iv, rc`, `add iv, rc`, `sub iv, rc` (or commuted).
+//
+// A candidate is replaced by a new IV, computed by copying the IV and
+// applying the operation to its initial values (and to its increments for a
+// multiplication). The result is a new IV, so instructions using the
+// candidate can be reduced too: `add %base, %t` with `mul %t, %i, 4` becomes
+// a pointer incremented by 4.
+// Copies are hashed by (op, iv, rc), so a value is never reduced twice.
+//
+// Linear Function Test Replacement: when an IV is only used by the loop test
+// (and by its own cycle, and candidates already reduced), the comparison is
+// moved to the last reduced IV derived from it, by applying the same
+// operations to the other operand. Multiplications are only followed by a
+// constant that keeps the comparison valid (> 0 for cmplt, odd for beq, the
+// only constants invertible modulo 2^64).
+// The old IVs are then dead, and removed with all other dead instructions.
+//
+// Operator Strength Reduction - Cooper, Simpson & Vick
+// Operator Strength Reduction - Engineer a Compiler p580
+void osr_run(Module &mod);
@@ -0,0 +1,113 @@
+#include "icache-sim.hh"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iomanip>
+
+#include <utils/cli/err.hh>
+#include <utils/str/str.hh>
+
+namespace {
+
+void parse_desc(const std::string &desc, std::size_t &x, std::size_t &y,
+                std::size_t &z) {
+  auto vals = utils::str::split(desc, ':');
+  PANIC_IF(vals.size() != 3, "Invalid cache description " + desc);
+  x = std::atol(vals[0].c_str());
+  y = std::atol(vals[1].c_str());
+  z = std::atol(vals[2].c_str());
+  PANIC_IF(x == 0 || y == 0 || z == 0, "Invalid cache description " + desc);
+}
+
+void dump_ratio(std::ostream &os, std::size_t x, std::size_t n) {
+  os << std::fixed << std::setprecision(1) << (n ? 100.0 * x / n : 0.0)
+     << "%";
+}
+
+} // namespace
+
+void ICacheConfig::set_cache(const std::string &desc) {
+  parse_desc(desc, cache_size, cache_ways, cache_line);
+}
+
+void ICacheConfig::set_tlb(const std::string &desc) {
+  parse_desc(desc, tlb_entries, tlb_ways, page_size);
+}
+
+void ICacheStats::dump(std::ostream &os) const {
+  os << "  fetched: " << bytes << " bytes\n";
+  os << "  icache: " << cache_misses << " misses / " << cache_accesses
+     << " accesses (";
+  dump_ratio(os, cache_misses, cache_accesses);
+  os << ")\n";
+  os << "  itlb: " << tlb_misses << " misses / " << tlb_accesses
+     << " accesses (";
+  dump_ratio(os, tlb_misses, tlb_accesses);
+  os << ")\n";
+  os << "  branches: " << taken << " taken, " << fall_through
+     << " fall-through (";
+  dump_ratio(os, fall_through, taken + fall_through);
+  os << " fall-through)\n";
+}
+
+SetAssocCache::SetAssocCache(std::size_t blocks, std::size_t ways,
+                             std::size_t block_size)
+    : _ways(std::min(ways, blocks)), _sets(blocks / _ways),
+      _block_size(block_size), _tags(_sets * _ways), _used(_sets, 0) {
+  PANIC_IF(_sets == 0 || blocks % _ways != 0,
+           "Number of blocks must be a multiple of the number of ways");
+}
+
+bool SetAssocCache::access(std::uint64_t addr) {
+  auto block = addr / _block_size;
+  auto set = block % _sets;
+  auto tags = &_tags[set * _ways];
+  auto &used = _used[set];
+
+  auto it = std::find(tags, tags + used, block);
+  bool hit = it != tags + used;
+  if (!hit) {
+    // Evict the LRU tag if the set is full
+    if (used < _ways)
+      ++used;
+    it = tags + used - 1;
+  }
+
+  // Move to MRU position
+  std::copy_backward(tags, it, it + 1);
+  tags[0] = block;
+  return hit;
+}
+
+ICacheSim::ICacheSim(const ICacheConfig &conf)
+    : _conf(conf), _cache(conf.cache_size / conf.cache_line, conf.cache_ways,
+                          conf.cache_line),
+      _tlb(conf.tlb_entries, conf.tlb_ways, conf.page_size), _started(false),
+      _prev_end(0) {}
+
+void ICacheSim::run(std::uint64_t beg, std::uint64_t end) {
+  if (beg == end)
+    return;
+
+  if (_started && beg == _prev_end)
+    ++_stats.fall_through;
+  else if (_started)
+    ++_stats.taken;
+  _started = true;
+  _prev_end = end;
+  _stats.bytes += end - beg;
+
+  auto line = _conf.cache_line;
+  for (auto addr = beg / line * line; addr < end; addr += line) {
+    ++_stats.cache_accesses;
+    if (!_cache.access(addr))
+      ++_stats.cache_misses;
+  }
+
+  auto page = _conf.page_size;
+  for (auto addr = beg / page * page; addr < end; addr += page) {
+    ++_stats.tlb_accesses;
+    if (!_tlb.access(addr))
+      ++_stats.tlb_misses;
+  }
+}
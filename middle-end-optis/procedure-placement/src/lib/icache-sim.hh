@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Simple instruction fetch model, used to score a code layout
+// Code is fetched by runs of contiguous bytes [beg, end)
+// Every line touched by a run goes through a set-associative I-cache, and
+// every page through an i-TLB (both LRU)
+// A run that doesn't start where the previous one ended is a taken branch
+// (jump, call or return), otherwise it's a fall-through
+
+// Default sizes are scaled down to the size of the examples
+struct ICacheConfig {
+  std::size_t cache_size = 32; // bytes
+  std::size_t cache_ways = 2;
+  std::size_t cache_line = 8; // bytes
+  std::size_t tlb_entries = 2;
+  std::size_t tlb_ways = 2;
+  std::size_t page_size = 16; // bytes
+
+  // Parse a cache description <size>:<ways>:<line>
+  void set_cache(const std::string &desc);
+
+  // Parse a TLB description <entries>:<ways>:<page-size>
+  void set_tlb(const std::string &desc);
+};
+
+struct ICacheStats {
+  std::size_t bytes = 0; // bytes fetched
+  std::size_t cache_accesses = 0;
+  std::size_t cache_misses = 0;
+  std::size_t tlb_accesses = 0;
+  std::size_t tlb_misses = 0;
+  std::size_t taken = 0;
+  std::size_t fall_through = 0;
+
+  void dump(std::ostream &os) const;
+};
+
+// Set-associative cache with LRU replacement
+// Only the tags are stored, block is the size of a line (or a page)
+class SetAssocCache {
+public:
+  SetAssocCache(std::size_t blocks, std::size_t ways, std::size_t block_size);
+
+  // Access the block containing addr, returns true on hit
+  bool access(std::uint64_t addr);
+
+private:
+  std::size_t _ways;
+  std::size_t _sets;
+  std::size_t _block_size;
+
+  // Tags of set s in [s * _ways, (s + 1) * _ways), most recently used first
+  // _used[s] is the number of valid tags in set s
+  std::vector<std::uint64_t> _tags;
+  std::vector<std::size_t> _used;
+};
+
+class ICacheSim {
+public:
+  ICacheSim(const ICacheConfig &conf);
+
+  // Fetch all bytes in [beg, end)
+  void run(std::uint64_t beg, std::uint64_t end);
+
+  const ICacheStats &stats() const { return _stats; }
+
+private:
+  const ICacheConfig &_conf;
+  SetAssocCache _cache;
+  SetAssocCache _tlb;
+  ICacheStats _stats;
+  bool _started;
+  std::uint64_t _prev_end;
+};
@@ -0,0 +1,172 @@
+#include "layout-eval.hh"
+
+#include <fstream>
+#include <map>
+#include <utility>
+
+#include <utils/cli/err.hh>
+#include <utils/str/str.hh>
+
+namespace {
+
+struct FunLayout {
+  std::vector<const Instruction *> ins;
+  // Address of every instruction, the last one is the end of the function
+  std::vector<std::uint64_t> addr;
+};
+
+struct CallSite {
+  std::size_t caller;
+  std::size_t pos; // index of the call instruction
+  std::size_t callee;
+  int count;
+};
+
+class LayoutEval {
+public:
+  LayoutEval(const Module &mod, const ICacheConfig &conf) : _sim(conf) {
+    std::uint64_t addr = 0;
+    for (const auto &fun : mod.fun()) {
+      _ids.emplace(fun.name(), _funs.size());
+      FunLayout fl;
+      for (const auto &bb : fun.bb())
+        for (const auto &ins : bb.ins()) {
+          fl.ins.push_back(&ins);
+          fl.addr.push_back(addr);
+          addr += ins_size(ins);
+        }
+      fl.addr.push_back(addr);
+      _funs.push_back(std::move(fl));
+    }
+  }
+
+  void replay_counts(const std::vector<CallInfos> &cg_freqs) {
+    // cg_freqs are in the same order than the call instructions
+    std::map<std::string, std::vector<int>> counts;
+    for (const auto &ci : cg_freqs)
+      counts[ci.src].push_back(ci.val);
+
+    // Sites sorted by caller name, to get the same replay for any layout
+    std::vector<CallSite> sites;
+    for (const auto &it : _ids) {
+      const auto &fun_counts = counts[it.first];
+      const auto &fl = _funs[it.second];
+      std::size_t k = 0;
+      for (std::size_t i = 0; i < fl.ins.size(); ++i) {
+        if (fl.ins[i]->args[0] != "call" || k >= fun_counts.size())
+          continue;
+        auto count = fun_counts[k++];
+        auto callee = _ids.find(fl.ins[i]->args[1]);
+        if (callee != _ids.end() && count > 0)
+          sites.push_back(CallSite{it.second, i, callee->second, count});
+      }
+    }
+
+    bool left = true;
+    while (left) {
+      left = false;
+      for (auto &s : sites)
+        if (s.count > 0) {
+          --s.count;
+          left = true;
+          _call(s);
+        }
+    }
+  }
+
+  void replay_trace(std::istream &is) {
+    std::string line;
+    while (std::getline(is, line)) {
+      line = utils::str::trim(line);
+      if (line.empty() || line[0] == '#')
+        continue;
+
+      auto args = utils::str::split(line, ' ');
+      if (args.size() == 1 && args[0] == "ret") {
+        PANIC_IF(_stack.empty(), "trace: ret without call");
+        _ret();
+      } else if (args.size() == 2 && args[0] == "call")
+        _trace_call(args[1]);
+      else
+        PANIC("trace: invalid event " + line);
+    }
+
+    while (!_stack.empty())
+      _ret();
+  }
+
+  const ICacheStats &stats() const { return _sim.stats(); }
+
+private:
+  ICacheSim _sim;
+  std::vector<FunLayout> _funs;
+  std::map<std::string, std::size_t> _ids;
+
+  // Call stack of (function, index of the next instruction)
+  std::vector<std::pair<std::size_t, std::size_t>> _stack;
+
+  void _run(std::size_t fun, std::size_t beg, std::size_t end) {
+    _sim.run(_funs[fun].addr[beg], _funs[fun].addr[end]);
+  }
+
+  void _call(const CallSite &s) {
+    auto n = _funs[s.caller].ins.size();
+    _run(s.caller, 0, s.pos + 1);
+    _run(s.callee, 0, _funs[s.callee].ins.size());
+    _run(s.caller, s.pos + 1, n);
+  }
+
+  void _trace_call(const std::string &name) {
+    auto it = _ids.find(name);
+    PANIC_IF(it == _ids.end(), "trace: unknown function " + name);
+
+    if (!_stack.empty()) {
+      auto &top = _stack.back();
+      const auto &fl = _funs[top.first];
+      auto pos = top.second;
+      while (pos < fl.ins.size() &&
+             (fl.ins[pos]->args[0] != "call" || fl.ins[pos]->args[1] != name))
+        ++pos;
+      PANIC_IF(pos == fl.ins.size(), "trace: no call to " + name);
+      _run(top.first, top.second, pos + 1);
+      top.second = pos + 1;
+    }
+
+    _stack.emplace_back(it->second, 0);
+  }
+
+  void _ret() {
+    auto top = _stack.back();
+    _stack.pop_back();
+    _run(top.first, top.second, _funs[top.first].ins.size());
+  }
+};
+
+} // namespace
+
+std::size_t ins_size(const Instruction &ins) {
+  const auto &op = ins.args[0];
+  if (op == "ret")
+    return 1;
+  else if (op == "b")
+    return 2;
+  else if (op == "call")
+    return 5;
+  else
+    return 4;
+}
+
+ICacheStats eval_layout(const Module &mod,
+                        const std::vector<CallInfos> &cg_freqs,
+                        const ICacheConfig &conf,
+                        const std::string &trace_path) {
+  LayoutEval eval(mod, conf);
+  if (trace_path.empty())
+    eval.replay_counts(cg_freqs);
+  else {
+    std::ifstream is(trace_path);
+    PANIC_IF(!is.good(), "Failed to open trace file " + trace_path);
+    eval.replay_trace(is);
+  }
+  return eval.stats();
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "icache-sim.hh"
+#include "module-load.hh"
+#include "module.hh"
+
+// Size in bytes of an instruction
+// Rough model of a variable-length encoding
+std::size_t ins_size(const Instruction &ins);
+
+// Score the current order of the functions of mod with ICacheSim
+// Functions are layed out in module order from address 0, basic blocks in
+// function order, and branches inside a function are ignored: a function is
+// always executed from its beginning to its end.
+//
+// If trace_path is empty, cg_freqs are replayed: calls are run in round-robin
+// until each call site was run as many times as its count, a call fetches the
+// caller up to the call site, then the whole callee, then the rest of the
+// caller (calls made by the callee are not followed).
+// Otherwise, trace_path is a call trace, with one event per line:
+// - call <name>: the current function runs up to its next call to name, then
+//   name starts (the first event starts the program)
+// - ret: the current function runs up to its end, then returns to its caller
+ICacheStats eval_layout(const Module &mod,
+                        const std::vector<CallInfos> &cg_freqs,
+                        const ICacheConfig &conf,
+                        const std::string &trace_path = "");
@@ -1,152 +1,280 @@
 #include "pp.hh"
 
-#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <fstream>
 #include <iostream>
+#include <unordered_map>
+
+#include <utils/cli/err.hh>
 
 namespace {
 
+constexpr std::size_t IDX_NO = -1;
+
 struct CGVal {
   std::size_t src;
   std::size_t dst;
   int val;
-
-  CGVal(std::size_t src, std::size_t dst, int val)
-      : src(src), dst(dst), val(val) {}
+  bool alive;
 };
 
+// Max-heap of edges ids keyed by edge weight
+// Keep the position of every edge in the heap, to update / remove any edge
+// Ties are broken by edge id (first added first), to get a stable order
 class CGQueue {
 public:
-  void add(const CGVal &ci) {
-    if (ci.src == ci.dst)
-      return; // ignore self-loop
-
-    CGVal *act = nullptr; // find already available src -> dst edge
-    for (auto &item : _q)
-      if (item.src == ci.src && item.dst == ci.dst) {
-        act = &item;
-        break;
-      }
+  CGQueue(const std::vector<CGVal> &edges) : _edges(edges) {}
 
-    if (act)
-      act->val += ci.val;
-    else {
+  bool empty() const { return _heap.empty(); }
 
-      auto it = std::upper_bound(
-          _q.begin(), _q.end(), ci,
-          [](const CGVal &a, const CGVal &b) { return a.val < b.val; });
-
-      _q.insert(it, ci);
-    }
+  void push(std::size_t e) {
+    if (_pos.size() <= e)
+      _pos.resize(e + 1, IDX_NO);
+    assert(_pos[e] == IDX_NO);
+    _pos[e] = _heap.size();
+    _heap.push_back(e);
+    _up(_pos[e]);
   }
 
-  CGVal pop() {
-    CGVal res = _q.back();
-    _q.pop_back();
+  std::size_t pop() {
+    auto res = _heap.front();
+    remove(res);
     return res;
   }
 
-  void rename(std::size_t prev, std::size_t next) {
-    for (auto &item : _q) {
-      if (item.src == prev)
-        item.src = next;
-      if (item.dst == prev)
-        item.dst = next;
-    }
+  // Must be called after the weight of e increased
+  void increased(std::size_t e) { _up(_pos[e]); }
 
-    // Rebuild queue to handle doublons that may appear because of renaming: sum
-    // values
-    auto vals = std::move(_q);
-    for (auto &item : vals)
-      add(item);
+  void remove(std::size_t e) {
+    auto i = _pos[e];
+    assert(i != IDX_NO);
+    _swap(i, _heap.size() - 1);
+    _heap.pop_back();
+    _pos[e] = IDX_NO;
+    if (i < _heap.size()) {
+      _up(i);
+      _down(i);
+    }
   }
 
-  bool empty() const { return _q.empty(); }
+private:
+  const std::vector<CGVal> &_edges;
+  std::vector<std::size_t> _heap;
+  std::vector<std::size_t> _pos;
 
-  void dump(std::ostream &os) {
-    os << "CGQ: {";
+  bool _before(std::size_t i, std::size_t j) const {
+    const auto &x = _edges[_heap[i]];
+    const auto &y = _edges[_heap[j]];
+    return x.val > y.val || (x.val == y.val && _heap[i] < _heap[j]);
+  }
 
-    for (auto it = _q.rbegin(); it != _q.rend(); ++it)
-      os << "(P" << it->src << ", P" << it->dst << ", " << it->val << "); ";
+  void _swap(std::size_t i, std::size_t j) {
+    std::swap(_heap[i], _heap[j]);
+    _pos[_heap[i]] = i;
+    _pos[_heap[j]] = j;
+  }
 
-    os << "}\n";
+  void _up(std::size_t i) {
+    while (i > 0 && _before(i, (i - 1) / 2)) {
+      _swap(i, (i - 1) / 2);
+      i = (i - 1) / 2;
+    }
   }
 
-private:
-  std::vector<CGVal> _q;
+  void _down(std::size_t i) {
+    for (;;) {
+      auto best = i;
+      for (auto c : {2 * i + 1, 2 * i + 2})
+        if (c < _heap.size() && _before(c, best))
+          best = c;
+      if (best == i)
+        return;
+      _swap(i, best);
+      i = best;
+    }
+  }
 };
 
-using fun_list_t = std::vector<std::string>;
-
 class PP {
 public:
-  PP(Module &mod) : _mod(mod) {}
+  PP(Module &mod) : _mod(mod), _cgq(_edges) {}
 
-  void run(const std::vector<CallInfos> &cg_freqs) {
+  void run(const std::vector<CallInfos> &cg_freqs,
+           const std::string &order_path) {
     // Step 1: Initialize queue and list
-    std::map<std::string, std::size_t> n2i;
-    for (const auto &fun : _mod.fun()) {
-      _lists.push_back({fun.name()});
-      n2i.emplace(fun.name(), n2i.size());
+    // Each function is a list of one element
+    std::unordered_map<std::string, std::size_t> n2i;
+    for (auto &fun : _mod.fun()) {
+      n2i.emplace(fun.name(), _funs.size());
+      _funs.push_back(&fun);
     }
-    for (const auto &ci : cg_freqs)
-      _cgq.add(CGVal(n2i[ci.src], n2i[ci.dst], ci.val));
+    auto n = _funs.size();
+    _parent.resize(n);
+    _head.resize(n);
+    _tail.resize(n);
+    _next.assign(n, IDX_NO);
+    _adj.resize(n);
+    for (std::size_t i = 0; i < n; ++i)
+      _parent[i] = _head[i] = _tail[i] = i;
 
-    _dump(std::cout);
+    for (const auto &ci : cg_freqs) {
+      auto src = n2i.find(ci.src);
+      auto dst = n2i.find(ci.dst);
+      if (src != n2i.end() && dst != n2i.end())
+        _add_edge(src->second, dst->second, ci.val);
+    }
 
     // Step 2: Reduce graph until queue empty
-    while (!_cgq.empty()) {
+    while (!_cgq.empty())
       _reduce();
-      _dump(std::cout);
-    }
 
     // At this step, there is M lists, one for each connected component of the
     // callgraph The order in each list is chosen to increase cache locality
     // Procedures should be put by following the order inside the lists
     // The position from one list to another doesn't matter
+    // Lists are sorted by the position of their first function
     std::vector<Function *> new_order;
-    for (const auto &l : _lists)
-      for (const auto &f : l)
-        new_order.push_back(_mod.get_fun(f));
+    for (std::size_t i = 0; i < n; ++i)
+      if (_head[_find(i)] == i)
+        for (auto f = i; f != IDX_NO; f = _next[f])
+          new_order.push_back(_funs[f]);
     _mod.fun_list().reorder(new_order);
+
+    std::cout << "order: {";
+    for (auto f : new_order)
+      std::cout << f->name() << ' ';
+    std::cout << "}\n\n";
+
+    if (!order_path.empty())
+      _write_order(new_order, order_path);
   }
 
 private:
   Module &_mod;
+  std::vector<Function *> _funs;
+
+  // Union-find of the lists
+  // _head / _tail are the first and last function of the list (roots only)
+  // _next is the next function in its list
+  std::vector<std::size_t> _parent;
+  std::vector<std::size_t> _head;
+  std::vector<std::size_t> _tail;
+  std::vector<std::size_t> _next;
+
+  // Edges between lists
+  // Each edge is in the adjacency list of both its ends (for roots only)
+  // Dead edges are not removed from the adjacency lists
+  std::vector<CGVal> _edges;
+  std::vector<std::vector<std::size_t>> _adj;
+  std::unordered_map<std::uint64_t, std::size_t> _edges_map;
   CGQueue _cgq;
-  std::vector<fun_list_t> _lists;
+
+  std::size_t _find(std::size_t f) {
+    while (_parent[f] != f) {
+      _parent[f] = _parent[_parent[f]];
+      f = _parent[f];
+    }
+    return f;
+  }
+
+  static std::uint64_t _key(std::size_t src, std::size_t dst) {
+    return (static_cast<std::uint64_t>(src) << 32) | dst;
+  }
+
+  // Add val to edge src -> dst, or create it
+  void _add_edge(std::size_t src, std::size_t dst, int val) {
+    if (src == dst)
+      return; // ignore self-loop
+
+    auto it = _edges_map.find(_key(src, dst));
+    if (it != _edges_map.end()) {
+      _edges[it->second].val += val;
+      _cgq.increased(it->second);
+      return;
+    }
+
+    auto e = _edges.size();
+    _edges.push_back(CGVal{src, dst, val, true});
+    _edges_map.emplace(_key(src, dst), e);
+    _adj[src].push_back(e);
+    _adj[dst].push_back(e);
+    _cgq.push(e);
+  }
 
   // Reduce the graph by poping from the queue (most freq edge)
   // Then combine the 2 lists related to the vertices of the edge in one
-  // Need to update the values in the queue (rename y by x)
+  // The list of dst is appended to the list of src
   void _reduce() {
-    auto next = _cgq.pop();
-    fun_list_t &lx = _lists[next.src];
-    fun_list_t &ly = _lists[next.dst];
-    assert(!lx.empty());
-    assert(!ly.empty());
-
-    _cgq.rename(next.dst, next.src);
-    lx.insert(lx.end(), ly.begin(), ly.end());
-    ly.clear();
+    auto e = _cgq.pop();
+    auto &next = _edges[e];
+    next.alive = false;
+    _edges_map.erase(_key(next.src, next.dst));
+    auto x = next.src;
+    auto y = next.dst;
+    std::cout << "merge " << _funs[_head[x]]->name() << " <- "
+              << _funs[_head[y]]->name() << " (" << next.val << ")\n";
+
+    auto head = _head[x];
+    auto tail = _tail[y];
+    _next[_tail[x]] = _head[y];
+
+    // The edges of the list with the fewest edges are renamed
+    auto root = x;
+    auto old = y;
+    if (_adj[x].size() < _adj[y].size())
+      std::swap(root, old);
+    _parent[old] = root;
+    _head[root] = head;
+    _tail[root] = tail;
+    _rename(old, root);
   }
 
-  void _dump(std::ostream &os) {
-    for (std::size_t i = 0; i < _lists.size(); ++i) {
-      if (_lists[i].empty())
+  // All edges of list old now belong to list root
+  // Some may become self-loops, or duplicates of existing edges: sum values
+  void _rename(std::size_t old, std::size_t root) {
+    auto edges = std::move(_adj[old]);
+    for (auto e : edges) {
+      auto &edge = _edges[e];
+      if (!edge.alive)
         continue;
-      os << "P" << i << ": {";
-      for (auto &f : _lists[i])
-        os << f << ' ';
-      os << "}; ";
+
+      _edges_map.erase(_key(edge.src, edge.dst));
+      auto src = edge.src == old ? root : edge.src;
+      auto dst = edge.dst == old ? root : edge.dst;
+      auto it = _edges_map.find(_key(src, dst));
+
+      if (src == dst || it != _edges_map.end()) {
+        edge.alive = false;
+        _cgq.remove(e);
+        if (src != dst) {
+          _edges[it->second].val += edge.val;
+          _cgq.increased(it->second);
+        }
+        continue;
+      }
+
+      edge.src = src;
+      edge.dst = dst;
+      _edges_map.emplace(_key(src, dst), e);
+      _adj[root].push_back(e);
     }
-    os << "\n";
-    _cgq.dump(os);
-    os << "\n";
+  }
+
+  // One symbol per line, can be given to the linker
+  // (eg: lld --symbol-ordering-file, gold --section-ordering-file)
+  void _write_order(const std::vector<Function *> &order,
+                    const std::string &path) {
+    std::ofstream os(path);
+    PANIC_IF(!os.good(), "Failed to open order file " + path);
+    for (auto f : order)
+      os << f->name() << "\n";
   }
 };
 } // namespace
 
-void pp_run(Module &mod, const std::vector<CallInfos> &cg_freqs) {
+void pp_run(Module &mod, const std::vector<CallInfos> &cg_freqs,
+            const std::string &order_path) {
   PP pp(mod);
-  pp.run(cg_freqs);
+  pp.run(cg_freqs, order_path);
 }
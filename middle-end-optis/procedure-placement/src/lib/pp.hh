@@ -14,5 +14,12 @@
 // The algorithm use some heuristics to try and find a good (not optimal
 // solution)
 //
+// Edges are kept in an indexed max-heap, lists in a union-find, and duplicate
+// edges created by a merge are found with a hash table, so the whole
+// reduction runs in O(E log E).
+// If order_path isn't empty, the final order is written to it, one symbol per
+// line (symbol ordering file, for the linker).
+//
 // // Algorithm Procedure Placement - Engineer a Compiler p462
-void pp_run(Module &mod, const std::vector<CallInfos> &cg_freqs);
+void pp_run(Module &mod, const std::vector<CallInfos> &cg_freqs,
+            const std::string &order_path = "");
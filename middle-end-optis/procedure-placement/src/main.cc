@@ -3,22 +3,58 @@
 #include <iostream>
 
 #include "lib/gop.hh"
+#include "lib/icache-sim.hh"
+#include "lib/layout-eval.hh"
 #include "lib/module-load.hh"
 #include "lib/module.hh"
 #include "lib/pp.hh"
 
 int main(int argc, char **argv) {
   if (argc < 2) {
-    std::cerr << "Usage: optime-procedure-placement <src-file>" << std::endl;
+    std::cerr << "Usage: optime-procedure-placement <src-file> "
+                 "[--order-file <out-file>] [--eval] [--trace <trace-file>] "
+                 "[--cache <size>:<ways>:<line>] "
+                 "[--tlb <entries>:<ways>:<page>]"
+              << std::endl;
     return 1;
   }
 
   auto in_file = argv[1];
+  std::string order_path;
+  bool eval = false;
+  std::string trace_path;
+  ICacheConfig conf;
+  for (int i = 2; i < argc; ++i) {
+    if (!strcmp(argv[i], "--eval"))
+      eval = true;
+    else if (i + 1 == argc)
+      break;
+    else if (!strcmp(argv[i], "--order-file"))
+      order_path = argv[++i];
+    else if (!strcmp(argv[i], "--trace"))
+      trace_path = argv[++i];
+    else if (!strcmp(argv[i], "--cache"))
+      conf.set_cache(argv[++i]);
+    else if (!strcmp(argv[i], "--tlb"))
+      conf.set_tlb(argv[++i]);
+  }
+
   std::vector<CallInfos> ci;
   auto mod = load_module(in_file, ci);
 
-  pp_run(*mod, ci);
+  ICacheStats before;
+  if (eval)
+    before = eval_layout(*mod, ci, conf, trace_path);
+
+  pp_run(*mod, ci, order_path);
 
   mod2gop(*mod).dump(std::cout);
+
+  if (eval) {
+    std::cout << "\nlayout before:\n";
+    before.dump(std::cout);
+    std::cout << "layout after:\n";
+    eval_layout(*mod, ci, conf, trace_path).dump(std::cout);
+  }
   return 0;
 }
@@ -0,0 +1,528 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <ostream>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "lattice.hh"
+#include "module.hh"
+
+// Sparse dataflow engine over the SSA def-use graph of a function
+// Values are elements of the lattice L (see lattice.hh), attached to every
+// instruction.
+// Start with an optimistic TOP value, and keep lowering values until a fixed
+// point is reached. Only the users of an updated value are evaluated again.
+//
+// Two modes:
+// - track_exec = false: every block is considered executed, phis meet all
+//   their operands (Sparse Simple Constant Propagation)
+// - track_exec = true: also track the CFG edges that may be executed, and only
+//   evaluate instructions in blocks reachable through them. Phis only meet
+//   operands coming from executed edges (Sparse Conditional Constant
+//   Propagation)
+//
+// With narrow = true, the conditions of branches are also used to refine the
+// values of their operands on each outgoing edge (eg: x < n on the first edge
+// of `bc %c, ...` with `cmplt %c, %x, %n`).
+// Facts known on an edge (p, b) hold in b if p is its only predecessor, and
+// are inherited along extended basic blocks.
+// It's mostly useful with lattices that can represent more than constants.
+//
+// Function arguments are BOT by default, they can be set to another value
+// before running the analysis (used by interprocedural passes)
+//
+// Algorithm Sparse Simple Constant Propagation - Engineer a Compiler p515
+// Algorithm Sparse Conditional Constant Propagation - Engineer a Compiler p575
+template <class L> class SparseDataflow {
+
+public:
+  // A phi is widened after it was evaluated this many times
+  static constexpr unsigned WIDEN_LIMIT = 16;
+
+  SparseDataflow(Function &fun, bool track_exec, bool narrow = false)
+      : _fun(fun), _track_exec(track_exec), _narrow(narrow), _log(nullptr) {
+    for (std::size_t i = 0; i < _fun.args_count(); ++i) {
+      _ids.emplace(&_fun.get_arg(i), i);
+      _args.push_back(L::bot());
+    }
+
+    for (auto &bb : _fun.bb()) {
+      _bb_ids.emplace(&bb, _bbs.size());
+      _bbs.push_back(&bb);
+      for (auto &ins : bb.ins()) {
+        _ids.emplace(&ins, _ins.size());
+        _ins.push_back(&ins);
+      }
+    }
+
+    _exec_bbs.assign(_bbs.size(), 0);
+    _exec_preds.resize(_bbs.size());
+    _vals.assign(_ins.size(), L::top());
+    _nupdates.assign(_ins.size(), 0);
+    _in_wl.assign(_ins.size(), 0);
+    _facts_pred.assign(_bbs.size(), nullptr);
+    _facts.resize(_bbs.size());
+    if (_narrow)
+      _build_facts();
+  }
+
+  // Set the value of function argument at position pos
+  // Must be called before run()
+  void set_arg(std::size_t pos, const L &val) {
+    assert(pos < _args.size());
+    _args[pos] = val;
+  }
+
+  // Log every value update to os
+  void set_log(std::ostream &os) { _log = &os; }
+
+  // Iterate until a fixed point is reached
+  void run() {
+    if (!_track_exec) {
+      for (auto &bb : _fun.bb())
+        _exec_bbs[_bb_ids.at(&bb)] = 1;
+      for (auto &bb : _fun.bb())
+        _visit_block(bb);
+    } else
+      _cfg_wl.emplace_back(nullptr, &_fun.get_entry_bb());
+
+    // CFG edges are handled first, to evaluate blocks before their uses
+    while (!_cfg_wl.empty() || !_ssa_wl.empty()) {
+      if (!_cfg_wl.empty()) {
+        auto e = _cfg_wl.back();
+        _cfg_wl.pop_back();
+        _visit_edge(e.first, *e.second);
+        continue;
+      }
+
+      auto ins = _ssa_wl.back();
+      _ssa_wl.pop_back();
+      _in_wl[_ids.at(ins)] = 0;
+      // Use may be dead, only evaluate it once its block is reachable
+      if (_exec_bbs[_bb_ids.at(&ins->parent())])
+        _visit(*ins);
+    }
+  }
+
+  // Value of any instruction operand
+  L get(const Value &val) const {
+    // We should never try to eval a bb / fun, makes no sense
+    assert(!dynamic_cast<const BasicBlock *>(&val));
+    assert(!dynamic_cast<const Function *>(&val));
+
+    if (auto vconst = dynamic_cast<const ValueConst *>(&val))
+      return L::make(vconst->get_val());
+    if (dynamic_cast<const ValueArg *>(&val))
+      return _args[_ids.at(&val)];
+    return _vals[_ids.at(&val)];
+  }
+
+  bool is_executable(const BasicBlock &bb) const {
+    return _exec_bbs[_bb_ids.at(&bb)];
+  }
+
+  bool is_executed(const BasicBlock &src, const BasicBlock &dst) const {
+    if (!_track_exec)
+      return true;
+    for (auto p : _exec_preds[_bb_ids.at(&dst)])
+      if (p == &src)
+        return true;
+    return false;
+  }
+
+  // Replace all uses of instructions with a constant value by the constant
+  // Return the number of instructions replaced
+  std::size_t replace_consts() {
+    std::size_t res = 0;
+    for (std::size_t i = 0; i < _ins.size(); ++i) {
+      long val;
+      if (!_ins[i]->has_def() || !_vals[i].get_const(val))
+        continue;
+      _ins[i]->replace_all_uses_with(*ValueConst::make(val));
+      ++res;
+    }
+    return res;
+  }
+
+  // Use the executed edges to simplify the CFG:
+  // - conditional branches with only one executed edge become unconditional
+  // - phi operands coming from non-executed edges are removed, phis with only
+  //   one operand left are replaced by it
+  // - unreachable blocks are erased
+  // Only valid with track_exec = true
+  // Must be called last, the analysis results can't be used anymore
+  void remove_dead_code(std::size_t &nbranches, std::size_t &nphis,
+                        std::size_t &nblocks) {
+    assert(_track_exec);
+    nbranches = nphis = nblocks = 0;
+
+    for (auto bb : _bbs) {
+      if (!is_executable(*bb))
+        continue;
+      auto &bins = bb->ins().back();
+      if (bins.get_opname() != "beq" && bins.get_opname() != "bc")
+        continue;
+
+      std::vector<Value *> live;
+      for (auto succ : bins.branch_targets())
+        if (is_executed(*bb, *succ) && (live.empty() || live[0] != succ))
+          live.push_back(succ);
+      if (live.size() != 1)
+        continue;
+
+      bb->insert_ins(ins_iterator_t(&bins), "b", live, "", isa::IDX_NO);
+      bins.erase_from_parent();
+      ++nbranches;
+    }
+
+    for (auto bb : _bbs) {
+      if (!is_executable(*bb))
+        continue;
+
+      std::vector<Instruction *> phis;
+      for (auto &ins : bb->ins())
+        if (ins.get_opname() == "phi")
+          phis.push_back(&ins);
+
+      for (auto phi : phis) {
+        std::vector<Value *> ops;
+        for (std::size_t i = 0; i < phi->ops_count(); i += 2)
+          if (is_executed(dynamic_cast<BasicBlock &>(phi->op(i)), *bb)) {
+            ops.push_back(&phi->op(i));
+            ops.push_back(&phi->op(i + 1));
+          }
+        if (ops.size() == phi->ops_count())
+          continue;
+
+        ++nphis;
+        if (ops.size() == 2) {
+          phi->replace_all_uses_with(*ops[1]);
+          phi->erase_from_parent();
+          continue;
+        }
+
+        // The def of a phi is always its first argument
+        auto name = phi->get_name();
+        auto &new_phi =
+            *bb->insert_ins(ins_iterator_t(phi), "phi", ops, "", 1);
+        phi->replace_all_uses_with(new_phi);
+        phi->erase_from_parent();
+        new_phi.set_name(name);
+      }
+    }
+
+    for (auto bb : _bbs)
+      if (!is_executable(*bb)) {
+        bb->erase_from_parent();
+        ++nblocks;
+      }
+  }
+
+  void dump_vals(std::ostream &os) const {
+    os << "Values: {\n";
+    for (std::size_t i = 0; i < _ins.size(); ++i) {
+      os << "  ";
+      _ins[i]->dump(os);
+      os << ": " << _vals[i] << "\n";
+    }
+    os << "}\n\n";
+  }
+
+  void dump_executed(std::ostream &os) const {
+    os << "Executed: {\n";
+    for (const auto &bb : _fun.bb())
+      for (auto succ : bb.ins().back().branch_targets())
+        os << "  " << bb.get_name() << " -> " << succ->get_name() << ": "
+           << (is_executed(bb, *succ) ? "true" : "false") << "\n";
+    os << "}\n\n";
+  }
+
+private:
+  using cfg_edge_t = std::pair<BasicBlock *, BasicBlock *>;
+
+  // Fact `val cmp other` (or `val cmp k` if other is null)
+  struct Fact {
+    const Value *val;
+    Cmp cmp;
+    const Value *other;
+    long k;
+  };
+
+  Function &_fun;
+  const bool _track_exec;
+  const bool _narrow;
+  std::ostream *_log;
+
+  // Dense indexes for instructions / arguments, and basic blocks
+  std::unordered_map<const Value *, std::size_t> _ids;
+  std::unordered_map<const BasicBlock *, std::size_t> _bb_ids;
+
+  std::vector<BasicBlock *> _bbs;
+  std::vector<Instruction *> _ins;
+  std::vector<L> _vals;
+  std::vector<unsigned> _nupdates;
+  std::vector<L> _args;
+  std::vector<char> _exec_bbs;
+  std::vector<std::vector<const BasicBlock *>> _exec_preds;
+
+  std::vector<cfg_edge_t> _cfg_wl;
+  std::vector<Instruction *> _ssa_wl;
+  std::vector<char> _in_wl;
+
+  // Facts known at the beginning of every block:
+  // facts of _facts_pred[b] (its only pred, or null) + _facts[b]
+  std::vector<const BasicBlock *> _facts_pred;
+  std::vector<std::vector<Fact>> _facts;
+  // When the value of x changes, users of values in _partners[x] must be
+  // evaluated again, because x is used to narrow them
+  std::unordered_map<const Value *, std::vector<const Value *>> _partners;
+
+  void _visit_edge(BasicBlock *src, BasicBlock &dst) {
+    auto dst_id = _bb_ids.at(&dst);
+    if (src) { // nullptr for the entry block
+      if (is_executed(*src, dst))
+        return;
+      _exec_preds[dst_id].push_back(src);
+    }
+
+    // Another edge (x, dst) already executed, only the phis can change
+    if (_exec_bbs[dst_id]) {
+      _visit_phis(dst);
+      return;
+    }
+
+    _exec_bbs[dst_id] = 1;
+    _visit_block(dst);
+  }
+
+  // Instructions must be evaluated in order the first time a block is reached
+  // Otherwhise an operand defined earlier in the block may still be TOP
+  void _visit_block(BasicBlock &bb) {
+    for (auto &ins : bb.ins())
+      _visit(ins);
+  }
+
+  void _visit_phis(BasicBlock &bb) {
+    for (auto &ins : bb.ins()) {
+      if (ins.get_opname() != "phi")
+        break;
+      _visit(ins);
+    }
+  }
+
+  void _visit(Instruction &ins) {
+    const auto &opname = ins.get_opname();
+    const auto &bb = ins.parent();
+
+    if (opname == "phi") {
+      auto new_val = L::top();
+      for (std::size_t i = 0; i < ins.ops_count(); i += 2) {
+        auto &pred = dynamic_cast<BasicBlock &>(ins.op(i));
+        // Meet only with executed branches
+        if (is_executed(pred, bb))
+          new_val = L::meet(new_val, _get_on_edge(ins.op(i + 1), pred, bb));
+      }
+
+      if (++_nupdates[_ids.at(&ins)] > WIDEN_LIMIT)
+        new_val = L::widen(_vals[_ids.at(&ins)], new_val);
+      _update(ins, new_val);
+    }
+
+    else if (opname == "ret") {
+      if (ins.ops_count() > 0)
+        _update(ins, _get_at(ins.op(0), &bb));
+    }
+
+    else if (opname == "b") {
+      if (_track_exec)
+        _push_edge(ins, 0);
+    }
+
+    else if (opname == "beq" || opname == "bc") {
+      std::vector<L> ops;
+      for (std::size_t i = 0; i + 2 < ins.ops_count(); ++i)
+        ops.push_back(_get_at(ins.op(i), &bb));
+      auto cond = L::eval(opname, ops);
+      if (!_update(ins, cond) || !_track_exec)
+        return;
+
+      long val;
+      if (cond.get_const(val))
+        _push_edge(ins, val ? 0 : 1);
+      else if (!cond.is_top()) {
+        _push_edge(ins, 0);
+        _push_edge(ins, 1);
+      }
+    }
+
+    else if (opname == "call") {
+      if (ins.has_def())
+        _update(ins, L::bot());
+    }
+
+    else {
+      assert(ins.has_def());
+      std::vector<L> ops;
+      for (auto op : ins.ops())
+        ops.push_back(_get_at(*op, &bb));
+      _update(ins, L::eval(opname, ops));
+    }
+  }
+
+  void _push_edge(Instruction &ins, std::size_t target) {
+    auto succ = ins.branch_targets()[target];
+    if (!is_executed(ins.parent(), *succ))
+      _cfg_wl.emplace_back(&ins.parent(), succ);
+  }
+
+  // Change the value of ins, and add all its users to the worklist
+  // Return false if the value didn't change
+  bool _update(Instruction &ins, const L &new_val) {
+    auto &val = _vals[_ids.at(&ins)];
+    // Values can only go down in the lattice
+    auto next_val = L::meet(val, new_val);
+    if (val == next_val)
+      return false;
+
+    if (_log) {
+      *_log << "Update ";
+      ins.dump(*_log);
+      *_log << ": " << val << " => " << next_val << "\n";
+    }
+    val = next_val;
+
+    _push_users(ins);
+    auto it = _partners.find(&ins);
+    if (it != _partners.end())
+      for (auto p : it->second)
+        _push_users(*p);
+    return true;
+  }
+
+  void _push_users(const Value &val) {
+    for (auto user : val.get_users()) {
+      auto user_ins = dynamic_cast<Instruction *>(user);
+      if (!user_ins)
+        continue;
+      auto id = _ids.at(user_ins);
+      if (!_in_wl[id]) {
+        _in_wl[id] = 1;
+        _ssa_wl.push_back(user_ins);
+      }
+    }
+  }
+
+  // Value of val, narrowed with all facts known at the beginning of bb
+  L _get_at(const Value &val, const BasicBlock *bb) const {
+    auto res = get(val);
+    if (!_narrow || dynamic_cast<const ValueConst *>(&val))
+      return res;
+    for (; bb; bb = _facts_pred[_bb_ids.at(bb)])
+      res = _apply_facts(val, res, _facts[_bb_ids.at(bb)]);
+    return res;
+  }
+
+  // Value of val coming from the edge (pred, bb), used for phis
+  L _get_on_edge(const Value &val, const BasicBlock &pred,
+                 const BasicBlock &bb) const {
+    auto res = _get_at(val, &pred);
+    if (!_narrow || dynamic_cast<const ValueConst *>(&val))
+      return res;
+    std::vector<Fact> facts;
+    _edge_facts(pred, bb, facts);
+    return _apply_facts(val, res, facts);
+  }
+
+  L _apply_facts(const Value &val, L res,
+                 const std::vector<Fact> &facts) const {
+    for (const auto &f : facts)
+      if (f.val == &val)
+        res = L::narrow(res, f.cmp, f.other ? get(*f.other) : L::make(f.k));
+    return res;
+  }
+
+  void _build_facts() {
+    std::vector<std::vector<const BasicBlock *>> preds(_bbs.size());
+    for (auto bb : _bbs)
+      for (auto succ : bb->ins().back().branch_targets()) {
+        auto &sp = preds[_bb_ids.at(succ)];
+        if (sp.empty() || sp.back() != bb)
+          sp.push_back(bb);
+      }
+
+    for (auto bb : _bbs) {
+      auto id = _bb_ids.at(bb);
+      if (bb == &_fun.get_entry_bb() || preds[id].size() != 1)
+        continue;
+      auto pred = preds[id][0];
+      _facts_pred[id] = pred;
+      _edge_facts(*pred, *bb, _facts[id]);
+    }
+
+    // Unreachable blocks may form a cycle of single preds, break it
+    std::vector<char> seen(_bbs.size());
+    for (auto bb : _bbs) {
+      std::fill(seen.begin(), seen.end(), 0);
+      for (const BasicBlock *p = bb; p; p = _facts_pred[_bb_ids.at(p)]) {
+        auto id = _bb_ids.at(p);
+        if (seen[id]) {
+          _facts_pred[id] = nullptr;
+          break;
+        }
+        seen[id] = 1;
+      }
+    }
+
+    for (const auto &facts : _facts)
+      for (const auto &f : facts)
+        if (f.other)
+          _partners[f.other].push_back(f.val);
+  }
+
+  // Facts known to be true when going from pred to bb
+  void _edge_facts(const BasicBlock &pred, const BasicBlock &bb,
+                   std::vector<Fact> &facts) const {
+    const auto &bins = pred.ins().back();
+    const auto &opname = bins.get_opname();
+    if (opname != "beq" && opname != "bc")
+      return;
+    auto targets = bins.branch_targets();
+    if (targets[0] == targets[1])
+      return;
+    bool taken = targets[0] == &bb;
+
+    if (opname == "beq") {
+      auto cmp = taken ? Cmp::EQ : Cmp::NE;
+      _add_fact(bins.op(0), cmp, bins.op(1), facts);
+      _add_fact(bins.op(1), cmp, bins.op(0), facts);
+      return;
+    }
+
+    // bc %c: c != 0 if taken, c == 0 otherwhise
+    const auto &cond = bins.op(0);
+    if (!dynamic_cast<const ValueConst *>(&cond))
+      facts.push_back(Fact{&cond, taken ? Cmp::NE : Cmp::EQ, nullptr, 0});
+
+    // cmplt %c, %x, %y: x < y if taken, x >= y otherwhise
+    auto cmp_ins = dynamic_cast<const Instruction *>(&cond);
+    if (!cmp_ins || cmp_ins->get_opname() != "cmplt")
+      return;
+    _add_fact(cmp_ins->op(0), taken ? Cmp::LT : Cmp::GE, cmp_ins->op(1),
+              facts);
+    _add_fact(cmp_ins->op(1), taken ? Cmp::GT : Cmp::LE, cmp_ins->op(0),
+              facts);
+  }
+
+  void _add_fact(const Value &val, Cmp cmp, const Value &other,
+                 std::vector<Fact> &facts) const {
+    if (dynamic_cast<const ValueConst *>(&val))
+      return;
+    if (auto vconst = dynamic_cast<const ValueConst *>(&other))
+      facts.push_back(Fact{&val, cmp, nullptr, vconst->get_val()});
+    else
+      facts.push_back(Fact{&val, cmp, &other, 0});
+  }
+};
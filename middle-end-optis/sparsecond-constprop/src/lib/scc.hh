@@ -11,7 +11,13 @@
 // Unreachable code is ignored
 // This can find more constants (eg for phi, only consider the value for the
 // edges that get taken
+// Branches with only one executed edge, dead phi operands and unreachable
+// blocks are removed.
+//
+// With use_ranges, values are ranges with known bits instead of constants
+// (see RangeLattice), and values are narrowed on conditional branches edges.
+// Comparisons decided by ranges (eg i < 10 with i in [0, 9]) can be folded.
 //
 // Algorithm Sparse Conditional Constant Propagation  - Engineer a Compiler p575
 // Paper Constant Propagation with Conditional Branches
-void scc_run(Module &mod);
+void scc_run(Module &mod, bool use_ranges = false);
@@ -8,14 +8,16 @@
 
 int main(int argc, char **argv) {
   if (argc < 2) {
-    std::cerr << "Usage: sparsecond-constprop <src-file>" << std::endl;
+    std::cerr << "Usage: sparsecond-constprop <src-file> [--range]"
+              << std::endl;
     return 1;
   }
 
   auto in_file = argv[1];
   auto mod = load_module(in_file);
 
-  scc_run(*mod);
+  bool use_ranges = argc > 2 && !strcmp(argv[2], "--range");
+  scc_run(*mod, use_ranges);
   mod->check();
 
   auto gout = mod2gop(*mod);
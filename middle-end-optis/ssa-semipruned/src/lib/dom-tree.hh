@@ -24,6 +24,9 @@ public:
   const BasicBlock &idom(const BasicBlock &bb) const;
   std::vector<const BasicBlock *> dom(const BasicBlock &bb) const;
 
+  // Depth of bb in the Dom tree (0 for the entry block)
+  std::size_t height(const BasicBlock &bb) const { return _heights[_va(&bb)]; }
+
   // Returns children of bb in Dom tree
   std::vector<const BasicBlock *> succs(const BasicBlock &bb) const;
 
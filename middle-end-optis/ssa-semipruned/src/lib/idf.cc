@@ -0,0 +1,79 @@
+#include "idf.hh"
+
+#include <algorithm>
+
+IDF::IDF(const Function &fun, const CFG &cfg, const DomTree &dt)
+    : _va(fun.bb().map([](const BasicBlock &bb) { return &bb; })),
+      _levels(_va.size()), _dsuccs(_va.size()), _jsuccs(_va.size()),
+      _stamp(0), _visited(_va.size(), 0), _queued(_va.size(), 0),
+      _in_idf(_va.size(), 0) {
+
+  std::size_t max_level = 0;
+  for (const auto &bb : fun.bb()) {
+    auto v = _va(&bb);
+    _levels[v] = dt.height(bb);
+    max_level = std::max(max_level, _levels[v]);
+
+    if (&bb != &fun.get_entry_bb())
+      _dsuccs[_va(&dt.idom(bb))].push_back(v);
+
+    for (auto succ : cfg.succs(bb))
+      if (succ == &fun.get_entry_bb() || &dt.idom(*succ) != &bb)
+        _jsuccs[v].push_back(_va(succ));
+  }
+
+  _bank.resize(max_level + 1);
+}
+
+std::vector<const BasicBlock *>
+IDF::idf(const std::set<const BasicBlock *> &defs) const {
+  std::vector<const BasicBlock *> res;
+  ++_stamp;
+
+  auto cur_level = std::size_t(0);
+  auto push = [&](std::size_t v) {
+    _queued[v] = _stamp;
+    _bank[_levels[v]].push_back(v);
+    cur_level = std::max(cur_level, _levels[v]);
+  };
+
+  for (auto bb : defs)
+    push(_va(bb));
+
+  std::vector<std::size_t> stack;
+  for (;;) {
+    // Pop the deepest block of the queue
+    while (cur_level > 0 && _bank[cur_level].empty())
+      --cur_level;
+    if (_bank[cur_level].empty())
+      break;
+    auto root = _bank[cur_level].back();
+    _bank[cur_level].pop_back();
+    auto root_level = _levels[root];
+
+    // Visit the dom subtree of root, not already visited from another root
+    _visited[root] = _stamp;
+    stack.push_back(root);
+    while (!stack.empty()) {
+      auto x = stack.back();
+      stack.pop_back();
+
+      for (auto y : _jsuccs[x]) {
+        if (_levels[y] > root_level || _in_idf[y] == _stamp)
+          continue;
+        _in_idf[y] = _stamp;
+        res.push_back(_va(y));
+        if (_queued[y] != _stamp)
+          push(y);
+      }
+
+      for (auto y : _dsuccs[x])
+        if (_visited[y] != _stamp) {
+          _visited[y] = _stamp;
+          stack.push_back(y);
+        }
+    }
+  }
+
+  return res;
+}
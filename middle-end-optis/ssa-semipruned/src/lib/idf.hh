@@ -0,0 +1,43 @@
+#pragma once
+
+#include <set>
+#include <vector>
+
+#include "cfg.hh"
+#include "dom-tree.hh"
+#include "module.hh"
+#include "vertex-adapter.hh"
+
+// Compute the Iterated Dominance Frontier of a set of blocks
+// IDF(S) = DF+(S): all blocks where a phi is needed for a variable defined in
+// the blocks of S
+//
+// Use the DJ-graph: the dominator tree (D-edges), and the CFG edges x -> y
+// where x isn't idom(y) (J-edges)
+// Blocks of S are put in a priority queue ordered by level in the dom tree.
+// The deepest block x is removed, and its subtree visited. Every J-edge
+// y -> z leaving the subtree with level(z) <= level(x) gives z in IDF(S).
+// z is then added to the queue. Every block is visited only once, the whole
+// computation is linear in the size of the DJ-graph.
+//
+// Paper A Linear Time Algorithm for Placing phi-nodes - Sreedhar and Gao
+class IDF {
+public:
+  IDF(const Function &fun, const CFG &cfg, const DomTree &dt);
+
+  std::vector<const BasicBlock *>
+  idf(const std::set<const BasicBlock *> &defs) const;
+
+private:
+  VertexAdapter<const BasicBlock *> _va;
+  std::vector<std::size_t> _levels;
+  std::vector<std::vector<std::size_t>> _dsuccs; // D-edges
+  std::vector<std::vector<std::size_t>> _jsuccs; // J-edges
+
+  // Reused between calls, cleared by stamping with a new call id
+  mutable unsigned _stamp;
+  mutable std::vector<unsigned> _visited;
+  mutable std::vector<unsigned> _queued;
+  mutable std::vector<unsigned> _in_idf;
+  mutable std::vector<std::vector<std::size_t>> _bank;
+};
@@ -0,0 +1,60 @@
+#include "liveness.hh"
+
+#include <cassert>
+
+#include "isa.hh"
+
+Liveness::Liveness(const Function &fun, const CFG &cfg) : _fun(fun), _cfg(cfg) {
+  _build();
+}
+
+const Liveness::regs_set_t &Liveness::live_in(const BasicBlock &bb) const {
+  auto it = _live_in.find(&bb);
+  assert(it != _live_in.end());
+  return it->second;
+}
+
+const Liveness::regs_set_t &Liveness::live_out(const BasicBlock &bb) const {
+  auto it = _live_out.find(&bb);
+  assert(it != _live_out.end());
+  return it->second;
+}
+
+void Liveness::_build() {
+  // Compute UEVar / VarKill of all bbs
+  for (const auto &bb : _fun.bb()) {
+    auto &uevar = _uevar[&bb];
+    auto &varkill = _varkill[&bb];
+    for (const auto &ins : bb.ins()) {
+      for (const auto &r : isa::uses(ins))
+        if (!varkill.count(r))
+          uevar.insert(r);
+      for (const auto &r : isa::defs(ins))
+        varkill.insert(r);
+    }
+
+    _live_in[&bb] = uevar;
+    _live_out[&bb];
+  }
+
+  // Iterate in postorder, succs are usually updated before their preds
+  auto order = _cfg.rev_postorder();
+  for (bool changed = true; changed;) {
+    changed = false;
+
+    for (auto it = order.rbegin(); it != order.rend(); ++it) {
+      auto bb = *it;
+      auto &live_out = _live_out[bb];
+      for (auto succ : _cfg.succs(*bb))
+        for (const auto &r : _live_in[succ])
+          live_out.insert(r);
+
+      // LiveIn can only grow
+      auto &live_in = _live_in[bb];
+      const auto &varkill = _varkill[bb];
+      for (const auto &r : live_out)
+        if (!varkill.count(r) && live_in.insert(r).second)
+          changed = true;
+    }
+  }
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <map>
+#include <set>
+#include <string>
+
+#include "cfg.hh"
+#include "module.hh"
+
+// Compute the sets LiveIn(bb) and LiveOut(bb) for every bb in a function
+// A register v is live at point p if and only if it exists a path in the CFG
+// from p to a use of v, along which v is not redefined
+// LiveOut(bb) = |_{m in Succs(bb)} (UEVar(m) | (LiveOut(m) & ~VarKill(m)))
+// LiveIn(bb) = UEVar(bb) | (LiveOut(bb) & ~VarKill(bb))
+//
+// Blocks are visited in postorder, usually needs only a few iterations
+//
+// Algorithm LiveOut Variables - Engineer a Compiler p445
+class Liveness {
+public:
+  using regs_set_t = std::set<std::string>;
+
+  Liveness(const Function &fun, const CFG &cfg);
+
+  const regs_set_t &live_in(const BasicBlock &bb) const;
+  const regs_set_t &live_out(const BasicBlock &bb) const;
+
+private:
+  const Function &_fun;
+  const CFG &_cfg;
+  std::map<const BasicBlock *, regs_set_t> _uevar;
+  std::map<const BasicBlock *, regs_set_t> _varkill;
+  std::map<const BasicBlock *, regs_set_t> _live_in;
+  std::map<const BasicBlock *, regs_set_t> _live_out;
+
+  void _build();
+};
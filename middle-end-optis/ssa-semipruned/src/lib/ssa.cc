@@ -5,57 +5,63 @@
 #include <map>
 #include <set>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 #include "cfg.hh"
 #include "dom-frontier.hh"
+#include "idf.hh"
 #include "isa.hh"
+#include "liveness.hh"
 
 namespace {
 
-template <class K, class V> class ScopedMap {
+// Stack of current definitions for every variable
+// Variables are identified by dense ids (see SSA::_var_id)
+// Every scope keeps an undo list of the variables it pushed a def for,
+// closing it pops them. Open / close / find are O(1) per def
+template <class V> class DefStacks {
 
 public:
-  using iterator_t = typename std::map<K, V>::const_iterator;
+  ~DefStacks() { assert(_marks.empty()); }
 
-  ScopedMap() : _stack({std::map<K, V>{}}) {}
-
-  ~ScopedMap() { assert(_stack.size() == 1); }
-
-  void open() { _stack.push_back(std::map<K, V>{}); }
+  void open() { _marks.push_back(_undo.size()); }
 
   void close() {
-    assert(_stack.size() > 1);
-    _stack.pop_back();
+    assert(!_marks.empty());
+    for (auto i = _undo.size(); i > _marks.back(); --i)
+      _stacks[_undo[i - 1]].pop_back();
+    _undo.resize(_marks.back());
+    _marks.pop_back();
   }
 
-  iterator_t put(const K &key, const V &val) {
-    assert(_stack.size() > 1);
-    auto ret = _stack.back().emplace(key, val);
-    if (!ret.second)
-      ret.first->second = val;
-    return ret.first;
+  void put(std::size_t var, const V &val) {
+    assert(!_marks.empty());
+    if (var >= _stacks.size())
+      _stacks.resize(var + 1);
+    _stacks[var].push_back(val);
+    _undo.push_back(var);
   }
 
-  iterator_t find(const K &key) const {
-    assert(_stack.size() > 1);
-    for (auto sit = _stack.rbegin(); sit != _stack.rend(); ++sit) {
-      auto it = sit->find(key);
-      if (it != sit->end())
-        return it;
-    }
-
-    return end();
+  // Returns current def of var, or nullptr if none
+  const V *find(std::size_t var) const {
+    assert(!_marks.empty());
+    if (var >= _stacks.size() || _stacks[var].empty())
+      return nullptr;
+    return &_stacks[var].back();
   }
 
-  iterator_t end() const { return _stack[0].end(); }
-
 private:
-  std::vector<std::map<K, V>> _stack;
+  std::vector<std::vector<V>> _stacks;
+  std::vector<std::size_t> _undo;
+  std::vector<std::size_t> _marks;
 };
 
 class SSA {
 public:
-  SSA(Function &fun) : _fun(fun), _cfg(_fun), _df(fun) {}
+  SSA(Function &fun, bool pruned)
+      : _fun(fun), _cfg(_fun), _df(fun), _idf(_fun, _cfg, _df.dom_tree()),
+        _pruned(pruned) {}
 
   void run() {
     // Find globals and defs
@@ -64,6 +70,11 @@ public:
     // Insert phis
     _find_phis();
     _prune_phis();
+    _nphis_semi = _count_phis();
+    if (_pruned) {
+      _prune_dead_phis();
+      _nphis_pruned = _count_phis();
+    }
     _insert_phis();
 
     // Rename all registers
@@ -76,6 +87,11 @@ private:
   Function &_fun;
   CFG _cfg;
   DomFrontier _df;
+  IDF _idf;
+  const bool _pruned;
+
+  std::size_t _nphis_semi;
+  std::size_t _nphis_pruned;
 
   // use of reg defined in another bb
   std::set<std::string> _globals;
@@ -88,6 +104,13 @@ private:
 
   std::map<std::string, std::size_t> _next_ids;
 
+  // reg name => dense id used by DefStacks
+  std::unordered_map<std::string, std::size_t> _var_ids;
+
+  std::size_t _var_id(const std::string &name) {
+    return _var_ids.emplace(name, _var_ids.size()).first->second;
+  }
+
   // Init _globals and _blocks
   void _prepare() {
     for (const auto &bb : _fun.bb()) {
@@ -111,44 +134,34 @@ private:
     for (const auto &bb : _fun.bb())
       _phis.emplace(&bb, std::set<std::string>{});
 
-    for (const auto &def : _globals) {
-      auto wlist = _blocks.find(def)->second;
-
-      while (!wlist.empty()) {
-        auto bb = *wlist.begin();
-        wlist.erase(wlist.begin());
-
-        for (auto d : _df.df(*bb))
-          if (_phis[d].insert(def).second)
-            wlist.insert(d);
-      }
-    }
+    for (const auto &def : _globals)
+      for (auto bb : _idf.idf(_blocks.find(def)->second))
+        _phis[bb].insert(def);
   }
 
   // Prune phis that are invalid
   // There are phis that refer to variable not defined in the dom path
   // leading to it
   void _prune_phis() {
-    ScopedMap<std::string, int> defs;
+    DefStacks<char> defs;
     const auto &bb = _fun.get_entry_bb();
     _prune_phis_rec(bb, defs);
   }
 
-  void _prune_phis_rec(const BasicBlock &bb,
-                       ScopedMap<std::string, int> &defs) {
+  void _prune_phis_rec(const BasicBlock &bb, DefStacks<char> &defs) {
     defs.open();
 
     // Insert all defs in scoped map
     for (const auto &ins : bb.ins())
       for (const auto &r : isa::defs(ins))
-        defs.put(r, 1);
+        defs.put(_var_id(r), 1);
 
     // Remove all phis of CFG succs not in defs
     for (auto next : _cfg.succs(bb)) {
       auto &phis = _phis.find(next)->second;
       std::vector<std::string> invalid;
       for (const auto &r : phis) {
-        if (defs.find(r) == defs.end())
+        if (!defs.find(_var_id(r)))
           invalid.push_back(r);
       }
       for (const auto &r : invalid)
@@ -162,6 +175,28 @@ private:
     defs.close();
   }
 
+  // Remove phis of variables not live at the beginning of the block
+  // They are never used (full pruning)
+  void _prune_dead_phis() {
+    Liveness live(_fun, _cfg);
+    for (auto &it : _phis) {
+      const auto &live_in = live.live_in(*it.first);
+      auto &phis = it.second;
+      for (auto pit = phis.begin(); pit != phis.end();)
+        if (live_in.count(*pit))
+          ++pit;
+        else
+          pit = phis.erase(pit);
+    }
+  }
+
+  std::size_t _count_phis() const {
+    std::size_t res = 0;
+    for (const auto &it : _phis)
+      res += it.second.size();
+    return res;
+  }
+
   // Insert phis not renamed yet where needed
   void _insert_phis() const {
     for (auto &bb : _fun.bb()) {
@@ -192,12 +227,11 @@ private:
   }
 
   void _rename() {
-    ScopedMap<std::string, std::string> new_names;
+    DefStacks<std::string> new_names;
     _rename_bb(_fun.get_entry_bb(), new_names);
   }
 
-  void _rename_bb(BasicBlock &bb,
-                  ScopedMap<std::string, std::string> &new_names) {
+  void _rename_bb(BasicBlock &bb, DefStacks<std::string> &new_names) {
     new_names.open();
 
     for (auto &ins : bb.ins()) {
@@ -205,15 +239,15 @@ private:
       // Rename all uses
       if (ins.args[0] != "phi")
         for (auto &r : isa::uses(ins)) {
-          auto it = new_names.find(r);
-          assert(it != new_names.end());
-          r = it->second;
+          auto new_r = new_names.find(_var_id(r));
+          assert(new_r);
+          r = *new_r;
         }
 
       // Generate new names for all defs
       for (auto &r : isa::defs(ins)) {
         auto new_def = _rename_def(r);
-        new_names.put(r, new_def);
+        new_names.put(_var_id(r), new_def);
         r = new_def;
       }
     }
@@ -230,9 +264,9 @@ private:
           ++bb_idx;
 
         auto &r = ins.args[bb_idx + 1];
-        auto it = new_names.find(r);
-        assert(it != new_names.end());
-        r = it->second;
+        auto new_r = new_names.find(_var_id(r));
+        assert(new_r);
+        r = *new_r;
       }
     }
 
@@ -272,14 +306,19 @@ private:
       std::cout << "}\n";
     }
     std::cout << "\n";
+
+    std::cout << "phis count: semi-pruned: " << _nphis_semi;
+    if (_pruned)
+      std::cout << ", pruned: " << _nphis_pruned;
+    std::cout << "\n\n";
   }
 };
 
 } // namespace
 
-void ssa_run(Module &mod) {
+void ssa_run(Module &mod, bool pruned) {
   for (auto &fun : mod.fun()) {
-    SSA ssa(fun);
+    SSA ssa(fun, pruned);
     ssa.run();
   }
 }
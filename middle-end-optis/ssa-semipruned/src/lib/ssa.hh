@@ -12,5 +12,10 @@
 //    techniques can be used to remove it using liveness analysis (full pruning)
 // 5) Rename every def in the code to get unique names
 //
+// Phis are placed at the Iterated Dominance Frontier of the defs blocks,
+// computed in linear time on the DJ-graph (see idf.hh)
+// With pruned, liveness is used to only keep phis for variables live at the
+// beginning of the block (full pruning). Both phi counts are reported.
+//
 // Algorithm SSA semi-pruned conversion - Engineer a Compiler p496
-void ssa_run(Module &mod);
+void ssa_run(Module &mod, bool pruned = false);
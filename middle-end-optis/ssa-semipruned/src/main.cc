@@ -9,14 +9,15 @@
 
 int main(int argc, char **argv) {
   if (argc < 2) {
-    std::cerr << "Usage: ssa-semipruned <src-file>" << std::endl;
+    std::cerr << "Usage: ssa-semipruned <src-file> [--pruned]" << std::endl;
     return 1;
   }
 
   auto in_file = argv[1];
   auto mod = load_module(in_file);
 
-  ssa_run(*mod);
+  bool pruned = argc > 2 && !strcmp(argv[2], "--pruned");
+  ssa_run(*mod, pruned);
 
   mod2gop(*mod).dump(std::cout);
   return 0;
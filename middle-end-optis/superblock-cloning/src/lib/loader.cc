@@ -3,6 +3,7 @@
 #include <fstream>
 
 #include "../isa/isa.hh"
+#include "profile.hh"
 #include <utils/cli/err.hh>
 
 namespace {
@@ -10,7 +11,8 @@ namespace {
 class ModuleBuilder {
 
 public:
-  ModuleBuilder(const gop::Module &mod) : _mod(mod) {}
+  ModuleBuilder(const gop::Module &mod, EdgeProfile *prof)
+      : _mod(mod), _prof(prof) {}
 
   std::unique_ptr<Module> run() {
     isa::check(_mod);
@@ -71,6 +73,7 @@ public:
 
 private:
   const gop::Module &_mod;
+  EdgeProfile *_prof;
   std::unique_ptr<Module> _res;
   std::map<Instruction *, const gop::Ins *> _ins_map;
   std::map<std::string, Value *> _def_map;
@@ -124,6 +127,8 @@ private:
         auto it = _ins_map.find(&ins);
         assert(it != _ins_map.end());
         _fix(ins, it->second->args);
+        if (_prof && ins.is_branch() && !it->second->comm_eol.empty())
+          _prof->parse(ins, it->second->comm_eol);
       }
 
     _ins_map.clear();
@@ -174,22 +179,24 @@ private:
 
 } // namespace
 
-std::unique_ptr<Module> load_module(const gop::Module &mod) {
-  ModuleBuilder mb(mod);
+std::unique_ptr<Module> load_module(const gop::Module &mod,
+                                    EdgeProfile *prof) {
+  ModuleBuilder mb(mod, prof);
   return mb.run();
 }
 
-std::unique_ptr<Module> load_module(std::istream &is) {
+std::unique_ptr<Module> load_module(std::istream &is, EdgeProfile *prof) {
   auto mod = gop::Module::parse(is);
-  return load_module(mod);
+  return load_module(mod, prof);
 }
 
-std::unique_ptr<Module> load_module(const std::string &path) {
+std::unique_ptr<Module> load_module(const std::string &path,
+                                    EdgeProfile *prof) {
   std::ifstream is(path);
-  return load_module(is);
+  return load_module(is, prof);
 }
 
-gop::Module mod2gop(const Module &mod) {
+gop::Module mod2gop(const Module &mod, const EdgeProfile *prof) {
   gop::Module res;
 
   for (auto &f : mod.fun()) {
@@ -210,6 +217,8 @@ gop::Module mod2gop(const Module &mod) {
         auto gins = std::make_unique<gop::Ins>(ins.sargs());
         if (is_first)
           gins->label_defs = {bb.get_name()};
+        if (prof && prof->has(ins))
+          gins->comm_eol = prof->to_comm(ins);
 
         res.decls.push_back(std::move(gins));
         is_first = false;
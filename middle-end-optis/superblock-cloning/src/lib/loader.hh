@@ -3,13 +3,20 @@
 #include "module.hh"
 #include <gop10/module.hh>
 
+class EdgeProfile;
+
 // Build a Module given gop module
 // Divide module into functions and basic blocks
 // Check if whole module is well formed
-std::unique_ptr<Module> load_module(const gop::Module &mod);
-std::unique_ptr<Module> load_module(std::istream &is);
-std::unique_ptr<Module> load_module(const std::string &path);
+// If prof isn't null, the edge counts of the branches are loaded in it
+std::unique_ptr<Module> load_module(const gop::Module &mod,
+                                    EdgeProfile *prof = nullptr);
+std::unique_ptr<Module> load_module(std::istream &is,
+                                    EdgeProfile *prof = nullptr);
+std::unique_ptr<Module> load_module(const std::string &path,
+                                    EdgeProfile *prof = nullptr);
 
 // Convert a module to a gop::Module
 // Labels are basic blocks labels
-gop::Module mod2gop(const Module &mod);
+// If prof isn't null, the edge counts are dumped as end-of-line comments
+gop::Module mod2gop(const Module &mod, const EdgeProfile *prof = nullptr);
@@ -0,0 +1,220 @@
+#include "loop-info.hh"
+
+#include <algorithm>
+
+LoopInfo::LoopInfo(Function &fun, const CFG &cfg, const IDom &idom)
+    : _fun(fun), _cfg(cfg), _idom(idom) {
+  const auto &mva = _cfg.mva(_fun);
+  for (auto bb : _cfg.rev_postorder()) {
+    _rpo_pos[bb] = _rpo.size();
+    _rpo.push_back(mva(_cfg.va()(bb)));
+  }
+
+  // Headers in postorder: inner loops first
+  for (auto it = _rpo.rbegin(); it != _rpo.rend(); ++it)
+    _build_loop(**it);
+
+  _fill_loops();
+  _find_irreducible();
+}
+
+Loop *LoopInfo::loop_of(const BasicBlock &bb) const {
+  auto it = _loop_of.find(&bb);
+  return it == _loop_of.end() ? nullptr : it->second;
+}
+
+std::size_t LoopInfo::depth(const BasicBlock &bb) const {
+  auto loop = loop_of(bb);
+  return loop ? loop->depth() : 0;
+}
+
+bool LoopInfo::is_header(const BasicBlock &bb) const {
+  auto loop = loop_of(bb);
+  return loop && &loop->header() == &bb;
+}
+
+bool LoopInfo::_dominates(const BasicBlock &a, const BasicBlock &b) const {
+  for (auto d : _idom.dom(b))
+    if (d == &a)
+      return true;
+  return false;
+}
+
+void LoopInfo::_build_loop(BasicBlock &header) {
+  std::vector<BasicBlock *> work;
+  for (auto pred : _cfg.preds(header))
+    if (_dominates(header, *pred))
+      work.push_back(pred);
+  if (work.empty())
+    return;
+
+  _loops.push_back(std::make_unique<Loop>());
+  auto loop = _loops.back().get();
+  loop->_header = &header;
+  loop->_latches = work;
+  _loops_po.push_back(loop);
+  _loop_of[&header] = loop;
+
+  while (!work.empty()) {
+    auto bb = work.back();
+    work.pop_back();
+
+    auto sub = loop_of(*bb);
+    if (!sub) {
+      // New block of the loop
+      _loop_of[bb] = loop;
+      for (auto pred : _cfg.preds(*bb))
+        work.push_back(pred);
+      continue;
+    }
+
+    // Already in a loop: go to the outermost one found so far
+    while (sub->_parent)
+      sub = sub->_parent;
+    if (sub == loop)
+      continue;
+
+    // Subloop: continue from the preds of its header (preds inside the
+    // subloop are skipped when visited)
+    sub->_parent = loop;
+    loop->_children.push_back(sub);
+    for (auto pred : _cfg.preds(sub->header()))
+      work.push_back(pred);
+  }
+}
+
+void LoopInfo::_fill_loops() {
+  // Only the innermost loop of each block is known
+  for (auto bb : _rpo)
+    for (auto loop = loop_of(*bb); loop; loop = loop->_parent) {
+      loop->_blocks.push_back(bb);
+      loop->_blocks_set.insert(bb);
+    }
+
+  for (auto it = _loops_po.rbegin(); it != _loops_po.rend(); ++it) {
+    auto loop = *it;
+    loop->_depth = loop->_parent ? loop->_parent->_depth + 1 : 1;
+    if (!loop->_parent)
+      _top_level.push_back(loop);
+  }
+  std::sort(_top_level.begin(), _top_level.end(),
+            [this](const Loop *a, const Loop *b) {
+              return _rpo_pos.at(&a->header()) < _rpo_pos.at(&b->header());
+            });
+
+  for (auto &loop : _loops) {
+    std::sort(loop->_children.begin(), loop->_children.end(),
+              [this](const Loop *a, const Loop *b) {
+                return _rpo_pos.at(&a->header()) < _rpo_pos.at(&b->header());
+              });
+
+    std::set<const BasicBlock *> exits;
+    for (auto bb : loop->_blocks)
+      for (auto succ : _cfg.succs(*bb))
+        if (!loop->contains(*succ) && exits.insert(succ).second)
+          loop->_exits.push_back(succ);
+
+    BasicBlock *outside = nullptr;
+    std::size_t outside_count = 0;
+    for (auto pred : _cfg.preds(loop->header()))
+      if (!loop->contains(*pred)) {
+        outside = pred;
+        ++outside_count;
+      }
+    if (outside_count == 1 && _cfg.succs(*outside).size() == 1)
+      loop->_preheader = outside;
+  }
+}
+
+void LoopInfo::_find_irreducible() {
+  for (auto u : _rpo)
+    for (auto v : _cfg.succs(*u)) {
+      if (_rpo_pos.at(v) > _rpo_pos.at(u) || _dominates(*v, *u) ||
+          _irreducible_bbs.count(v))
+        continue;
+
+      // Search the SCC of v, in the innermost loop containing u and v,
+      // without its header
+      auto loop = loop_of(*v);
+      while (loop && !loop->contains(*u))
+        loop = loop->parent();
+      auto in_sub = [&](const BasicBlock *bb) {
+        return loop ? loop->contains(*bb) && bb != &loop->header() : true;
+      };
+
+      std::set<BasicBlock *> fwd{v};
+      std::vector<BasicBlock *> work{v};
+      while (!work.empty()) {
+        auto bb = work.back();
+        work.pop_back();
+        for (auto succ : _cfg.succs(*bb))
+          if (in_sub(succ) && fwd.insert(succ).second)
+            work.push_back(succ);
+      }
+
+      std::set<BasicBlock *> bwd{v};
+      work.push_back(v);
+      while (!work.empty()) {
+        auto bb = work.back();
+        work.pop_back();
+        for (auto pred : _cfg.preds(*bb))
+          if (in_sub(pred) && bwd.insert(pred).second)
+            work.push_back(pred);
+      }
+
+      Region region;
+      for (auto bb : _rpo)
+        if (fwd.count(bb) && bwd.count(bb)) {
+          region.blocks.push_back(bb);
+          _irreducible_bbs.insert(bb);
+        }
+      for (auto bb : region.blocks)
+        for (auto pred : _cfg.preds(*bb))
+          if (!fwd.count(pred) || !bwd.count(pred)) {
+            region.entries.push_back(bb);
+            break;
+          }
+      _irreducible.push_back(region);
+    }
+}
+
+namespace {
+
+void dump_bbs(std::ostream &os, const std::vector<BasicBlock *> &bbs) {
+  os << "{";
+  for (std::size_t i = 0; i < bbs.size(); ++i)
+    os << (i ? ", " : "") << bbs[i]->get_name();
+  os << "}";
+}
+
+} // namespace
+
+void LoopInfo::dump(std::ostream &os) const {
+  os << "Loops of " << _fun.get_name() << ":\n";
+  for (auto loop : _top_level)
+    _dump_loop(os, *loop);
+
+  for (const auto &region : _irreducible) {
+    os << "  irreducible region ";
+    dump_bbs(os, region.blocks);
+    os << ", entries ";
+    dump_bbs(os, region.entries);
+    os << "\n";
+  }
+  os << "\n";
+}
+
+void LoopInfo::_dump_loop(std::ostream &os, const Loop &loop) const {
+  os << std::string(2 * loop.depth(), ' ') << "loop "
+     << loop.header().get_name() << " (depth " << loop.depth() << "): ";
+  dump_bbs(os, loop.blocks());
+  os << ", latches ";
+  dump_bbs(os, loop.latches());
+  os << ", exits ";
+  dump_bbs(os, loop.exits());
+  os << ", preheader "
+     << (loop.preheader() ? loop.preheader()->get_name() : "none") << "\n";
+
+  for (auto sub : loop.children())
+    _dump_loop(os, *sub);
+}
@@ -0,0 +1,51 @@
+#include "profile.hh"
+
+#include <cstdlib>
+
+#include <utils/cli/err.hh>
+#include <utils/str/str.hh>
+
+const std::vector<long> &EdgeProfile::get(const Instruction &br) const {
+  static const std::vector<long> none;
+  auto it = _counts.find(&br);
+  return it == _counts.end() ? none : it->second;
+}
+
+void EdgeProfile::set(const Instruction &br, const std::vector<long> &counts) {
+  PANIC_IF(counts.size() != br.branch_targets().size(),
+           "Invalid number of counts for branch");
+  _counts[&br] = counts;
+}
+
+long EdgeProfile::edge(const BasicBlock &src, const BasicBlock &dst) const {
+  const auto &br = src.ins().back();
+  const auto &counts = get(br);
+  auto targets = br.branch_targets();
+  long res = 0;
+  for (std::size_t i = 0; i < counts.size(); ++i)
+    if (targets[i] == &dst)
+      res += counts[i];
+  return res;
+}
+
+long EdgeProfile::out(const BasicBlock &bb) const {
+  long res = 0;
+  for (auto c : get(bb.ins().back()))
+    res += c;
+  return res;
+}
+
+void EdgeProfile::parse(const Instruction &br, const std::string &comm) {
+  std::vector<long> counts;
+  for (const auto &val : utils::str::split(utils::str::trim(comm), ' '))
+    if (!val.empty())
+      counts.push_back(std::atol(val.c_str()));
+  set(br, counts);
+}
+
+std::string EdgeProfile::to_comm(const Instruction &br) const {
+  std::string res;
+  for (auto c : get(br))
+    res += (res.empty() ? "" : " ") + std::to_string(c);
+  return res;
+}
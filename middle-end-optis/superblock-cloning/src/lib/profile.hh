@@ -0,0 +1,36 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "module.hh"
+
+// Edge profile: execution count of every CFG edge
+// Stored on the branch instructions, with one count per target, in the same
+// order than the targets.
+// In IR files, the counts are the end-of-line comment of the branch
+// eg: bc %c, @B2, @B5 ; 70 30
+class EdgeProfile {
+
+public:
+  bool has(const Instruction &br) const { return _counts.count(&br); }
+
+  // Count of all targets of br (empty if no profile)
+  const std::vector<long> &get(const Instruction &br) const;
+
+  void set(const Instruction &br, const std::vector<long> &counts);
+
+  // Sum of the counts of edges from src to dst
+  long edge(const BasicBlock &src, const BasicBlock &dst) const;
+
+  // Sum of the counts of all edges from bb
+  long out(const BasicBlock &bb) const;
+
+  // Parse / dump the counts of an end-of-line comment
+  void parse(const Instruction &br, const std::string &comm);
+  std::string to_comm(const Instruction &br) const;
+
+private:
+  std::map<const Instruction *, std::vector<long>> _counts;
+};
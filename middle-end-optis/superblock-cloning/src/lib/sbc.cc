@@ -2,86 +2,16 @@
 
 #include <iostream>
 
+#include <utils/cli/err.hh>
+
 #include "cfg.hh"
 #include "cloner.hh"
 #include "digraph-order.hh"
+#include "idom.hh"
+#include "loop-info.hh"
 
 namespace {
 
-constexpr std::size_t PRED_NONE = -1;
-
-class CyclesFinder {
-
-public:
-  CyclesFinder(const Digraph &g) : _g(g) { _run(); }
-
-  bool has_cycle() const { return !_cycle.empty(); }
-
-  const std::vector<std::size_t> &get_cycle() const {
-    assert(has_cycle());
-    return _cycle;
-  }
-
-private:
-  const Digraph &_g;
-
-  std::vector<std::size_t> _marked;
-  std::vector<std::size_t> _preds;
-  std::vector<std::size_t> _on_stack;
-
-  std::vector<std::size_t> _cycle;
-
-  void _run() {
-    _marked.assign(_g.v(), 0);
-    _preds.assign(_g.v(), PRED_NONE);
-    _on_stack.assign(_g.v(), 0);
-
-    for (std::size_t i = 0; i < _g.v(); ++i)
-      if (!_marked[i])
-        _dfs(i);
-  }
-
-  void _dfs(std::size_t u) {
-    _marked[u] = 1;
-    _on_stack[u] = 1;
-
-    for (auto w : _g.succs(u)) {
-      if (has_cycle())
-        return;
-
-      _preds[w] = u;
-
-      if (_on_stack[w]) {
-        // Cycle detected
-        _build_cycle(w);
-        return;
-      }
-
-      else if (!_marked[w]) {
-        _dfs(w);
-      }
-    }
-
-    _on_stack[u] = 0;
-  }
-
-  void _build_cycle(std::size_t w) {
-
-    std::vector<std::size_t> rcycle;
-    std::size_t node = w;
-
-    while (_preds[node] != w) {
-      assert(_preds[node] != PRED_NONE);
-      node = _preds[node];
-      rcycle.push_back(node);
-    }
-
-    rcycle.push_back(w);
-
-    _cycle.assign(rcycle.rbegin(), rcycle.rend());
-  }
-};
-
 class SBC {
 public:
   SBC(Function &fun) : _fun(fun), _cfg(_fun) {}
@@ -116,10 +46,12 @@ private:
   std::map<BasicBlock *, BasicBlock *> _to_fix; // need to fix phis on these
                                                 // ones
 
-  // Find the loop head
+  // Find the loop head (first outermost loop)
   BasicBlock &_find_loop() {
-    CyclesFinder cf(_cfg.graph());
-    return *_cfg.mva(_fun)(cf.get_cycle().front());
+    IDom idom(_fun, _cfg);
+    LoopInfo li(_fun, _cfg, idom);
+    PANIC_IF(li.top_level().empty(), "No loop in " + _fun.get_name());
+    return li.top_level().front()->header();
   }
 
   void _build_backward() {
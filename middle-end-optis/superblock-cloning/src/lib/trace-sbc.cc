@@ -0,0 +1,520 @@
+#include "trace-sbc.hh"
+
+#include <algorithm>
+#include <iostream>
+#include <set>
+
+#include <utils/cli/err.hh>
+
+#include "cfg.hh"
+
+namespace {
+
+// Minimum probability (in %) of an edge to be added to a trace
+constexpr long MIN_PROB = 60;
+
+// Maximum code growth, in % of the number of instructions of the function
+constexpr std::size_t GROWTH_PERCENT = 50;
+
+using trace_t = std::vector<BasicBlock *>;
+using preds_t = std::map<const BasicBlock *, std::vector<BasicBlock *>>;
+
+std::size_t ins_count(const BasicBlock &bb) {
+  std::size_t res = 0;
+  for (auto it = bb.ins_begin(); it != bb.ins_end(); ++it)
+    ++res;
+  return res;
+}
+
+bool is_phi(const Instruction &ins) { return ins.get_opname() == "phi"; }
+
+// Replace phi by a new phi with operands ops
+Instruction &rebuild_phi(Instruction &phi, const std::vector<Value *> &ops) {
+  auto &bb = phi.parent();
+  auto name = phi.get_name();
+  auto &res = *bb.insert_ins(ins_iterator_t(&phi), "phi", ops, "",
+                             phi.get_def_idx());
+  phi.replace_all_uses_with(res);
+  phi.erase_from_parent();
+  res.set_name(name);
+  return res;
+}
+
+// Rewrite all uses of a value that now has 2 definitions: def, and its copy
+// cdef, in different blocks
+// Each use gets the definition that reaches it, phis are added in blocks where
+// both definitions meet
+class SSAUpdater {
+public:
+  SSAUpdater(const preds_t &preds, Instruction &def, Instruction &cdef)
+      : _preds(preds), _def(def), _cdef(cdef) {}
+
+  void run() {
+    for (auto val : {&_def, &_cdef})
+      for (auto user : val->get_users()) {
+        auto ins = dynamic_cast<Instruction *>(user);
+        if (!ins)
+          continue;
+        for (std::size_t i = 0; i < ins->ops_count(); ++i)
+          if (&ins->op(i) == val)
+            _rewrite(*ins, i);
+      }
+  }
+
+private:
+  const preds_t &_preds;
+  Instruction &_def;
+  Instruction &_cdef;
+
+  // Definition reaching the beginning of each block
+  std::map<const BasicBlock *, Value *> _at_entry;
+
+  void _rewrite(Instruction &ins, std::size_t idx) {
+    Value *new_val;
+    if (is_phi(ins))
+      new_val = &_at_end(dynamic_cast<BasicBlock &>(ins.op(idx - 1)));
+    else if (&ins.parent() == &_def.parent())
+      new_val = &_def;
+    else if (&ins.parent() == &_cdef.parent())
+      new_val = &_cdef;
+    else
+      new_val = &_at_begin(ins.parent());
+
+    if (new_val != &ins.op(idx))
+      ins.set_op(idx, *new_val);
+  }
+
+  Value &_at_end(BasicBlock &bb) {
+    if (&bb == &_def.parent())
+      return _def;
+    if (&bb == &_cdef.parent())
+      return _cdef;
+    return _at_begin(bb);
+  }
+
+  Value &_at_begin(BasicBlock &bb) {
+    auto it = _at_entry.find(&bb);
+    if (it != _at_entry.end()) {
+      PANIC_IF(!it->second, "Definition doesn't reach " + bb.get_name());
+      return *it->second;
+    }
+
+    auto pit = _preds.find(&bb);
+    PANIC_IF(pit == _preds.end() || pit->second.empty(),
+             "Definition doesn't reach " + bb.get_name());
+    const auto &preds = pit->second;
+
+    if (preds.size() == 1) {
+      _at_entry[&bb] = nullptr; // detect cycles
+      auto &res = _at_end(*preds[0]);
+      _at_entry[&bb] = &res;
+      return res;
+    }
+
+    // Add a phi before searching the preds (may be a loop)
+    std::vector<Value *> ops;
+    for (auto pred : preds) {
+      ops.push_back(pred);
+      ops.push_back(&_def);
+    }
+    auto &phi = *bb.insert_ins(bb.ins_begin(), "phi", ops, "", 1);
+    _at_entry[&bb] = &phi;
+    for (std::size_t i = 0; i < preds.size(); ++i)
+      phi.set_op(2 * i + 1, _at_end(*preds[i]));
+
+    // Remove it if all operands are the same
+    Value *same = nullptr;
+    for (std::size_t i = 1; i < phi.ops_count(); i += 2) {
+      auto val = &phi.op(i);
+      if (val == &phi || val == same)
+        continue;
+      if (same)
+        return phi;
+      same = val;
+    }
+
+    assert(same);
+    phi.replace_all_uses_with(*same);
+    phi.erase_from_parent();
+    for (auto &e : _at_entry)
+      if (e.second == &phi)
+        e.second = same;
+    return *same;
+  }
+};
+
+class TraceSBC {
+public:
+  TraceSBC(Function &fun, EdgeProfile &prof)
+      : _fun(fun), _prof(prof), _growth(0), _fusable(0) {}
+
+  void run() {
+    _build_preds();
+    _build_rpo();
+    _select_traces();
+
+    std::size_t size = 0;
+    for (const auto &bb : _fun.bb())
+      size += ins_count(bb);
+    _budget = size * GROWTH_PERCENT / 100;
+
+    for (const auto &trace : _traces)
+      _duplicate_tail(trace);
+
+    // Count the jumps inside the superblocks
+    for (const auto &trace : _traces)
+      for (std::size_t i = 1; i < trace.size(); ++i)
+        if (trace[i - 1]->ins().back().get_opname() == "b" &&
+            _preds[trace[i]].size() == 1)
+          ++_fusable;
+
+    std::cout << "Code growth: " << _growth << " / " << _budget
+              << " instructions\n";
+    std::cout << "Jumps that can be removed by fusing blocks: " << _fusable
+              << "\n\n";
+  }
+
+private:
+  Function &_fun;
+  EdgeProfile &_prof;
+
+  // Unique predecessors of every block, kept up to date
+  preds_t _preds;
+  // Reverse post-order of the original blocks, to find backward edges
+  std::map<const BasicBlock *, std::size_t> _rpo;
+
+  std::vector<trace_t> _traces;
+  std::size_t _budget;
+  std::size_t _growth;
+  std::size_t _fusable;
+  std::map<std::string, std::size_t> _dups_count;
+
+  static std::vector<BasicBlock *> _succs(BasicBlock &bb) {
+    auto res = bb.ins().back().branch_targets();
+    std::sort(res.begin(), res.end());
+    res.erase(std::unique(res.begin(), res.end()), res.end());
+    return res;
+  }
+
+  void _add_pred(BasicBlock &bb, BasicBlock &pred) {
+    auto &preds = _preds[&bb];
+    if (std::find(preds.begin(), preds.end(), &pred) == preds.end())
+      preds.push_back(&pred);
+  }
+
+  void _build_preds() {
+    for (auto &bb : _fun.bb()) {
+      _preds[&bb];
+      for (auto succ : _succs(bb))
+        _add_pred(*succ, bb);
+    }
+  }
+
+  void _build_rpo() {
+    CFG cfg(_fun);
+    auto order = cfg.rev_postorder();
+    for (std::size_t i = 0; i < order.size(); ++i)
+      _rpo[order[i]] = i;
+  }
+
+  bool _is_backward(const BasicBlock &src, const BasicBlock &dst) const {
+    auto src_it = _rpo.find(&src);
+    auto dst_it = _rpo.find(&dst);
+    return src_it == _rpo.end() || dst_it == _rpo.end() ||
+           dst_it->second <= src_it->second;
+  }
+
+  long _count(const BasicBlock &bb) const {
+    long in = 0;
+    for (auto pred : _preds.at(&bb))
+      in += _prof.edge(*pred, bb);
+    return std::max(in, _prof.out(bb));
+  }
+
+  BasicBlock *_max_succ(BasicBlock &bb) const {
+    BasicBlock *res = nullptr;
+    for (auto succ : _succs(bb))
+      if (!res || _prof.edge(bb, *succ) > _prof.edge(bb, *res))
+        res = succ;
+    return res;
+  }
+
+  BasicBlock *_max_pred(const BasicBlock &bb) const {
+    BasicBlock *res = nullptr;
+    for (auto pred : _preds.at(&bb))
+      if (!res || _prof.edge(*pred, bb) > _prof.edge(*res, bb))
+        res = pred;
+    return res;
+  }
+
+  // Edge src -> dst is likely enough compared to executions of bb
+  bool _is_likely(const BasicBlock &src, const BasicBlock &dst,
+                  const BasicBlock &bb) const {
+    auto w = _prof.edge(src, dst);
+    return w > 0 && w * 100 >= MIN_PROB * _count(bb);
+  }
+
+  void _select_traces() {
+    std::vector<BasicBlock *> blocks;
+    for (auto &bb : _fun.bb())
+      blocks.push_back(&bb);
+    std::stable_sort(blocks.begin(), blocks.end(),
+                     [this](const BasicBlock *a, const BasicBlock *b) {
+                       return _count(*a) > _count(*b);
+                     });
+
+    std::set<const BasicBlock *> in_trace;
+    for (auto seed : blocks) {
+      if (in_trace.count(seed) || _count(*seed) == 0)
+        continue;
+      trace_t trace{seed};
+      in_trace.insert(seed);
+
+      for (auto cur = seed;;) {
+        auto next = _max_succ(*cur);
+        if (!next || in_trace.count(next) || _is_backward(*cur, *next) ||
+            !_is_likely(*cur, *next, *cur) || _max_pred(*next) != cur)
+          break;
+        trace.push_back(next);
+        in_trace.insert(next);
+        cur = next;
+      }
+
+      for (auto cur = seed;;) {
+        auto prev = _max_pred(*cur);
+        if (!prev || in_trace.count(prev) || _is_backward(*prev, *cur) ||
+            !_is_likely(*prev, *cur, *cur) || _max_succ(*prev) != cur)
+          break;
+        trace.insert(trace.begin(), prev);
+        in_trace.insert(prev);
+        cur = prev;
+      }
+
+      if (trace.size() < 2)
+        continue;
+      std::cout << "Trace:";
+      for (auto bb : trace)
+        std::cout << " " << bb->get_name();
+      std::cout << " (" << _count(*seed) << ")\n";
+      _traces.push_back(trace);
+    }
+  }
+
+  // Set all targets of br equal to old_bb to new_bb
+  void _retarget(BasicBlock &bb, BasicBlock &old_bb, BasicBlock &new_bb) {
+    auto &br = bb.ins().back();
+    for (std::size_t i = 0; i < br.ops_count(); ++i)
+      if (&br.op(i) == &old_bb)
+        br.set_op(i, new_bb);
+
+    auto &preds = _preds[&old_bb];
+    preds.erase(std::find(preds.begin(), preds.end(), &bb));
+    _add_pred(new_bb, bb);
+  }
+
+  void _duplicate_tail(const trace_t &trace) {
+    // Find the first side entrance
+    std::size_t beg = 1;
+    while (beg < trace.size() && _preds[trace[beg]].size() == 1)
+      ++beg;
+    if (beg == trace.size())
+      return;
+
+    trace_t tail(trace.begin() + beg, trace.end());
+    std::size_t cost = 0;
+    for (auto bb : tail)
+      cost += ins_count(*bb);
+    if (_growth + cost > _budget) {
+      std::cout << "Skip tail from " << tail[0]->get_name() << " (" << cost
+                << " instructions)\n";
+      return;
+    }
+    _growth += cost;
+    std::cout << "Duplicate tail from " << tail[0]->get_name() << " (" << cost
+              << " instructions)\n";
+
+    // Part of the executions of each block that come from the trace
+    std::vector<double> ratios;
+    double on_trace = _prof.edge(*trace[beg - 1], *tail[0]);
+    for (std::size_t i = 0; i < tail.size(); ++i) {
+      auto count = _count(*tail[i]);
+      auto ratio = count ? std::min(1.0, on_trace / count) : 1.0;
+      ratios.push_back(ratio);
+      if (i + 1 < tail.size())
+        on_trace = ratio * _prof.edge(*tail[i], *tail[i + 1]);
+    }
+
+    // Clone all blocks, and remap the operands (including branch targets)
+    std::map<Value *, Value *> vmap;
+    trace_t copies;
+    for (auto bb : tail) {
+      auto id = _dups_count[bb->get_name()]++;
+      auto &copy = _fun.add_bb(bb->get_name() + "_dup" + std::to_string(id));
+      vmap[bb] = &copy;
+      copies.push_back(&copy);
+    }
+    for (std::size_t i = 0; i < tail.size(); ++i)
+      for (auto &ins : tail[i]->ins())
+        vmap[&ins] = &*copies[i]->insert_ins(copies[i]->ins_end(),
+                                             ins.get_opname(), ins.ops(), "",
+                                             ins.get_def_idx());
+    for (auto copy : copies)
+      for (auto &ins : copy->ins())
+        for (std::size_t i = 0; i < ins.ops_count(); ++i) {
+          auto it = vmap.find(&ins.op(i));
+          if (it != vmap.end())
+            ins.set_op(i, *it->second);
+        }
+
+    // Split the profile counts
+    for (std::size_t i = 0; i < tail.size(); ++i) {
+      const auto &br = tail[i]->ins().back();
+      std::vector<long> counts = _prof.get(br);
+      std::vector<long> copy_counts = counts;
+      for (std::size_t j = 0; j < counts.size(); ++j) {
+        counts[j] = static_cast<long>(counts[j] * ratios[i] + 0.5);
+        copy_counts[j] -= counts[j];
+      }
+      if (_prof.has(br)) {
+        _prof.set(br, counts);
+        _prof.set(copies[i]->ins().back(), copy_counts);
+      }
+    }
+
+    _fix_copies_phis(tail, vmap, *trace[beg - 1]);
+    _fix_exits_phis(tail, copies, vmap);
+
+    // Redirect all side entrances to the copies
+    for (auto copy : copies) {
+      _preds[copy];
+      for (auto succ : _succs(*copy))
+        _add_pred(*succ, *copy);
+    }
+    for (std::size_t i = 0; i < tail.size(); ++i) {
+      auto on_trace_pred = i == 0 ? trace[beg - 1] : tail[i - 1];
+      auto preds = _preds[tail[i]];
+      for (auto pred : preds)
+        if (pred != on_trace_pred)
+          _retarget(*pred, *tail[i], *copies[i]);
+    }
+
+    // Original blocks have only one pred left
+    for (std::size_t i = 0; i < tail.size(); ++i) {
+      auto pred = _preds[tail[i]].front();
+      std::vector<Instruction *> phis;
+      for (auto &ins : tail[i]->ins())
+        if (is_phi(ins))
+          phis.push_back(&ins);
+      for (auto phi : phis) {
+        Value *val = nullptr;
+        for (std::size_t j = 0; j < phi->ops_count(); j += 2)
+          if (&phi->op(j) == pred)
+            val = &phi->op(j + 1);
+        assert(val);
+        auto copy = vmap.at(phi);
+        auto &new_phi = rebuild_phi(*phi, {pred, val});
+        vmap.erase(phi);
+        vmap[&new_phi] = copy;
+      }
+    }
+
+    // Values defined in the tail now have 2 definitions
+    for (auto bb : tail)
+      for (auto &ins : bb->ins())
+        if (ins.has_def())
+          SSAUpdater(_preds, ins, dynamic_cast<Instruction &>(*vmap.at(&ins)))
+              .run();
+
+    for (auto bbs : {&tail, &copies})
+      for (auto bb : *bbs)
+        _remove_single_phis(*bb);
+  }
+
+  // The phis of the copies were cloned from the originals, and need to be
+  // updated for their preds:
+  // - copy of a tail block (if it was a pred of the original)
+  // - tail blocks that aren't the previous in the trace
+  // - all other preds of the original, except the block before the tail
+  void _fix_copies_phis(const trace_t &tail, std::map<Value *, Value *> &vmap,
+                        const BasicBlock &before) {
+    std::set<const Value *> in_tail(tail.begin(), tail.end());
+    for (std::size_t i = 0; i < tail.size(); ++i) {
+      const Value *on_trace_pred = i == 0 ? &before : tail[i - 1];
+      std::vector<Instruction *> phis;
+      for (auto &ins : tail[i]->ins())
+        if (is_phi(ins))
+          phis.push_back(&ins);
+
+      for (auto phi : phis) {
+        std::vector<Value *> ops;
+        for (std::size_t j = 0; j < phi->ops_count(); j += 2) {
+          auto pred = &phi->op(j);
+          auto val = &phi->op(j + 1);
+          if (in_tail.count(pred)) {
+            ops.push_back(vmap.at(pred));
+            ops.push_back(vmap.count(val) ? vmap.at(val) : val);
+            if (pred == on_trace_pred)
+              continue;
+          } else if (pred == on_trace_pred)
+            continue;
+          ops.push_back(pred);
+          ops.push_back(val);
+        }
+
+        auto &copy_phi = dynamic_cast<Instruction &>(*vmap.at(phi));
+        vmap[phi] = &rebuild_phi(copy_phi, ops);
+      }
+    }
+  }
+
+  // Blocks outside of the tail that have a copy as pred need a new operand in
+  // their phis
+  void _fix_exits_phis(const trace_t &tail, const trace_t &copies,
+                       std::map<Value *, Value *> &vmap) {
+    std::set<const BasicBlock *> new_bbs(copies.begin(), copies.end());
+    for (std::size_t i = 0; i < tail.size(); ++i)
+      for (auto succ : _succs(*copies[i])) {
+        if (new_bbs.count(succ))
+          continue;
+
+        std::vector<Instruction *> phis;
+        for (auto &ins : succ->ins())
+          if (is_phi(ins))
+            phis.push_back(&ins);
+
+        for (auto phi : phis) {
+          auto ops = phi->ops();
+          for (std::size_t j = 0; j < phi->ops_count(); j += 2)
+            if (&phi->op(j) == tail[i]) {
+              auto val = &phi->op(j + 1);
+              ops.push_back(copies[i]);
+              ops.push_back(vmap.count(val) ? vmap.at(val) : val);
+            }
+          rebuild_phi(*phi, ops);
+        }
+      }
+  }
+
+  // Phis of blocks with one pred are useless
+  void _remove_single_phis(BasicBlock &bb) {
+    std::vector<Instruction *> phis;
+    for (auto &ins : bb.ins())
+      if (is_phi(ins) && ins.ops_count() == 2 && &ins.op(1) != &ins)
+        phis.push_back(&ins);
+    for (auto phi : phis) {
+      phi->replace_all_uses_with(phi->op(1));
+      phi->erase_from_parent();
+    }
+  }
+};
+
+} // namespace
+
+void trace_sbc_run(Module &mod, EdgeProfile &prof) {
+  for (auto &fun : mod.fun()) {
+    if (!fun.has_def())
+      continue;
+    TraceSBC sbc(fun, prof);
+    sbc.run();
+  }
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "module.hh"
+#include "profile.hh"
+
+// Profile-guided superblock formation
+// Instead of cloning every path of a loop (see sbc.hh), only hot traces are
+// made into superblocks:
+// - Traces are selected from the edge profile: start from the hottest block
+//   not in a trace, and grow the trace forward / backward by following the
+//   most likely edges (edge is most likely succ of src and pred of dst, with at
+//   least 60% of the executions). A trace never follows a backward edge.
+// - Tail duplication: the part of the trace after the first side entrance is
+//   duplicated, and all side entrances go to the copy. The trace now only has
+//   one entry, its jumps can be removed by fusing blocks.
+// Duplications are done from the hottest trace, as long as the total code
+// growth stays below 50% of the function size.
+//
+// Traces are selected once on the original CFG, so backward edges are never
+// recomputed. The predecessors lists and the profile are updated after each
+// duplication. Values defined in a duplicated block now have 2 definitions:
+// their uses are rewritten, with new phis where both meet.
+//
+// The Superblock: An Effective Technique for VLIW and Superscalar Compilation
+// - Hwu et al.
+void trace_sbc_run(Module &mod, EdgeProfile &prof);
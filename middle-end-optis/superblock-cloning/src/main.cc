@@ -4,20 +4,29 @@
 
 #include "lib/loader.hh"
 #include "lib/module.hh"
+#include "lib/profile.hh"
 #include "lib/sbc.hh"
+#include "lib/trace-sbc.hh"
+
 int main(int argc, char **argv) {
   if (argc < 2) {
-    std::cerr << "Usage: superblock-cloning <src-file>" << std::endl;
+    std::cerr << "Usage: superblock-cloning <src-file> [--trace]" << std::endl;
     return 1;
   }
 
   auto in_file = argv[1];
-  auto mod = load_module(in_file);
+  bool trace = argc > 2 && !strcmp(argv[2], "--trace");
+
+  EdgeProfile prof;
+  auto mod = load_module(in_file, trace ? &prof : nullptr);
 
-  sbc_run(*mod);
+  if (trace)
+    trace_sbc_run(*mod, prof);
+  else
+    sbc_run(*mod);
   mod->check();
 
-  auto gout = mod2gop(*mod);
+  auto gout = mod2gop(*mod, trace ? &prof : nullptr);
   gout.dump(std::cout);
   isa::check(gout);
 
@@ -9,10 +9,12 @@
 // for only predecessor the bb before it on the path.
 // LVN is run on all paths reachable from the start BB
 //
-// To avoid running the whole LVN on every BB of each path every time, a
-// ScopedMap is used to divide infos by BBs. After visiting a BB, a scope is pop
-// to remove all infos found on this block, and still have infos about the prev
-// BBS
+// To avoid running the whole LVN on every BB of each path every time, the
+// tables are shared by all BBs of the path, and every update is saved in an
+// undo log. After visiting a BB, its updates are undone to remove all infos
+// found on this block, and still have infos about the prev BBS
+// Expressions are hash-consed to value numbers in an open addressing table
+// (see vn-table.hh)
 //
 // Algorithm Super Local Value Numbering - Engineer a Compiler p437
 void run_slvn(Module &mod);
@@ -0,0 +1,61 @@
+#include "vn-table.hh"
+
+namespace {
+
+constexpr std::size_t INIT_CAPACITY = 64;
+
+std::size_t hash_key(const VNKey &key) {
+  // 64-bit mix (splitmix64 finalizer) of the 3 fields
+  std::uint64_t h = static_cast<std::uint64_t>(key.op);
+  for (auto x : {key.v1, key.v2}) {
+    h ^= x + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+    h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    h = (h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+    h ^= h >> 31;
+  }
+  return h;
+}
+
+} // namespace
+
+VNTable::VNTable() : _slots(INIT_CAPACITY), _used(0) {}
+
+val_t VNTable::find(const VNKey &key) const {
+  const auto &slot = _slots[_find_slot(key)];
+  return slot.used ? slot.val : VAL_NO;
+}
+
+val_t VNTable::put(const VNKey &key, val_t val) {
+  auto &slot = _slots[_find_slot(key)];
+  if (slot.used) {
+    auto old = slot.val;
+    slot.val = val;
+    return old;
+  }
+
+  if (val == VAL_NO)
+    return VAL_NO;
+  slot = {key, val, true};
+  if (4 * ++_used > 3 * _slots.size())
+    _grow();
+  return VAL_NO;
+}
+
+std::size_t VNTable::_find_slot(const VNKey &key) const {
+  auto mask = _slots.size() - 1;
+  auto i = hash_key(key) & mask;
+  while (_slots[i].used && !(_slots[i].key == key))
+    i = (i + 1) & mask;
+  return i;
+}
+
+void VNTable::_grow() {
+  auto old = std::move(_slots);
+  _slots.assign(2 * old.size(), Slot{});
+  _used = 0;
+  for (const auto &slot : old)
+    if (slot.used && slot.val != VAL_NO) {
+      _slots[_find_slot(slot.key)] = slot;
+      ++_used;
+    }
+}
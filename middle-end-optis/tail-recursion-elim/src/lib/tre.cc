@@ -0,0 +1,172 @@
+#include "tre.hh"
+
+#include <iostream>
+#include <vector>
+
+namespace {
+
+// Call of the function itself, followed by ret (and maybe an accumulator)
+struct Site {
+  Instruction *call;
+  Instruction *op; // add / mul with the call result, or nullptr
+  std::size_t x;   // position of the other operand of op
+  Instruction *ret;
+};
+
+class TRE {
+
+public:
+  TRE(Function &fun) : _fun(fun) {}
+
+  void run() {
+    for (auto &bb : _fun.bb())
+      _find_site(bb);
+    if (_sites.empty())
+      return;
+
+    _make_loop();
+  }
+
+private:
+  Function &_fun;
+  std::vector<Site> _sites;
+  std::string _acc_op;
+  std::size_t _next_name = 0;
+
+  static Instruction *_prev(Instruction &ins) {
+    auto &bb = ins.parent();
+    auto it = ins_iterator_t(&ins);
+    return it == bb.ins_begin() ? nullptr : &*(it - 1);
+  }
+
+  bool _is_self_call(const Instruction *ins) const {
+    return ins && ins->get_opname() == "call" && &ins->op(0) == &_fun &&
+           ins->ops_count() == _fun.args_count() + 1;
+  }
+
+  void _find_site(BasicBlock &bb) {
+    auto &ret = bb.ins().back();
+    if (ret.get_opname() != "ret")
+      return;
+    auto prev = _prev(ret);
+
+    // ret without value, or ret of the call result
+    if (_is_self_call(prev) &&
+        (ret.ops_count() == 0 ? !prev->has_def() : &ret.op(0) == prev)) {
+      _sites.push_back(Site{prev, nullptr, 0, &ret});
+      return;
+    }
+
+    if (!prev || ret.ops_count() == 0 || &ret.op(0) != prev)
+      return;
+    const auto &opname = prev->get_opname();
+    if (opname != "add" && opname != "mul")
+      return;
+    if (!_acc_op.empty() && opname != _acc_op)
+      return;
+
+    auto call = _prev(*prev);
+    if (!_is_self_call(call) || !call->has_def() ||
+        call->get_users().size() != 1 || prev->get_users().size() != 1)
+      return;
+    // x must be computed before the call
+    if ((&prev->op(0) == call) == (&prev->op(1) == call))
+      return;
+    std::size_t x = &prev->op(0) == call ? 1 : 0;
+
+    _acc_op = opname;
+    _sites.push_back(Site{call, prev, x, &ret});
+  }
+
+  void _make_loop() {
+    auto &header = _fun.get_entry_bb();
+    auto &entry =
+        *_fun.insert_bb(bb_iterator_t(&header), header.get_name() + "_pre");
+    entry.insert_ins(entry.ins_end(), "b", {&header}, "", isa::IDX_NO);
+    _fun.set_entry_bb(entry);
+
+    // Phis are built with the call operands, then the args are replaced
+    for (auto arg : _fun.args()) {
+      std::vector<Value *> ops{&entry, arg};
+      for (const auto &site : _sites) {
+        ops.push_back(&site.call->parent());
+        ops.push_back(&site.call->op(1 + arg->get_pos()));
+      }
+      auto &phi = *header.insert_ins(header.ins_begin(), "phi", ops,
+                                     arg->get_name() + "_tre", 1);
+      arg->replace_all_uses_with(phi);
+      phi.set_op(1, *arg);
+    }
+
+    Instruction *acc = nullptr;
+    if (!_acc_op.empty())
+      acc = &_make_acc(entry, header);
+
+    for (const auto &site : _sites) {
+      std::cout << "Tail call: ";
+      site.call->dump(std::cout);
+      std::cout << "\n";
+
+      auto &bb = site.call->parent();
+      site.ret->erase_from_parent();
+      if (site.op)
+        site.op->erase_from_parent();
+      site.call->erase_from_parent();
+      bb.insert_ins(bb.ins_end(), "b", {&header}, "", isa::IDX_NO);
+    }
+
+    if (!acc)
+      return;
+
+    // All remaining rets are base cases
+    for (auto &bb : _fun.bb()) {
+      auto &ret = bb.ins().back();
+      if (ret.get_opname() != "ret" || ret.ops_count() == 0)
+        continue;
+      auto &res = *bb.insert_ins(ins_iterator_t(&ret), _acc_op,
+                                 {acc, &ret.op(0)}, _new_name(), 1);
+      ret.set_op(0, res);
+    }
+  }
+
+  Instruction &_make_acc(BasicBlock &entry, BasicBlock &header) {
+    long neutral = _acc_op == "add" ? 0 : 1;
+    std::vector<Value *> ops{&entry, ValueConst::make(neutral)};
+    for (const auto &site : _sites) {
+      ops.push_back(&site.call->parent());
+      ops.push_back(ValueConst::make(neutral));
+    }
+    auto &acc = *header.insert_ins(header.ins_begin(), "phi", ops,
+                                   "acc_tre", 1);
+
+    for (std::size_t i = 0; i < _sites.size(); ++i) {
+      const auto &site = _sites[i];
+      if (!site.op) {
+        acc.set_op(3 + 2 * i, acc);
+        continue;
+      }
+
+      std::cout << "Accumulator: ";
+      site.op->dump(std::cout);
+      std::cout << "\n";
+      auto &next = *site.call->parent().insert_ins(
+          ins_iterator_t(site.op), _acc_op, {&acc, &site.op->op(site.x)},
+          _new_name(), 1);
+      acc.set_op(3 + 2 * i, next);
+    }
+    return acc;
+  }
+
+  std::string _new_name() { return "tre" + std::to_string(_next_name++); }
+};
+
+} // namespace
+
+void tre_run(Module &mod) {
+  for (auto &fun : mod.fun()) {
+    if (!fun.has_def())
+      continue;
+    TRE tre(fun);
+    tre.run();
+  }
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include "module.hh"
+
+// Tail Recursion Elimination
+// A tail call is a call of the function itself, directly followed by a ret of
+// its result (or a ret without value).
+// The function is rewritten into a loop:
+// - a new entry block jumps to the old one, which is the loop header
+// - the header gets a phi for each argument: the argument from the entry,
+//   and the call operands from each tail call
+// - each tail call and its ret are replaced by a jump to the header
+//
+// Accumulator recursion: a call followed by `add` / `mul` of its result with
+// a value x computed before the call, then ret of the sum / product (eg:
+// `n * fact(n - 1)`). The operator is associative and commutative, so the
+// pending operations are accumulated in a new header phi acc (starting with
+// the neutral element), and x is combined with acc before jumping to the
+// header. All other rets of the function return `acc op v` instead of v.
+// Only one operator can be accumulated, tail calls with another one are left
+// unchanged.
+//
+// Tail Recursion Elimination - Engineer a Compiler p493
+void tre_run(Module &mod);
@@ -0,0 +1,309 @@
+#include "thb.hh"
+
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include <queue>
+#include <set>
+#include <sstream>
+#include <tuple>
+#include <vector>
+
+#include "cfg.hh"
+#include "idom.hh"
+#include "loop-info.hh"
+
+namespace {
+
+// Constants are folded on unsigned, overflow wraps like at runtime
+long fold(const std::string &op, long x, long y) {
+  auto ux = static_cast<unsigned long>(x);
+  auto uy = static_cast<unsigned long>(y);
+  return static_cast<long>(op == "add" ? ux + uy : ux * uy);
+}
+
+bool is_assoc(const std::string &opname) {
+  return opname == "add" || opname == "mul";
+}
+
+// Height of the longest chain of add / mul ending at v
+std::size_t tree_height(const Value &v,
+                        std::map<const Value *, std::size_t> &heights) {
+  auto ins = dynamic_cast<const Instruction *>(&v);
+  if (!ins || !is_assoc(ins->get_opname()))
+    return 0;
+  auto it = heights.find(ins);
+  if (it != heights.end())
+    return it->second;
+
+  std::size_t res = 0;
+  for (auto op : ins->ops())
+    res = std::max(res, tree_height(*op, heights));
+  heights.emplace(ins, res + 1);
+  return res + 1;
+}
+
+std::size_t fun_height(const Function &fun) {
+  std::map<const Value *, std::size_t> heights;
+  std::size_t res = 0;
+  for (const auto &bb : fun.bb())
+    for (const auto &ins : bb.ins())
+      res = std::max(res, tree_height(ins, heights));
+  return res;
+}
+
+// Leaf or subtree waiting to be combined
+struct Item {
+  Value *val;
+  long level;
+  std::size_t height;
+  std::size_t id;
+};
+
+struct ItemGreater {
+  bool operator()(const Item &a, const Item &b) const {
+    return std::tie(a.level, a.height, a.id) >
+           std::tie(b.level, b.height, b.id);
+  }
+};
+
+using pq_t = std::priority_queue<Item, std::vector<Item>, ItemGreater>;
+
+class THB {
+
+public:
+  THB(Function &fun)
+      : _fun(fun), _cfg(_fun), _idom(_fun, _cfg), _li(_fun, _cfg, _idom) {}
+
+  void run() {
+    auto before = fun_height(_fun);
+    _find_ebbs();
+    _find_roots();
+
+    std::map<const Value *, std::size_t> old_heights;
+    std::vector<std::pair<std::string, std::size_t>> logs;
+    for (auto root : _roots) {
+      std::ostringstream os;
+      root->dump(os);
+      logs.emplace_back(os.str(), tree_height(*root, old_heights));
+    }
+
+    for (auto root : _roots)
+      _balance(*root);
+
+    // Old roots may be leaves of other trees, replace them only at the end
+    for (auto root : _roots)
+      if (_new_roots.at(root) != root)
+        root->replace_all_uses_with(*_new_roots.at(root));
+    _cleanup();
+
+    std::map<const Value *, std::size_t> new_heights;
+    for (std::size_t i = 0; i < _roots.size(); ++i) {
+      auto new_root = _new_roots.at(_roots[i]);
+      if (new_root != _roots[i])
+        std::cout << "Balance: " << logs[i].first << " (height "
+                  << logs[i].second << " => "
+                  << tree_height(*new_root, new_heights) << ")\n";
+    }
+    std::cout << "Tree height of " << _fun.to_arg() << ": " << before
+              << " => " << fun_height(_fun) << "\n";
+  }
+
+private:
+  Function &_fun;
+  CFG _cfg;
+  IDom _idom;
+  LoopInfo _li;
+
+  // First block of the EBB of each block
+  std::map<const BasicBlock *, const BasicBlock *> _ebb;
+
+  // Roots in program order, and nodes that belong to the tree of their user
+  std::vector<Instruction *> _roots;
+  std::set<const Instruction *> _roots_set;
+  std::set<const Instruction *> _inner;
+
+  std::map<const Instruction *, Value *> _new_roots;
+  std::map<const Instruction *, std::size_t> _ranks;
+  std::size_t _next_id = 0;
+  std::size_t _next_name = 0;
+
+  void _find_ebbs() {
+    for (auto &bb : _fun.bb())
+      _ebb[&bb] = &bb;
+
+    // The only pred always comes first in reverse postorder
+    for (auto bb : _cfg.rev_postorder()) {
+      auto preds = _cfg.preds(*bb);
+      if (bb != &_fun.get_entry_bb() && preds.size() == 1)
+        _ebb[bb] = _ebb.at(preds.front());
+    }
+  }
+
+  // Number of uses of v, counting each operand
+  std::size_t _uses_count(const Value &v) const {
+    std::size_t res = 0;
+    for (auto user : v.get_users()) {
+      auto ops = user->ops();
+      res += std::count(ops.begin(), ops.end(), &v);
+    }
+    return res;
+  }
+
+  void _find_roots() {
+    for (auto &bb : _fun.bb())
+      for (auto &ins : bb.ins()) {
+        if (!ins.has_def() || !is_assoc(ins.get_opname()))
+          continue;
+        auto users = ins.get_users();
+        // no use means unused computation anyway, can just skip it
+        if (users.empty())
+          continue;
+
+        auto user = dynamic_cast<Instruction *>(users.front());
+        if (_uses_count(ins) == 1 && user &&
+            user->get_opname() == ins.get_opname() &&
+            _ebb.at(&user->parent()) == _ebb.at(&ins.parent())) {
+          _inner.insert(&ins);
+          continue;
+        }
+
+        _roots.push_back(&ins);
+        _roots_set.insert(&ins);
+      }
+  }
+
+  // Rebuild the tree of root, return its new height
+  std::size_t _balance(Instruction &root) {
+    auto it = _ranks.find(&root);
+    if (it != _ranks.end())
+      return it->second;
+
+    pq_t q;
+    _flatten(q, root, root);
+    auto rank = _rebuild(q, root);
+    _ranks.emplace(&root, rank);
+    return rank;
+  }
+
+  // Depth of the innermost loop of root where v isn't invariant
+  long _level(const Value &v, const Instruction &root) const {
+    if (dynamic_cast<const ValueConst *>(&v))
+      return -1;
+    auto ins = dynamic_cast<const Instruction *>(&v);
+    if (!ins)
+      return 0;
+
+    for (auto loop = _li.loop_of(root.parent()); loop; loop = loop->parent())
+      if (loop->contains(ins->parent()))
+        return loop->depth();
+    return 0;
+  }
+
+  void _flatten(pq_t &q, Value &val, Instruction &root) {
+    auto ins = dynamic_cast<Instruction *>(&val);
+
+    // Another root must be rebuilt first, it's a leaf of this one
+    if (ins && ins != &root && _roots_set.count(ins)) {
+      auto height = _balance(*ins);
+      q.push(Item{ins, _level(*ins, root), height, _next_id++});
+      return;
+    }
+
+    if (ins != &root && !_inner.count(ins)) {
+      q.push(Item{&val, _level(val, root), 0, _next_id++});
+      return;
+    }
+
+    for (auto op : ins->ops())
+      _flatten(q, *op, root);
+  }
+
+  // Build a balanced tree of all items of q, right before root
+  std::size_t _rebuild(pq_t &q, Instruction &root) {
+    const auto &opname = root.get_opname();
+
+    // Nothing to balance or to fold, keep root
+    if (q.size() == 2) {
+      auto left = q.top();
+      q.pop();
+      auto right = q.top();
+      if (!dynamic_cast<ValueConst *>(left.val) ||
+          !dynamic_cast<ValueConst *>(right.val)) {
+        _new_roots.emplace(&root, &root);
+        return std::max(left.height, right.height) + 1;
+      }
+      q.push(left);
+    }
+
+    for (;;) {
+      auto left = q.top();
+      q.pop();
+      if (q.empty()) {
+        _new_roots.emplace(&root, left.val);
+        return left.height;
+      }
+
+      // The lowest level is done, it's now a leaf of the next one
+      auto right = q.top();
+      if (left.level < right.level) {
+        left.level = right.level;
+        q.push(left);
+        continue;
+      }
+      q.pop();
+
+      auto lconst = dynamic_cast<ValueConst *>(left.val);
+      auto rconst = dynamic_cast<ValueConst *>(right.val);
+      if (lconst && rconst) {
+        auto x = lconst->get_val();
+        auto y = rconst->get_val();
+        q.push(Item{ValueConst::make(fold(opname, x, y)),
+                    left.level, 0, _next_id++});
+        continue;
+      }
+
+      auto &bb = root.parent();
+      auto &val = *bb.insert_ins(ins_iterator_t(&root), opname,
+                                 {left.val, right.val}, _new_name(), 1);
+      q.push(Item{&val, left.level, std::max(left.height, right.height) + 1,
+                  _next_id++});
+    }
+  }
+
+  std::string _new_name() { return "thb" + std::to_string(_next_name++); }
+
+  // Remove old roots and all their unused nodes
+  void _cleanup() {
+    std::vector<Instruction *> work(_roots.rbegin(), _roots.rend());
+    while (!work.empty()) {
+      auto ins = work.back();
+      work.pop_back();
+      // May be an operand of several removed nodes
+      if (!_inner.count(ins) && !_roots_set.count(ins))
+        continue;
+      if (!ins->get_users().empty())
+        continue;
+
+      for (auto op : ins->ops()) {
+        auto def = dynamic_cast<Instruction *>(op);
+        if (def && def != ins && (_inner.count(def) || _roots_set.count(def)))
+          work.push_back(def);
+      }
+      _inner.erase(ins);
+      _roots_set.erase(ins);
+      ins->erase_from_parent();
+    }
+  }
+};
+
+} // namespace
+
+void thb_run(Module &mod) {
+  for (auto &fun : mod.fun()) {
+    if (!fun.has_def())
+      continue;
+    THB thb(fun);
+    thb.run();
+  }
+}
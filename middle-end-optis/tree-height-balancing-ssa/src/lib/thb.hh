@@ -0,0 +1,27 @@
+#pragma once
+
+#include "module.hh"
+
+// Tree Height Balancing
+// Works on extended basic blocks (EBB): a tree of blocks, where all blocks
+// except the root have a single predecessor.
+// An expression tree is a sequence of the same commutative and associative
+// operator (add, mul). A node belongs to the tree of its user if it's its only
+// use, with the same operator, in the same EBB (the node is defined in a block
+// on the path to the user). Otherwise, it's the root of its own tree.
+// Since a loop header always begins a new EBB, a tree never goes into a loop,
+// only out of one.
+//
+// Each tree is flattened into its leaves, then rebuilt before its root by
+// always combining the 2 leaves of smallest rank:
+// - the rank of a leaf is the depth of the innermost loop where it varies
+//   (constants first, then values invariant in all loops of the root)
+// - the rank of a new node is the height of its tree
+// Once a loop depth is done, its subtree becomes a leaf of the next one, so
+// invariant subterms are grouped together (and can then be hoisted), and
+// each group is balanced. Constants are folded.
+//
+// The height of the longest chain of add / mul is reported before / after.
+//
+// Algorithm Tree Height Balancing - Engineer a Compiler p428
+void thb_run(Module &mod);
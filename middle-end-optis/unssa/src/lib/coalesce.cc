@@ -0,0 +1,489 @@
+#include "coalesce.hh"
+
+#include <algorithm>
+#include <iostream>
+#include <set>
+
+#include "../isa/isa.hh"
+#include "cfg.hh"
+#include "module.hh"
+
+namespace {
+
+constexpr std::size_t NO_VAR = -1;
+
+// A SSA variable, defined at position pos in bb
+// Positions in a block:
+// - function arguments: < 0 (entry block only)
+// - a'0 (isolated phis): 0
+// - a0 (parallel copy at the beginning): 1
+// - non-phi instructions: 2, 4, 6, ...
+// - a'i (parallel copy at the end): right before the terminator
+struct Var {
+  std::string name;
+  const BasicBlock *bb;
+  int pos;
+  bool is_arg;
+  bool is_virtual; // a'i, doesn't exist in the input code
+  std::size_t copy_of;
+  std::vector<std::pair<const BasicBlock *, int>> uses;
+};
+
+// dst <- src, src is either a variable or a constant
+struct Copy {
+  std::size_t dst;
+  std::size_t src;
+  std::string cst;
+};
+
+class Coalescer {
+
+public:
+  Coalescer(const Function &fun, gop::Module &res)
+      : _fun(fun), _res(res), _cfg(_fun) {}
+
+  void run() {
+    _build_vars();
+    _isolate_phis();
+    _build_idom();
+    _build_liveness();
+    _coalesce();
+    _write_code();
+    _dump_stats();
+  }
+
+private:
+  const Function &_fun;
+  gop::Module &_res;
+  CFG _cfg;
+
+  std::vector<Var> _vars;
+  std::map<const Value *, std::size_t> _vars_map;
+  std::set<std::string> _names;
+
+  // Parallel copies at the beginning / end of every block
+  std::map<const BasicBlock *, std::vector<Copy>> _begin_copies;
+  std::map<const BasicBlock *, std::vector<Copy>> _end_copies;
+  std::map<const BasicBlock *, int> _end_pos;
+
+  std::map<const BasicBlock *, const BasicBlock *> _idom;
+  std::map<const BasicBlock *, std::set<std::size_t>> _live_in;
+  std::map<const BasicBlock *, std::set<std::size_t>> _live_out;
+
+  // Congruence classes (union-find)
+  std::vector<std::size_t> _parent;
+  std::vector<std::vector<std::size_t>> _members;
+
+  // Register of every variable
+  std::map<std::string, std::string> _regs;
+  std::string _tmp;
+  std::size_t _phi_movs = 0;
+  std::size_t _movs = 0;
+
+  std::size_t _add_var(const std::string &name, const BasicBlock &bb, int pos,
+                       bool is_arg, bool is_virtual) {
+    _vars.push_back({name, &bb, pos, is_arg, is_virtual, NO_VAR, {}});
+    _names.insert(name);
+    _parent.push_back(_vars.size() - 1);
+    _members.push_back({_vars.size() - 1});
+    return _vars.size() - 1;
+  }
+
+  std::string _fresh_name(const std::string &base) {
+    for (std::size_t i = 0;; ++i) {
+      auto name = base + "_" + std::to_string(i);
+      if (!_names.count(name))
+        return name;
+    }
+  }
+
+  std::size_t _find_var(const Value &val) const {
+    auto it = _vars_map.find(&val);
+    return it == _vars_map.end() ? NO_VAR : it->second;
+  }
+
+  void _build_vars() {
+    auto &entry = _fun.get_entry_bb();
+    int nargs = _fun.args_count();
+    for (int i = 0; i < nargs; ++i) {
+      const auto &arg = _fun.get_arg(i);
+      _vars_map[&arg] = _add_var(arg.get_name(), entry, i - nargs, true, false);
+    }
+
+    for (const auto &bb : _fun.bb()) {
+      int pos = 0;
+      for (const auto &ins : bb.ins()) {
+        bool is_phi = ins.get_opname() == "phi";
+        if (!is_phi)
+          pos += 2;
+        if (ins.has_def())
+          _vars_map[&ins] =
+              _add_var(ins.get_name(), bb, is_phi ? 1 : pos, false, false);
+      }
+      _end_pos[&bb] = pos - 1;
+    }
+
+    for (const auto &bb : _fun.bb()) {
+      int pos = 0;
+      for (const auto &ins : bb.ins()) {
+        if (ins.get_opname() == "phi")
+          continue;
+        pos += 2;
+        for (const auto &op : ins.ops()) {
+          auto v = _find_var(*op);
+          if (v != NO_VAR)
+            _vars[v].uses.emplace_back(&bb, pos);
+        }
+
+        if (ins.get_opname() == "mov" && _find_var(ins.op(0)) != NO_VAR)
+          _vars[_find_var(ins)].copy_of = _find_var(ins.op(0));
+      }
+    }
+
+    // Reserved, virtual variables must not reuse the name
+    _tmp = _fresh_name("p");
+    _names.insert(_tmp);
+  }
+
+  // a0 = phi(a1, ..., an) => a'0 = phi(a'1, ..., a'n)
+  // With parallel copies a'i <- ai at the end of preds, and a0 <- a'0
+  void _isolate_phis() {
+    for (const auto &bb : _fun.bb())
+      for (const auto &ins : bb.ins()) {
+        if (ins.get_opname() != "phi")
+          break;
+
+        auto a0 = _find_var(ins);
+        auto a0p = _add_var(_fresh_name(ins.get_name()), bb, 0, false, true);
+        _vars[a0p].uses.emplace_back(&bb, 1);
+        _vars[a0].copy_of = a0p;
+        _begin_copies[&bb].push_back({a0, a0p, ""});
+
+        for (std::size_t i = 0; i < ins.ops_count(); i += 2) {
+          auto pred = dynamic_cast<const BasicBlock *>(&ins.op(i));
+          assert(pred);
+          auto aip = _add_var(_fresh_name(ins.get_name()), *pred,
+                              _end_pos.at(pred), false, true);
+          _live_out[pred].insert(aip);
+
+          auto ai = _find_var(ins.op(i + 1));
+          if (ai != NO_VAR) {
+            _vars[ai].uses.emplace_back(pred, _end_pos.at(pred));
+            _vars[aip].copy_of = ai;
+          }
+          _end_copies[pred].push_back(
+              {aip, ai, ai == NO_VAR ? ins.op(i + 1).to_arg() : ""});
+
+          // a'0, ..., a'n never interfere
+          _union(a0p, aip);
+          ++_phi_movs;
+        }
+      }
+  }
+
+  // Algorithm Iterative Dominators - Cooper, Harvey & Kennedy
+  void _build_idom() {
+    auto rpo = _cfg.rev_postorder();
+    std::map<const BasicBlock *, std::size_t> rpo_pos;
+    for (std::size_t i = 0; i < rpo.size(); ++i)
+      rpo_pos[rpo[i]] = i;
+
+    auto entry = &_fun.get_entry_bb();
+    _idom[entry] = entry;
+    auto intersect = [&](const BasicBlock *a, const BasicBlock *b) {
+      while (a != b) {
+        while (rpo_pos[a] > rpo_pos[b])
+          a = _idom[a];
+        while (rpo_pos[b] > rpo_pos[a])
+          b = _idom[b];
+      }
+      return a;
+    };
+
+    for (bool changed = true; changed;) {
+      changed = false;
+      for (auto bb : rpo) {
+        if (bb == entry)
+          continue;
+        const BasicBlock *new_idom = nullptr;
+        for (auto pred : _cfg.preds(*bb))
+          if (_idom.count(pred))
+            new_idom = new_idom ? intersect(pred, new_idom) : pred;
+        if (new_idom && _idom[bb] != new_idom) {
+          _idom[bb] = new_idom;
+          changed = true;
+        }
+      }
+    }
+  }
+
+  bool _bb_dominates(const BasicBlock *a, const BasicBlock *b) const {
+    for (;;) {
+      if (a == b)
+        return true;
+      auto it = _idom.find(b);
+      if (it == _idom.end() || it->second == b)
+        return false;
+      b = it->second;
+    }
+  }
+
+  // Walk the CFG backward from every use until the definition
+  void _build_liveness() {
+    for (std::size_t v = 0; v < _vars.size(); ++v)
+      for (const auto &use : _vars[v].uses)
+        if (use.first != _vars[v].bb)
+          _mark_live_in(v, use.first);
+  }
+
+  void _mark_live_in(std::size_t v, const BasicBlock *bb) {
+    if (!_live_in[bb].insert(v).second)
+      return;
+    for (auto pred : _cfg.preds(*bb)) {
+      _live_out[pred].insert(v);
+      if (pred != _vars[v].bb)
+        _mark_live_in(v, pred);
+    }
+  }
+
+  // Definition of a dominates definition of b
+  bool _dominates(const Var &a, const Var &b) const {
+    if (a.bb == b.bb)
+      return a.pos <= b.pos;
+    return _bb_dominates(a.bb, b.bb);
+  }
+
+  // v is live right after position pos of bb
+  bool _live_after(std::size_t v, const BasicBlock *bb, int pos) const {
+    auto it = _live_out.find(bb);
+    if (it != _live_out.end() && it->second.count(v))
+      return true;
+    for (const auto &use : _vars[v].uses)
+      if (use.first == bb && use.second > pos)
+        return true;
+    return false;
+  }
+
+  // In strict SSA, if 2 live ranges intersect, one of them is live at the
+  // definition of the other
+  bool _intersect(std::size_t a, std::size_t b) const {
+    const auto &va = _vars[a];
+    const auto &vb = _vars[b];
+    if (_dominates(va, vb))
+      return _live_after(a, vb.bb, vb.pos);
+    if (_dominates(vb, va))
+      return _live_after(b, va.bb, va.pos);
+    return false;
+  }
+
+  std::size_t _value(std::size_t v) const {
+    while (_vars[v].copy_of != NO_VAR)
+      v = _vars[v].copy_of;
+    return v;
+  }
+
+  bool _interfere(std::size_t a, std::size_t b) const {
+    if (_vars[a].is_arg && _vars[b].is_arg)
+      return true;
+    return _value(a) != _value(b) && _intersect(a, b);
+  }
+
+  std::size_t _find(std::size_t v) {
+    while (_parent[v] != v) {
+      _parent[v] = _parent[_parent[v]];
+      v = _parent[v];
+    }
+    return v;
+  }
+
+  void _union(std::size_t a, std::size_t b) {
+    a = _find(a);
+    b = _find(b);
+    if (a == b)
+      return;
+    if (_members[a].size() < _members[b].size())
+      std::swap(a, b);
+    _parent[b] = a;
+    _members[a].insert(_members[a].end(), _members[b].begin(),
+                       _members[b].end());
+    _members[b].clear();
+  }
+
+  void _try_coalesce(std::size_t a, std::size_t b) {
+    auto ca = _find(a);
+    auto cb = _find(b);
+    if (ca == cb)
+      return;
+    for (auto x : _members[ca])
+      for (auto y : _members[cb])
+        if (_interfere(x, y))
+          return;
+    _union(ca, cb);
+  }
+
+  void _coalesce() {
+    for (const auto &bb : _fun.bb()) {
+      for (const auto &c : _begin_copies[&bb])
+        _try_coalesce(c.dst, c.src);
+      for (const auto &c : _end_copies[&bb])
+        if (c.src != NO_VAR)
+          _try_coalesce(c.dst, c.src);
+    }
+  }
+
+  // Register of the congruence class of v
+  // Named after its first variable (function arguments first)
+  std::string _reg(std::size_t v) {
+    const auto &members = _members[_find(v)];
+    return "%" + _vars[*std::min_element(members.begin(), members.end())].name;
+  }
+
+  std::string _rename(const std::string &arg) {
+    auto it = _regs.find(arg);
+    return it == _regs.end() ? arg : it->second;
+  }
+
+  // Sequentialize a parallel copy
+  // A copy is emitted once its destination isn't the source of another copy
+  // still pending (a value copied to several registers is read from the last
+  // one written). If only cycles are left, the value of one of them is saved
+  // in a temporary, and its copy can be done.
+  std::vector<isa::ins_t> _sequentialize(const std::vector<Copy> &pcopy) {
+    std::vector<isa::ins_t> res;
+    std::map<std::string, std::string> loc;  // where the value is now
+    std::map<std::string, std::string> pred; // src of copy to dst
+    std::vector<std::string> ready;
+    std::vector<std::string> todo;
+    std::vector<isa::ins_t> csts;
+
+    for (const auto &c : pcopy) {
+      auto dst = _reg(c.dst);
+      if (c.src == NO_VAR) {
+        csts.push_back({"mov", dst, c.cst});
+        continue;
+      }
+
+      auto src = _reg(c.src);
+      if (dst == src || pred.count(dst))
+        continue;
+      loc[src] = src;
+      pred[dst] = src;
+      todo.push_back(dst);
+    }
+    for (const auto &dst : todo)
+      if (!loc.count(dst))
+        ready.push_back(dst);
+
+    std::set<std::string> done;
+    while (!todo.empty()) {
+      while (!ready.empty()) {
+        auto b = ready.back();
+        ready.pop_back();
+        auto a = pred.at(b);
+        auto c = loc.at(a);
+        res.push_back({"mov", b, c});
+        done.insert(b);
+        loc[a] = b;
+        if (a == c && pred.count(a) && !done.count(a))
+          ready.push_back(a);
+      }
+
+      auto b = todo.back();
+      todo.pop_back();
+      if (!done.count(b)) {
+        std::cout << "Cycle detected at mov " << b << ", " << pred.at(b)
+                  << "\n";
+        res.push_back({"mov", "%" + _tmp, b});
+        loc[b] = "%" + _tmp;
+        ready.push_back(b);
+      }
+    }
+
+    // Constants are never overwritten, they can be copied last
+    res.insert(res.end(), csts.begin(), csts.end());
+    _movs += res.size();
+    return res;
+  }
+
+  void _write_code() {
+    for (std::size_t v = 0; v < _vars.size(); ++v)
+      _regs["%" + _vars[v].name] = _reg(v);
+
+    auto decl = _fun.decl();
+    for (std::size_t i = 0; i < _fun.args_count(); ++i)
+      isa::fundecl_rename_arg(decl, i, _fun.get_arg(i).get_name());
+    auto gfun = std::make_unique<gop::Dir>(decl);
+    gfun->label_defs = {_fun.get_name()};
+    _res.decls.push_back(std::move(gfun));
+
+    for (const auto &bb : _fun.bb()) {
+      bool is_first = true;
+      for (const auto &args : _sequentialize(_begin_copies[&bb]))
+        _add_ins(bb, args, is_first);
+
+      for (const auto &ins : bb.ins()) {
+        if (ins.get_opname() == "phi")
+          continue;
+
+        if (ins.is_branch())
+          for (const auto &args : _sequentialize(_end_copies[&bb]))
+            _add_ins(bb, args, is_first);
+
+        auto args = ins.sargs();
+        for (auto &arg : args)
+          arg = _rename(arg);
+        if (args[0] == "mov" && args[1] == args[2])
+          continue;
+        _add_ins(bb, args, is_first);
+      }
+    }
+  }
+
+  void _add_ins(const BasicBlock &bb, const isa::ins_t &ins, bool &is_first) {
+    auto gins = std::make_unique<gop::Ins>(ins);
+    if (is_first)
+      gins->label_defs = {bb.get_name()};
+
+    _res.decls.push_back(std::move(gins));
+    is_first = false;
+  }
+
+  void _dump_stats() {
+    std::cout << "Coalesced registers in " << _fun.get_name() << ":\n";
+    for (std::size_t v = 0; v < _vars.size(); ++v) {
+      if (_find(v) != v)
+        continue;
+      std::vector<std::string> names;
+      for (auto x : _members[v])
+        if (!_vars[x].is_virtual)
+          names.push_back("%" + _vars[x].name);
+      if (names.size() < 2)
+        continue;
+      std::sort(names.begin(), names.end());
+      std::cout << "  " << _reg(v) << ":";
+      for (const auto &name : names)
+        std::cout << " " << name;
+      std::cout << "\n";
+    }
+
+    std::cout << "phi movs: " << _phi_movs << ", emitted: " << _movs
+              << ", eliminated: "
+              << (_phi_movs > _movs ? _phi_movs - _movs : 0) << "\n\n";
+  }
+};
+
+} // namespace
+
+gop::Module unssa_coalesce(const Module &mod) {
+
+  gop::Module res;
+
+  for (auto &fun : mod.fun()) {
+    if (!fun.has_def())
+      continue;
+    Coalescer co(fun, res);
+    co.run();
+  }
+
+  return res;
+}
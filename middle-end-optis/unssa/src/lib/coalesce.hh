@@ -0,0 +1,26 @@
+#pragma once
+
+#include "module.hh"
+#include <gop10/module.hh>
+
+// Convert module to gop::Module, with as few movs as possible
+// Code must have no critical edges
+//
+// Like unssa(), phis are replaced by copies, but most of them are coalesced:
+// - Every phi a0 = phi(a1, ..., an) is isolated with parallel copies:
+//   a'i <- ai at the end of every pred, a0 <- a'0 at the beginning of the block,
+//   and the phi becomes a'0 = phi(a'1, ..., a'n). a'0, ..., a'n are put in the
+//   same congruence class (they can't interfere).
+// - Then try to coalesce both sides of every copy: the 2 congruence classes are
+//   merged if none of their variables interfere.
+//   Two variables interfere if their live ranges intersect (one is live at the
+//   definition of the other, with the dominance of SSA form), and they don't
+//   have the same value.
+// - Every congruence class becomes one register. The remaining parallel copies
+//   are sequentialized: each copy is emitted once a destination isn't used
+//   anymore, and each cycle is broken with only one extra move to a temporary.
+//
+// Revisiting Out-of-SSA Translation for Correctness, Code Quality, and
+// Efficiency - Boissinot et al.
+// Translating Out of Static Single Assignment Form - Sreedhar et al.
+gop::Module unssa_coalesce(const Module &mod);
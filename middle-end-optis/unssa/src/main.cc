@@ -2,6 +2,7 @@
 #include <fstream>
 #include <iostream>
 
+#include "lib/coalesce.hh"
 #include "lib/critical.hh"
 #include "lib/loader.hh"
 #include "lib/module.hh"
@@ -9,16 +10,17 @@
 
 int main(int argc, char **argv) {
   if (argc < 2) {
-    std::cerr << "Usage: unssa <src-file>" << std::endl;
+    std::cerr << "Usage: unssa <src-file> [--coalesce]" << std::endl;
     return 1;
   }
 
   auto in_file = argv[1];
+  bool coalesce = argc > 2 && !strcmp(argv[2], "--coalesce");
   auto mod = load_module(in_file);
 
   critical_split(*mod);
   mod->check();
-  auto gout = unssa(*mod);
+  auto gout = coalesce ? unssa_coalesce(*mod) : unssa(*mod);
 
   gout.dump(std::cout);
   isa::check(gout);
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "../lib/libgop10.a"
+  "../lib/libgop10.pdb"
+  "CMakeFiles/gop10.dir/module.cc.o"
+  "CMakeFiles/gop10.dir/module.cc.o.d"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/gop10.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,21 @@
+
+# Consider dependencies only in project.
+set(CMAKE_DEPENDS_IN_PROJECT_ONLY OFF)
+
+# The set of languages for which implicit dependencies are needed:
+set(CMAKE_DEPENDS_LANGUAGES
+  )
+
+# The set of dependency files which are needed:
+set(CMAKE_DEPENDS_DEPENDENCY_FILES
+  "/root/repo/utils/libcpp_utils/src/cli/err.cc" "src/cli/CMakeFiles/utils_cli.dir/err.cc.o" "gcc" "src/cli/CMakeFiles/utils_cli.dir/err.cc.o.d"
+  "/root/repo/utils/libcpp_utils/src/cli/ipc.cc" "src/cli/CMakeFiles/utils_cli.dir/ipc.cc.o" "gcc" "src/cli/CMakeFiles/utils_cli.dir/ipc.cc.o.d"
+  "/root/repo/utils/libcpp_utils/src/cli/opt.cc" "src/cli/CMakeFiles/utils_cli.dir/opt.cc.o" "gcc" "src/cli/CMakeFiles/utils_cli.dir/opt.cc.o.d"
+  )
+
+# Targets to which this target links.
+set(CMAKE_TARGET_LINKED_INFO_FILES
+  )
+
+# Fortran module output directory.
+set(CMAKE_Fortran_TARGET_MODULE_DIR "")
@@ -0,0 +1,15 @@
+file(REMOVE_RECURSE
+  "../../lib/libutils_cli.a"
+  "../../lib/libutils_cli.pdb"
+  "CMakeFiles/utils_cli.dir/err.cc.o"
+  "CMakeFiles/utils_cli.dir/err.cc.o.d"
+  "CMakeFiles/utils_cli.dir/ipc.cc.o"
+  "CMakeFiles/utils_cli.dir/ipc.cc.o.d"
+  "CMakeFiles/utils_cli.dir/opt.cc.o"
+  "CMakeFiles/utils_cli.dir/opt.cc.o.d"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/utils_cli.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
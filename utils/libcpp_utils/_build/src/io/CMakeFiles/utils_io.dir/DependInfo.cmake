@@ -0,0 +1,22 @@
+
+# Consider dependencies only in project.
+set(CMAKE_DEPENDS_IN_PROJECT_ONLY OFF)
+
+# The set of languages for which implicit dependencies are needed:
+set(CMAKE_DEPENDS_LANGUAGES
+  )
+
+# The set of dependency files which are needed:
+set(CMAKE_DEPENDS_DEPENDENCY_FILES
+  "/root/repo/utils/libcpp_utils/src/io/fd.cc" "src/io/CMakeFiles/utils_io.dir/fd.cc.o" "gcc" "src/io/CMakeFiles/utils_io.dir/fd.cc.o.d"
+  "/root/repo/utils/libcpp_utils/src/io/file.cc" "src/io/CMakeFiles/utils_io.dir/file.cc.o" "gcc" "src/io/CMakeFiles/utils_io.dir/file.cc.o.d"
+  "/root/repo/utils/libcpp_utils/src/io/path.cc" "src/io/CMakeFiles/utils_io.dir/path.cc.o" "gcc" "src/io/CMakeFiles/utils_io.dir/path.cc.o.d"
+  "/root/repo/utils/libcpp_utils/src/io/tmp.cc" "src/io/CMakeFiles/utils_io.dir/tmp.cc.o" "gcc" "src/io/CMakeFiles/utils_io.dir/tmp.cc.o.d"
+  )
+
+# Targets to which this target links.
+set(CMAKE_TARGET_LINKED_INFO_FILES
+  )
+
+# Fortran module output directory.
+set(CMAKE_Fortran_TARGET_MODULE_DIR "")
@@ -0,0 +1,17 @@
+file(REMOVE_RECURSE
+  "../../lib/libutils_io.a"
+  "../../lib/libutils_io.pdb"
+  "CMakeFiles/utils_io.dir/fd.cc.o"
+  "CMakeFiles/utils_io.dir/fd.cc.o.d"
+  "CMakeFiles/utils_io.dir/file.cc.o"
+  "CMakeFiles/utils_io.dir/file.cc.o.d"
+  "CMakeFiles/utils_io.dir/path.cc.o"
+  "CMakeFiles/utils_io.dir/path.cc.o.d"
+  "CMakeFiles/utils_io.dir/tmp.cc.o"
+  "CMakeFiles/utils_io.dir/tmp.cc.o.d"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/utils_io.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "../../lib/libutils_str.a"
+  "../../lib/libutils_str.pdb"
+  "CMakeFiles/utils_str.dir/str.cc.o"
+  "CMakeFiles/utils_str.dir/str.cc.o.d"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/utils_str.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()